@@ -0,0 +1,5625 @@
+/*
+ * numconv: the conversions behind numconv.h, and the contexts, bulk
+ * conversion, result cache and statistics built on them.
+ */
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <float.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <time.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "numconv_internal.h"
+
+/* Converters private to the library, defined in their sections below. */
+static char *decimal_to_ieee754_binary_buf(double input, int exp_bits, int mantissa_bits, int rounding_mode,
+                                           char *out, size_t outlen);
+static size_t scan_binary_digits(const char *s, unsigned long *value);
+static size_t scan_binary_digits_n(const char *s, size_t len, unsigned long *value);
+static double ieee754_decode_bits(unsigned long bits, int exp_bits, int mantissa_bits);
+static bool convert_fixed_bits(unsigned long bits, unsigned int width, int inputSystem, int outputSystem,
+                               unsigned int numbits, const struct numconv_ieee754_format *in_format,
+                               const struct numconv_ieee754_format *out_format,
+                               const struct numconv_fixed_format *in_fixed,
+                               const struct numconv_fixed_format *out_fixed, int rounding_mode, unsigned long *result,
+                               const char **error);
+static char *wide_binary_to_decimal(const char *digits, size_t len, int system);
+static char *wide_binary_to_decimal_buf(const char *digits, size_t len, int system, char *out, size_t outlen);
+static char *wide_decimal_to_binary(const char *text, size_t len, int system, unsigned int numbits,
+                                    char *out, size_t outlen, const char **error);
+static char *transcode_integer_digits(const char *in, size_t len, int from, int to, unsigned int numbits,
+                                      char *out, size_t outlen, const char **error);
+static const char *lookup_decimal_text(unsigned long value);
+static size_t convert_output_size(size_t len, int inputSystem, int outputSystem, unsigned int numbits,
+                                  const struct numconv_ieee754_format *out_format);
+static unsigned long encode_integer_bits(int system, unsigned long magnitude, bool negative, unsigned int numbits);
+static bool transcode_integer_bits(unsigned long bits, unsigned int width, int from, int to, unsigned int numbits,
+                                   unsigned long *result);
+static size_t transcode_packed_integers(const char *src, size_t count, unsigned int in_bytes, int from, int to,
+                                        unsigned int numbits, char *dst, unsigned int out_bytes);
+static char *format_decimal(int inputSystem, long value, double dvalue, const struct numconv_ieee754_format *format,
+                            char *out, size_t outlen);
+static long double_to_long(double value);
+static unsigned long double_to_ulong(double value);
+static size_t radix_pattern_bits(size_t ndigits, unsigned int radix);
+static size_t radix_pattern_digits(size_t nbits, unsigned int radix);
+static size_t emit_radix_digits(unsigned long value, unsigned int numbits, unsigned int radix, char *out);
+static char *radix_to_binary(const char *in, size_t len, unsigned int radix, size_t width, char *out, size_t outlen,
+                             const char **error);
+static char *binary_to_radix(const char *digits, size_t len, unsigned int radix, char *out, size_t outlen);
+static size_t convert_output_size_radix(size_t len, int inputSystem, unsigned int in_radix, int outputSystem,
+                                        unsigned int numbits, const struct numconv_ieee754_format *in_format,
+                                        const struct numconv_ieee754_format *out_format);
+static char *convert_number_radix(const char *numberStr, size_t len, int inputSystem, unsigned int in_radix,
+                                  int outputSystem, unsigned int out_radix, unsigned int numbits,
+                                  const struct numconv_ieee754_format *in_format,
+                                  const struct numconv_ieee754_format *out_format,
+                                  int rounding_mode, char *out, size_t outlen, const char **error);
+static size_t format_shortest(double value, const struct numconv_ieee754_format *format, char *out);
+
+/*
+ * Conversion status.
+ *
+ * The converters saturate, truncate and round silently, as they always
+ * have. A checked conversion (numconv_convert_status()) also learns which
+ * of those happened: each place that can lose information raises its
+ * NUMCONV_* flag in a per-thread status word, which the checked entry
+ * points clear before a conversion and read after it. The range tests are
+ * comparisons folded into flag bits rather than branches, and the few that
+ * rescan digits or text run only while status_checking is set.
+ */
+static __thread unsigned int status_flags;
+static __thread bool status_checking;
+
+static bool parse_decimal_exact(const char *text, size_t len, double *value, bool *exact);
+static inline bool decimal_tables(void);
+
+static inline void status_raise(unsigned int flags)
+{
+    status_flags |= flags;
+}
+
+/**
+ * @brief OVERFLOW unless a magnitude of len significant bits fits a numbits-bit field of an integer system.
+ * @param system The output system (SYS_UNSIGNED .. SYS_TWOS_COMPLEMENT).
+ * @param len The bit length of the magnitude.
+ * @param power_of_two Whether the magnitude is 2^(len - 1), which negative two's complement still holds.
+ * @param negative The sign; negative values never fit unsigned output.
+ * @param numbits The output width.
+ */
+static inline unsigned int length_range_status(int system, size_t len, bool power_of_two, bool negative,
+                                               size_t numbits)
+{
+    size_t bits = numbits - (system != SYS_UNSIGNED);
+    bool edge = negative & (system == SYS_TWOS_COMPLEMENT) & (len == bits + 1) & power_of_two;
+    return (unsigned int)(((len > bits) & !edge) | (negative & (system == SYS_UNSIGNED))) * NUMCONV_OVERFLOW;
+}
+
+/* length_range_status() of a 64-bit magnitude, for widths of 1..64. */
+static inline unsigned int integer_range_status(int system, unsigned long magnitude, bool negative,
+                                                unsigned int numbits)
+{
+    size_t len = magnitude ? 64 - (size_t)__builtin_clzl(magnitude) : 0;
+    return length_range_status(system, len, (magnitude & (magnitude - 1)) == 0, negative, numbits);
+}
+
+/**
+ * @brief Status of a double converted to an integer system: OVERFLOW when its
+ *        integer part is out of range, TRUNCATED when a fraction is dropped,
+ *        INVALID for NaN, which has neither.
+ */
+static inline unsigned int double_range_status(int system, double value, unsigned int numbits)
+{
+    double t = trunc(value), magnitude = fabs(t);
+    // 2^bits bounds the magnitude: below it always fits, equal to it only for negative two's complement.
+    double limit = ldexp(1.0, (int)(numbits - (system != SYS_UNSIGNED)));
+    bool negative = t < 0;
+    bool over = magnitude > limit || (magnitude == limit && !(negative && system == SYS_TWOS_COMPLEMENT)) ||
+                (negative && system == SYS_UNSIGNED);
+    // NaN compares unequal to its own trunc(), so it must not be taken for a fraction.
+    bool nan = isnan(value);
+    return (unsigned int)nan * NUMCONV_INVALID | (unsigned int)over * NUMCONV_OVERFLOW |
+           (unsigned int)(t != value && !nan) * NUMCONV_TRUNCATED;
+}
+
+/**
+ * @brief Rejects a non-finite double bound for an integer system, whatever the width.
+ *        Infinities are numbers too large for any width (OVERFLOW); NaN is none at all (INVALID).
+ */
+static bool integer_input_finite(double value, const char **error)
+{
+    if (isfinite(value))
+        return true;
+    status_raise(isnan(value) ? NUMCONV_INVALID : NUMCONV_OVERFLOW);
+    *error = "Invalid decimal input.";
+    return false;
+}
+
+/* INEXACT when an integer magnitude has more significant bits than a double holds. */
+static inline unsigned int magnitude_inexact_status(unsigned long magnitude)
+{
+    // Or-ing in the top bit keeps the count defined for 0 without changing it otherwise.
+    return (unsigned int)((magnitude >> __builtin_ctzl(magnitude | 1UL << 63)) >> 53 != 0) * NUMCONV_INEXACT;
+}
+
+/**
+ * @brief Status of encoding a value in an IEEE754 format: INEXACT when the
+ *        encoding reads back as another value, OVERFLOW when a finite value
+ *        became an infinity (or the NaN of a finite format).
+ */
+static unsigned int ieee754_encode_status(double value, unsigned long bits, const struct numconv_ieee754_format *format)
+{
+    double back = ieee754_decode_format(bits, format);
+    bool finite = isfinite(value);
+    return (unsigned int)(finite && !isfinite(back)) * NUMCONV_OVERFLOW |
+           (unsigned int)(back != value && !isnan(value)) * NUMCONV_INEXACT;
+}
+
+/**
+ * @brief Computes the buffer size convert_number() needs for a conversion.
+ * @param len Length of the number to convert.
+ * @param inputSystem The input system.
+ * @param outputSystem The output system.
+ * @param numbits Width of an integer output; 0 keeps the width of a binary input.
+ * @param out_format The format of an IEEE754 output.
+ * @return The number of bytes required, including the null terminator.
+ */
+static size_t convert_output_size(size_t len, int inputSystem, int outputSystem, unsigned int numbits,
+                                  const struct numconv_ieee754_format *out_format)
+{
+    if (outputSystem == SYS_IEEE754)
+        return (size_t)(1 + out_format->exp_bits + out_format->mantissa_bits) + 1;
+    if (outputSystem == SYS_DECIMAL) {
+        // Enough for a double's shortest digits and for the digits of a len-bit binary integer.
+        size_t wide = (inputSystem == SYS_DECIMAL) ? 0 : len * 1234 / 4096 + 3;
+        return wide > 32 ? wide : 32;
+    }
+    if (numbits == 0 && inputSystem != SYS_DECIMAL)
+        return len + 1;
+    return (size_t)numbits + 1;
+}
+
+/**
+ * @brief Writes the encoding of a value in an IEEE754 format as binary digits.
+ * @return out, or NULL if the buffer is too small.
+ */
+static char *ieee754_format_to_binary_buf(double input, const struct numconv_ieee754_format *format, int rounding_mode,
+                                          char *out, size_t outlen)
+{
+    unsigned int total_bits = (unsigned int)(1 + format->exp_bits + format->mantissa_bits);
+    if (outlen < (size_t)total_bits + 1)
+        return NULL;
+    out[total_bits] = '\0';
+    unsigned long bits = ieee754_encode_format(input, format, rounding_mode);
+    if (status_checking)
+        status_raise(ieee754_encode_status(input, bits, format));
+    emit_binary_digits(bits, total_bits, false, out);
+    return out;
+}
+
+/**
+ * @brief Converts one number between two systems, shared by the interactive and batch modes.
+ * @param numberStr The number to convert, without a trailing newline; it need not be null-terminated.
+ * @param len Length of numberStr.
+ * @param inputSystem The input system (SYS_UNSIGNED .. SYS_DECIMAL).
+ * @param outputSystem The output system (SYS_UNSIGNED .. SYS_DECIMAL).
+ * @param numbits Width of an integer output; 0 keeps the width of a binary input.
+ *                Integer widths over 64 bits are handled with arbitrary precision.
+ * @param in_format The format of an IEEE754 input.
+ * @param out_format The format of an IEEE754 output.
+ * @param rounding_mode Rounding mode for IEEE754 output (ROUNDUP, ROUNDDOWN, or ROUNDTOEVEN).
+ * @param out Buffer receiving the result (see convert_output_size()).
+ * @param outlen Size of the buffer in bytes.
+ * @param error Set to a message describing the failure when NULL is returned.
+ * @return out on success, or NULL on error.
+ */
+char *convert_number(const char *numberStr, size_t len, int inputSystem, int outputSystem,
+                     unsigned int numbits, const struct numconv_ieee754_format *in_format,
+                     const struct numconv_ieee754_format *out_format, int rounding_mode, char *out, size_t outlen,
+                     const char **error)
+{
+    double dvalue = 0.0;
+    long value = 0;
+    bool exact = true;      // whether decimal text is exactly dvalue; only worked out while checking
+
+    // Process input based on chosen system.
+    if (inputSystem >= SYS_UNSIGNED && inputSystem <= SYS_IEEE754) {
+        // Validate that the number consists only of 0's and 1's, parsing it in the same pass.
+        unsigned long bits;
+        if (len == 0 || scan_binary_digits_n(numberStr, len, &bits) != len) {
+            status_raise(NUMCONV_INVALID);
+            *error = "Invalid number input. Please enter only binary digits (0 and 1).";
+            return NULL;
+        }
+        // For IEEE754 input, require exactly the width of the format.
+        if (inputSystem == SYS_IEEE754 && len != (size_t)(1 + in_format->exp_bits + in_format->mantissa_bits)) {
+            status_raise(NUMCONV_INVALID);
+            if (in_format->exp_bits == 8 && in_format->mantissa_bits == 23)
+                *error = "Invalid IEEE754 input. Must be exactly 32 bits (1 sign + 8 exponent + 23 mantissa).";
+            else
+                *error = "Invalid IEEE754 input. Must be exactly as wide as the format (sign + exponent + mantissa).";
+            return NULL;
+        }
+        // For binary-based inputs, use the length as the number of bits.
+        if (numbits == 0)
+            numbits = len;
+
+        // Integer to integer needs no intermediate value: transcode the digits directly.
+        if (inputSystem != SYS_IEEE754 && outputSystem >= SYS_UNSIGNED && outputSystem <= SYS_TWOS_COMPLEMENT)
+            return transcode_integer_digits(numberStr, len, inputSystem, outputSystem, numbits,
+                                            out, outlen, error);
+
+        // Integers wider than a machine word (and unsigned ones using its top bit)
+        // take the arbitrary-precision path.
+        if (inputSystem != SYS_IEEE754 &&
+            (len > 64 || (inputSystem == SYS_UNSIGNED && len == 64 && numberStr[0] == '1'))) {
+            if (outputSystem == SYS_DECIMAL) {
+                if (wide_binary_to_decimal_buf(numberStr, len, inputSystem, out, outlen) == NULL) {
+                    *error = "Conversion failed due to an error (memory allocation or output buffer too small).";
+                    return NULL;
+                }
+                return out;
+            }
+            // IEEE754 output: round the exact decimal text once.
+            char *text = wide_binary_to_decimal(numberStr, len, inputSystem);
+            if (text == NULL || !parse_decimal_exact(text, strlen(text), &dvalue, status_checking ? &exact : NULL)) {
+                free(text);
+                *error = "Conversion failed due to an error (memory allocation).";
+                return NULL;
+            }
+            free(text);
+            status_raise((unsigned int)!exact * NUMCONV_INEXACT);
+            if (ieee754_format_to_binary_buf(dvalue, out_format, rounding_mode, out, outlen) == NULL) {
+                *error = "Conversion failed due to an error (invalid width or output buffer too small).";
+                return NULL;
+            }
+            return out;
+        }
+        
+        // Convert the input string to an intermediate numeric value.
+        switch (inputSystem) {
+            case SYS_UNSIGNED:
+            case SYS_SIGNED_MAGNITUDE:
+            case SYS_ONES_COMPLEMENT:
+            case SYS_TWOS_COMPLEMENT:
+                value = decode_integer_bits(inputSystem, bits, len, numberStr[0] == '1');
+                break;
+            case SYS_IEEE754:
+                dvalue = ieee754_decode_format(bits, in_format);
+                if (isnan(dvalue)) {
+                    status_raise(NUMCONV_INVALID);
+                    *error = "Invalid IEEE754 number.";
+                    return NULL;
+                }
+                value = double_to_long(dvalue);
+                break;
+        }
+    } else if (inputSystem == SYS_DECIMAL) {
+        // Widths that hold integers a double cannot (over 53 bits) parse the digits exactly.
+        if (numbits > 53 && outputSystem != SYS_IEEE754 && outputSystem != SYS_DECIMAL)
+            return wide_decimal_to_binary(numberStr, len, outputSystem, numbits, out, outlen, error);
+        // Otherwise round the text to a double.
+        if (!parse_decimal_exact(numberStr, len, &dvalue, status_checking ? &exact : NULL)) {
+            status_raise(NUMCONV_INVALID);
+            *error = "Invalid decimal input.";
+            return NULL;
+        }
+        if (numbits < 1 && outputSystem != SYS_IEEE754 && outputSystem != SYS_DECIMAL) {
+            *error = "Invalid number of bits.";
+            return NULL;
+        }
+        // The same policy as wide_decimal_to_binary(), so the width never decides whether inf converts.
+        if (outputSystem >= SYS_UNSIGNED && outputSystem <= SYS_TWOS_COMPLEMENT && !integer_input_finite(dvalue, error))
+            return NULL;
+        // Set the integer value (truncating if necessary) for conversion functions that expect a long.
+        value = double_to_long(dvalue);
+    } else {
+        *error = "Unknown input system.";
+        return NULL;
+    }
+    
+    // Integer output only comes from a double here: integer input was transcoded above.
+    if (status_checking && outputSystem >= SYS_UNSIGNED && outputSystem <= SYS_TWOS_COMPLEMENT) {
+        unsigned int range = double_range_status(outputSystem, dvalue, numbits);
+        // In range, text that is not exactly its double had a fraction too small for the double to keep.
+        status_raise(range | (unsigned int)(!exact && !(range & (NUMCONV_OVERFLOW | NUMCONV_INVALID))) *
+                                 NUMCONV_TRUNCATED);
+    }
+
+    // Convert the intermediate value to the desired output representation.
+    char *result = NULL;
+    switch (outputSystem) {
+        case SYS_UNSIGNED:
+            // Unsigned binary conversion (if negative, report error).
+            if ((inputSystem == SYS_IEEE754 || inputSystem == SYS_DECIMAL) ? (dvalue < 0) : (value < 0)) {
+                status_raise(NUMCONV_OVERFLOW);
+                *error = "Cannot represent a negative number in an unsigned binary system.";
+                return NULL;
+            }
+            if (inputSystem == SYS_IEEE754 || inputSystem == SYS_DECIMAL)
+                result = unsigned_decimal_to_binary_buf(double_to_ulong(dvalue), numbits, out, outlen);
+            else
+                result = unsigned_decimal_to_binary_buf((unsigned long)value, numbits, out, outlen);
+            break;
+        case SYS_SIGNED_MAGNITUDE:
+            result = signed_decimal_to_signed_magnitude_buf(value, numbits, out, outlen);
+            break;
+        case SYS_ONES_COMPLEMENT:
+            result = signed_decimal_to_ones_complement_buf(value, numbits, out, outlen);
+            break;
+        case SYS_TWOS_COMPLEMENT:
+            result = signed_decimal_to_twos_complement_buf(value, numbits, out, outlen);
+            break;
+        case SYS_IEEE754:
+            if (inputSystem == SYS_IEEE754 || inputSystem == SYS_DECIMAL) {
+                status_raise((unsigned int)!exact * NUMCONV_INEXACT);
+                result = ieee754_format_to_binary_buf(dvalue, out_format, rounding_mode, out, outlen);
+            } else {
+                status_raise(magnitude_inexact_status(value < 0 ? 0UL - (unsigned long)value : (unsigned long)value));
+                result = ieee754_format_to_binary_buf((double)value, out_format, rounding_mode, out, outlen);
+            }
+            break;
+        case SYS_DECIMAL:
+            // Integer inputs print exactly; floating-point values as their shortest round-trip digits.
+            result = format_decimal(inputSystem, value, dvalue, in_format, out, outlen);
+            break;
+        default:
+            *error = "Unknown output system.";
+            return NULL;
+    }
+    if (result == NULL)
+        *error = "Conversion failed due to an error (invalid width or output buffer too small).";
+    return result;
+}
+
+/**
+ * @brief Writes a decoded value as decimal text.
+ * @param inputSystem The system the value was decoded from; it selects how value is read.
+ * @param value The integer value (read as unsigned for SYS_UNSIGNED).
+ * @param dvalue The floating-point value, used for SYS_IEEE754 and SYS_DECIMAL input.
+ * @param format The IEEE754 format of SYS_IEEE754 input, whose neighbours the digits must tell apart.
+ * @param out Buffer receiving the text.
+ * @param outlen Size of the buffer; 32 bytes are always enough.
+ * @return out, or NULL if the buffer is too small.
+ */
+static char *format_decimal(int inputSystem, long value, double dvalue, const struct numconv_ieee754_format *format,
+                            char *out,
+                            size_t outlen)
+{
+    // Integer inputs print exactly; floating-point values as the shortest digits that read back the same.
+    if (inputSystem == SYS_IEEE754 || inputSystem == SYS_DECIMAL) {
+        char text[32];
+        const struct numconv_ieee754_format *shortest_format = inputSystem == SYS_IEEE754 ? format : NULL;
+        if (outlen >= sizeof(text))
+            format_shortest(dvalue, shortest_format, out);
+        else if (format_shortest(dvalue, shortest_format, text) < outlen)
+            memcpy(out, text, strlen(text) + 1);
+        else
+            return NULL;
+        return out;
+    }
+    bool negative = inputSystem != SYS_UNSIGNED && value < 0;
+    unsigned long magnitude = negative ? 0UL - (unsigned long)value : (unsigned long)value;
+    const char *text = lookup_decimal_text(magnitude);
+    if (text != NULL && outlen >= 9) {
+        out[0] = '-';
+        memcpy(out + negative, text, 8);
+    } else if (inputSystem == SYS_UNSIGNED) {
+        snprintf(out, outlen, "%lu", (unsigned long)value);
+    } else {
+        snprintf(out, outlen, "%ld", value);
+    }
+    return out;
+}
+
+/**
+ * @brief Truncates a double to a long, saturating values outside its range.
+ *
+ * A plain cast is undefined for those; saturating them makes the encoders
+ * produce all ones, as they do for any other value too large for the field.
+ */
+static long double_to_long(double value)
+{
+    if (isnan(value))
+        return 0;
+    if (value >= 0x1p63)
+        return LONG_MAX;
+    if (value < -0x1p63)
+        return LONG_MIN;
+    return (long)value;
+}
+
+/**
+ * @brief Truncates a non-negative double to an unsigned long, saturating large values.
+ */
+static unsigned long double_to_ulong(double value)
+{
+    if (value >= 0x1p64)
+        return ULONG_MAX;
+    return value > 0 ? (unsigned long)value : 0;
+}
+
+/**
+ * @brief Decodes a packed bit pattern in one of the binary input systems.
+ * @param bits The bit pattern.
+ * @param width Its width for the integer systems (1..64).
+ * @param inputSystem The input system (SYS_UNSIGNED .. SYS_IEEE754).
+ * @param in_format The format of an IEEE754 input, which sets its width instead.
+ * @param value Receives the integer value (truncated for IEEE754; to be read as unsigned for SYS_UNSIGNED).
+ * @param dvalue Receives the value as a double.
+ * @param error Set to a message describing the failure when false is returned.
+ * @return true on success.
+ */
+static bool decode_bits(unsigned long bits, unsigned int width, int inputSystem,
+                        const struct numconv_ieee754_format *in_format, long *value, double *dvalue, const char **error)
+{
+    if (inputSystem == SYS_IEEE754) {
+        *dvalue = ieee754_decode_format(bits, in_format);
+        if (isnan(*dvalue)) {
+            status_raise(NUMCONV_INVALID);
+            *error = "Invalid IEEE754 number.";
+            return false;
+        }
+        *value = double_to_long(*dvalue);
+        return true;
+    }
+    if (width < 64)
+        bits &= (1UL << width) - 1;
+    *value = decode_integer_bits(inputSystem, bits, width, (bits >> (width - 1)) & 1);
+    *dvalue = (inputSystem == SYS_UNSIGNED) ? (double)bits : (double)*value;
+    return true;
+}
+
+/**
+ * @brief Converts one value between two systems as bit patterns, with no text in between.
+ *
+ * Results are the same as converting the binary string with convert_number().
+ *
+ * @param bits The input bit pattern.
+ * @param width Its width: 1..64 for the integer systems; the width of in_format for IEEE754.
+ * @param inputSystem The input system (SYS_UNSIGNED .. SYS_IEEE754).
+ * @param outputSystem The output system (SYS_UNSIGNED .. SYS_IEEE754).
+ * @param numbits Width of an integer output (1..64); 0 keeps the input width.
+ * @param in_format The format of an IEEE754 input.
+ * @param out_format The format of an IEEE754 output.
+ * @param rounding_mode Rounding mode for IEEE754 output.
+ * @param result Receives the output bit pattern.
+ * @param error Set to a message describing the failure when false is returned.
+ * @return true on success.
+ */
+bool convert_bits(unsigned long bits, unsigned int width, int inputSystem, int outputSystem,
+                  unsigned int numbits, const struct numconv_ieee754_format *in_format,
+                  const struct numconv_ieee754_format *out_format, int rounding_mode, unsigned long *result,
+                  const char **error)
+{
+    long value;
+    double dvalue;
+    if (numbits == 0)
+        numbits = width;
+    if (inputSystem != SYS_IEEE754 && outputSystem >= SYS_UNSIGNED && outputSystem <= SYS_TWOS_COMPLEMENT &&
+        numbits <= 64) {
+        if (!transcode_integer_bits(bits, width, inputSystem, outputSystem, numbits, result)) {
+            *error = "Cannot represent a negative number in an unsigned binary system.";
+            return false;
+        }
+        return true;
+    }
+    if (!decode_bits(bits, width, inputSystem, in_format, &value, &dvalue, error))
+        return false;
+    bool negative = inputSystem != SYS_UNSIGNED && value < 0;
+    unsigned long magnitude = negative ? 0UL - (unsigned long)value : (unsigned long)value;
+    if (inputSystem == SYS_IEEE754 && outputSystem == SYS_UNSIGNED)
+        magnitude = double_to_ulong(dvalue);
+
+    if (outputSystem == SYS_IEEE754) {
+        *result = ieee754_encode_format(dvalue, out_format, rounding_mode);
+        if (status_checking)
+            status_raise(ieee754_encode_status(dvalue, *result, out_format) |
+                         (inputSystem == SYS_IEEE754 ? 0 : magnitude_inexact_status(magnitude)));
+        return true;
+    }
+    if (outputSystem < SYS_UNSIGNED || outputSystem > SYS_TWOS_COMPLEMENT || numbits < 1 || numbits > 64) {
+        *error = "Conversion failed due to an error (invalid width or output system).";
+        return false;
+    }
+    if (outputSystem == SYS_UNSIGNED && (inputSystem == SYS_IEEE754 ? dvalue < 0 : negative)) {
+        status_raise(NUMCONV_OVERFLOW);
+        *error = "Cannot represent a negative number in an unsigned binary system.";
+        return false;
+    }
+    // Integer input was transcoded above, so the value comes from a float.
+    if (status_checking)
+        status_raise(double_range_status(outputSystem, dvalue, numbits));
+    *result = encode_integer_bits(outputSystem, magnitude, negative, numbits);
+    return true;
+}
+
+/**
+ * @brief Parses an input or output system given on the command line.
+ * @param arg A system number (1-7) or name such as "twos" or "ieee754", optionally
+ *            followed by ":RADIX" (see parse_radix()) for binary systems.
+ * @param radix Set to the radix of the system's digits (2 unless given).
+ * @return The system number, or 0 if the argument is not recognized.
+ */
+int parse_system(const char *arg, unsigned int *radix)
+{
+    static const char *const names[][3] = {
+        { "unsigned", "u", NULL },
+        { "signed-magnitude", "signmag", "sm" },
+        { "ones-complement", "ones", NULL },
+        { "twos-complement", "twos", NULL },
+        { "ieee754", "ieee", "float" },
+        { "decimal", "dec", NULL },
+        { "fixed-point", "fixed", "q" },
+    };
+    char name[32];
+    const char *colon = strchr(arg, ':');
+    size_t len = colon ? (size_t)(colon - arg) : strlen(arg);
+    if (len >= sizeof(name))
+        return 0;
+    memcpy(name, arg, len);
+    name[len] = '\0';
+    *radix = colon ? parse_radix(colon + 1) : 2;
+    if (*radix == 0)
+        return 0;
+
+    int system = 0;
+    char *end;
+    long n = strtol(name, &end, 10);
+    if (*name != '\0' && *end == '\0') {
+        system = (n >= SYS_UNSIGNED && n <= SYS_FIXED) ? (int)n : 0;
+    } else {
+        for (int i = 0; i < 7 && !system; i++) {
+            for (int j = 0; j < 3 && names[i][j]; j++) {
+                if (strcasecmp(name, names[i][j]) == 0)
+                    system = i + 1;
+            }
+        }
+    }
+    // Decimal is always base 10.
+    if (system == SYS_DECIMAL && colon && *radix != 10)
+        return 0;
+    return system;
+}
+
+/**
+ * @brief Parses a rounding mode given on the command line or at the prompt.
+ * @param arg One of "up", "down" or "even" (or the ROUNDUP/ROUNDDOWN/ROUNDTOEVEN number).
+ * @return The rounding mode, or -1 if the argument is not recognized.
+ */
+int parse_rounding(const char *arg)
+{
+    if (strcasecmp(arg, "up") == 0 || strcmp(arg, "0") == 0)
+        return ROUNDUP;
+    if (strcasecmp(arg, "down") == 0 || strcmp(arg, "1") == 0)
+        return ROUNDDOWN;
+    if (strcasecmp(arg, "even") == 0 || strcmp(arg, "2") == 0)
+        return ROUNDTOEVEN;
+    return -1;
+}
+
+/**
+ * @brief Parses an IEEE754 format given on the command line or at the prompt.
+ *
+ * e4m3 is the OCP FP8 format without infinities (also called e4m3fn); any
+ * other eXmY is an IEEE754-style format with X exponent and Y mantissa bits,
+ * and an "fn" suffix drops its infinities the same way.
+ *
+ * @param arg binary16 (half), bfloat16 (bf16), binary32 (single), binary64 (double),
+ *            e4m3, e5m2, or eXmY[fn].
+ * @param format Receives the format.
+ * @return true if the argument names a format of at most 64 bits.
+ */
+bool parse_ieee754_format(const char *arg, struct numconv_ieee754_format *format)
+{
+    static const struct {
+        const char *alias;
+        struct numconv_ieee754_format format;
+    } names[] = {
+        { "binary16", { "binary16", 5, 10, false } }, { "half", { "binary16", 5, 10, false } },
+        { "bfloat16", { "bfloat16", 8, 7, false } },  { "bf16", { "bfloat16", 8, 7, false } },
+        { "binary32", { "binary32", 8, 23, false } }, { "single", { "binary32", 8, 23, false } },
+        { "binary64", { "binary64", 11, 52, false } }, { "double", { "binary64", 11, 52, false } },
+        { "e4m3", { "e4m3", 4, 3, true } },           { "e4m3fn", { "e4m3", 4, 3, true } },
+        { "e5m2", { "e5m2", 5, 2, false } },
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcasecmp(arg, names[i].alias) == 0) {
+            *format = names[i].format;
+            return true;
+        }
+    }
+    // A custom eXmY[fn] format.
+    char *end;
+    if (*arg != 'e' && *arg != 'E')
+        return false;
+    long exp_bits = strtol(arg + 1, &end, 10);
+    if (end == arg + 1 || (*end != 'm' && *end != 'M'))
+        return false;
+    const char *mantissa = end + 1;
+    long mantissa_bits = strtol(mantissa, &end, 10);
+    if (end == mantissa || exp_bits > 64 || mantissa_bits > 64)
+        return false;
+    bool finite = strcasecmp(end, "fn") == 0;
+    if ((*end != '\0' && !finite) || !ieee754_format_supported((int)exp_bits, (int)mantissa_bits))
+        return false;
+    *format = (struct numconv_ieee754_format){ "custom", (int)exp_bits, (int)mantissa_bits, finite };
+    return true;
+}
+
+/*
+ * Conversion statistics.
+ *
+ * Once stats_start() is called, every conversion is counted under its
+ * (input system, output system, width) triple, with its errors, the
+ * allocations it made and its latency, cumulative and as a histogram of
+ * power-of-two buckets.
+ * Text conversions are timed one by one; packed elements are timed per
+ * chunk, each element counting the chunk's mean. Latency is read from the
+ * time-stamp counter on x86-64 (converted to nanoseconds against the clock
+ * when printed) and from clock_gettime() elsewhere.
+ *
+ * Each thread records into its own shard, a small open-addressed table, so
+ * recording takes no lock; stats_report() merges the shards and prints them
+ * as text or JSON. Until stats_start() is called, the only cost is one
+ * predictable branch per conversion.
+ */
+#define STATS_CELLS 256         // triples per shard; later ones share the overflow cell
+#define STATS_BUCKETS 40        // bucket k counts latencies in [2^(k-1), 2^k) ticks
+
+struct stats_cell {
+    uint32_t key;               // input << 24 | output << 16 | width (0: unused)
+    unsigned long calls, errors, allocations;
+    uint64_t ticks;
+    unsigned long histogram[STATS_BUCKETS];
+};
+
+struct stats_shard {
+    struct stats_cell cells[STATS_CELLS];
+    struct stats_cell overflow;
+    struct stats_shard *next;
+};
+
+/* Where a conversion started, for stats_end(). */
+struct stats_mark {
+    uint64_t ticks;
+    unsigned long allocations;
+};
+
+static bool stats_enabled;
+static struct stats_shard *stats_shards;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t stats_start_ticks;
+static double stats_start_ns;
+static __thread struct stats_shard *stats_local;
+static __thread unsigned long stats_allocations;
+
+static double stats_clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static inline uint64_t stats_ticks(void)
+{
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return (uint64_t)stats_clock_ns();
+#endif
+}
+
+/* Counts allocations made by the current conversion. */
+static inline void stats_count_allocations(unsigned long count)
+{
+    if (stats_enabled)
+        stats_allocations += count;
+}
+
+static inline void stats_begin(struct stats_mark *mark)
+{
+    mark->ticks = stats_ticks();
+    mark->allocations = stats_allocations;
+}
+
+/**
+ * @brief Records count conversions of one triple that started at mark, errors of them failing.
+ */
+static void stats_end(const struct stats_mark *mark, int inputSystem, int outputSystem, unsigned int width,
+                      unsigned long count, unsigned long errors)
+{
+    uint64_t elapsed = stats_ticks() - mark->ticks;
+    struct stats_shard *shard = stats_local;
+    if (shard == NULL) {
+        shard = calloc(1, sizeof(*shard));
+        if (shard == NULL)
+            return;
+        pthread_mutex_lock(&stats_lock);
+        shard->next = stats_shards;
+        stats_shards = shard;
+        pthread_mutex_unlock(&stats_lock);
+        stats_local = shard;
+    }
+    uint32_t key = (uint32_t)inputSystem << 24 | (uint32_t)outputSystem << 16 | (width > 0xFFFF ? 0xFFFF : width);
+    struct stats_cell *cell = &shard->overflow;
+    for (uint32_t i = 0, h = (key * 2654435761u) >> 24; i < STATS_CELLS; i++, h = (h + 1) % STATS_CELLS) {
+        if (shard->cells[h].key == key || shard->cells[h].key == 0) {
+            cell = &shard->cells[h];
+            cell->key = key;
+            break;
+        }
+    }
+    uint64_t each = count ? elapsed / count : elapsed;
+    int bucket = each ? 64 - __builtin_clzll(each) : 0;
+    cell->calls += count;
+    cell->errors += errors;
+    cell->allocations += stats_allocations - mark->allocations;
+    cell->ticks += elapsed;
+    cell->histogram[bucket < STATS_BUCKETS ? bucket : STATS_BUCKETS - 1] += count;
+}
+
+/* Merges a cell into the first cell of cells[0..*n) with the same key, or appends it. */
+static void stats_merge(struct stats_cell *cells, size_t *n, const struct stats_cell *c)
+{
+    size_t i = 0;
+    while (i < *n && cells[i].key != c->key)
+        i++;
+    if (i == *n)
+        memset(&cells[(*n)++], 0, sizeof(cells[0]));
+    cells[i].key = c->key;
+    cells[i].calls += c->calls;
+    cells[i].errors += c->errors;
+    cells[i].allocations += c->allocations;
+    cells[i].ticks += c->ticks;
+    for (int b = 0; b < STATS_BUCKETS; b++)
+        cells[i].histogram[b] += c->histogram[b];
+}
+
+/* Orders cells by input system, output system and width. */
+static int stats_compare(const void *a, const void *b)
+{
+    uint32_t x = ((const struct stats_cell *)a)->key, y = ((const struct stats_cell *)b)->key;
+    return (x > y) - (x < y);
+}
+
+/* The upper bound, in ticks, of the bucket holding the given fraction of a cell's calls. */
+static uint64_t stats_percentile(const struct stats_cell *c, double fraction)
+{
+    unsigned long seen = 0, want = (unsigned long)ceil(fraction * (double)c->calls);
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        seen += c->histogram[b];
+        if (seen >= want && seen > 0)
+            return (uint64_t)1 << b;
+    }
+    return (uint64_t)1 << (STATS_BUCKETS - 1);
+}
+
+static const char *stats_system_name(unsigned int system)
+{
+    static const char *const names[] = { "?", "unsigned", "signmag", "ones", "twos", "ieee754", "decimal", "fixed" };
+    return system <= SYS_FIXED ? names[system] : names[0];
+}
+
+/**
+ * @brief Prints the statistics gathered so far, as text or JSON.
+ *
+ * Shards are read while their threads may still be recording, so a report
+ * taken in the middle of a run can trail it by a few conversions.
+ *
+ * @param out The stream to print on.
+ * @param json Whether to print JSON rather than a text table.
+ */
+void stats_report(FILE *out, bool json)
+{
+    if (!stats_enabled)
+        return;
+    pthread_mutex_lock(&stats_lock);
+    size_t n = 0, cap = 0;
+    for (struct stats_shard *s = stats_shards; s; s = s->next)
+        cap += STATS_CELLS + 1;
+    struct stats_cell *cells = calloc(cap ? cap : 1, sizeof(*cells));
+    if (cells == NULL) {
+        pthread_mutex_unlock(&stats_lock);
+        return;
+    }
+    for (struct stats_shard *s = stats_shards; s; s = s->next) {
+        for (int i = 0; i < STATS_CELLS; i++) {
+            if (s->cells[i].key)
+                stats_merge(cells, &n, &s->cells[i]);
+        }
+        if (s->overflow.calls)
+            stats_merge(cells, &n, &s->overflow);
+    }
+    qsort(cells, n, sizeof(*cells), stats_compare);
+
+    // Nanoseconds per tick, from the ticks and the clock elapsed since stats_start().
+    double elapsed_ns = stats_clock_ns() - stats_start_ns;
+    uint64_t elapsed_ticks = stats_ticks() - stats_start_ticks;
+    double ns_per_tick = elapsed_ticks ? elapsed_ns / (double)elapsed_ticks : 1.0;
+    if (json)
+        fprintf(out, "{\"elapsed_ms\": %.3f, \"conversions\": [", elapsed_ns / 1e6);
+    else
+        fprintf(out, "# conversion statistics after %.3f s\n%-9s %-9s %6s %12s %10s %10s %12s %10s %10s %10s\n",
+                elapsed_ns / 1e9, "input", "output", "width", "calls", "errors", "allocs", "total_ms", "mean_ns",
+                "p50_ns", "p99_ns");
+    for (size_t i = 0; i < n; i++) {
+        const struct stats_cell *c = &cells[i];
+        unsigned int in = c->key >> 24, outsys = (c->key >> 16) & 0xFF, width = c->key & 0xFFFF;
+        double total_ns = (double)c->ticks * ns_per_tick;
+        double mean_ns = c->calls ? total_ns / (double)c->calls : 0;
+        double p50 = (double)stats_percentile(c, 0.5) * ns_per_tick;
+        double p99 = (double)stats_percentile(c, 0.99) * ns_per_tick;
+        if (json) {
+            fprintf(out, "%s\n  {\"input\": \"%s\", \"output\": \"%s\", \"width\": %u, \"calls\": %lu, "
+                    "\"errors\": %lu, \"allocations\": %lu, \"total_ns\": %.0f, \"mean_ns\": %.1f, "
+                    "\"p50_ns\": %.0f, \"p99_ns\": %.0f, \"histogram\": [",
+                    i ? "," : "", stats_system_name(in), stats_system_name(outsys), width, c->calls, c->errors,
+                    c->allocations, total_ns, mean_ns, p50, p99);
+            bool first = true;
+            for (int b = 0; b < STATS_BUCKETS; b++) {
+                if (c->histogram[b]) {
+                    fprintf(out, "%s{\"le_ns\": %.0f, \"count\": %lu}", first ? "" : ", ",
+                            (double)((uint64_t)1 << b) * ns_per_tick, c->histogram[b]);
+                    first = false;
+                }
+            }
+            fprintf(out, "]}");
+        } else {
+            char width_text[16];
+            snprintf(width_text, sizeof(width_text), width ? "%u" : "-", width);
+            fprintf(out, "%-9s %-9s %6s %12lu %10lu %10lu %12.3f %10.1f %10.0f %10.0f\n", stats_system_name(in),
+                    stats_system_name(outsys), width_text, c->calls, c->errors, c->allocations, total_ns / 1e6,
+                    mean_ns, p50, p99);
+            fprintf(out, "  histogram:");
+            for (int b = 0; b < STATS_BUCKETS; b++) {
+                if (c->histogram[b])
+                    fprintf(out, " <=%.0fns:%lu", (double)((uint64_t)1 << b) * ns_per_tick, c->histogram[b]);
+            }
+            fputc('\n', out);
+        }
+    }
+    if (json)
+        fprintf(out, "%s]}\n", n ? "\n" : "");
+    fflush(out);
+    free(cells);
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/**
+ * @brief Starts counting every conversion made from now on, in every thread.
+ */
+void stats_start(void)
+{
+    // Build the power-of-five tables now, so their one-time cost is not billed to the first decimal conversion.
+    decimal_tables();
+    stats_start_ns = stats_clock_ns();
+    stats_start_ticks = stats_ticks();
+    stats_enabled = true;
+}
+
+/*
+ * Conversion contexts.
+ *
+ * A context holds everything a stream of conversions shares: the systems
+ * and their radixes, the output width, the IEEE754 and fixed-point formats
+ * and rounding mode, and whether values are lines of text or packed elements. It is set
+ * up once and only read afterwards, so any number of threads can convert
+ * with the same context.
+ */
+struct numconv {
+    int inputSystem;
+    int outputSystem;
+    unsigned int in_radix;      // radix of binary input and output digits
+    unsigned int out_radix;
+    unsigned int numbits;
+    int rounding_mode;
+    struct numconv_ieee754_format in_format;    // formats of IEEE754 input and output
+    struct numconv_ieee754_format out_format;
+    struct numconv_fixed_format in_fixed;       // formats of fixed-point input and output
+    struct numconv_fixed_format out_fixed;
+    unsigned int in_bytes;      // element size of packed input, 0 for lines of text
+    bool packed_out;            // packed output elements instead of lines of text
+    bool checked;               // batches track the status of every value
+    unsigned int fail;          // NUMCONV_* flags that make a checked value fail
+};
+
+const struct numconv_ieee754_format numconv_binary32 = { "binary32", 8, 23, false };
+const struct numconv_fixed_format numconv_q15 = { 0, 15, false };
+
+static size_t fixed_output_size(const struct numconv *conv);
+static char *convert_fixed_digits(const struct numconv *conv, const char *text, size_t len, char *out,
+                                  size_t outlen, const char **error);
+
+/**
+ * @brief Creates a context converting from one system to another.
+ *
+ * The context starts with binary digits, the input width for integer
+ * output, binary32 for IEEE754, Q15 for fixed point, round to nearest
+ * even, and lines of text.
+ *
+ * @param inputSystem The input system (SYS_UNSIGNED .. SYS_FIXED).
+ * @param outputSystem The output system (SYS_UNSIGNED .. SYS_FIXED).
+ * @return The context, or NULL for an unknown system or if it cannot be allocated.
+ */
+struct numconv *numconv_new(int inputSystem, int outputSystem)
+{
+    if (inputSystem < SYS_UNSIGNED || inputSystem > SYS_FIXED || outputSystem < SYS_UNSIGNED ||
+        outputSystem > SYS_FIXED)
+        return NULL;
+    struct numconv *conv = calloc(1, sizeof(*conv));
+    if (conv == NULL)
+        return NULL;
+    conv->inputSystem = inputSystem;
+    conv->outputSystem = outputSystem;
+    conv->in_radix = conv->out_radix = 2;
+    conv->rounding_mode = ROUNDTOEVEN;
+    conv->in_format = conv->out_format = numconv_binary32;
+    conv->in_fixed = conv->out_fixed = numconv_q15;
+    return conv;
+}
+
+void numconv_free(struct numconv *conv)
+{
+    free(conv);
+}
+
+/**
+ * @brief Sets the radix of the digits of binary input and output (2 unless set).
+ * @return false, leaving the context unchanged, unless both radixes are 2-36.
+ */
+bool numconv_set_radix(struct numconv *conv, unsigned int in_radix, unsigned int out_radix)
+{
+    if (in_radix < 2 || in_radix > 36 || out_radix < 2 || out_radix > 36)
+        return false;
+    conv->in_radix = in_radix;
+    conv->out_radix = out_radix;
+    return true;
+}
+
+/**
+ * @brief Sets the width of integer output; 0 (the default) keeps the width of binary input.
+ */
+void numconv_set_width(struct numconv *conv, unsigned int numbits)
+{
+    conv->numbits = numbits;
+}
+
+/**
+ * @brief Sets the rounding mode of IEEE754 and fixed-point output.
+ * @return false, leaving the context unchanged, unless the mode is ROUNDUP, ROUNDDOWN or ROUNDTOEVEN.
+ */
+bool numconv_set_rounding(struct numconv *conv, int rounding_mode)
+{
+    if (rounding_mode != ROUNDUP && rounding_mode != ROUNDDOWN && rounding_mode != ROUNDTOEVEN)
+        return false;
+    conv->rounding_mode = rounding_mode;
+    return true;
+}
+
+/**
+ * @brief Sets the formats of IEEE754 input and output (see parse_ieee754_format()).
+ */
+void numconv_set_formats(struct numconv *conv, const struct numconv_ieee754_format *in_format,
+                         const struct numconv_ieee754_format *out_format)
+{
+    conv->in_format = *in_format;
+    conv->out_format = *out_format;
+}
+
+/**
+ * @brief Sets the formats of fixed-point input and output (see parse_fixed_format()).
+ */
+void numconv_set_fixed(struct numconv *conv, const struct numconv_fixed_format *in_fixed,
+                       const struct numconv_fixed_format *out_fixed)
+{
+    conv->in_fixed = *in_fixed;
+    conv->out_fixed = *out_fixed;
+}
+
+/**
+ * @brief Chooses packed little-endian elements instead of lines of text.
+ * @param conv The context.
+ * @param in_bytes Size of an input element: 1, 2, 4 or 8 bytes, or 0 for lines of text.
+ *                 IEEE754 and fixed-point input elements must be the size of the input format.
+ * @param packed_out Whether each result is written as a little-endian integer of
+ *                   numconv_packed_size() bytes instead of a line of text.
+ */
+void numconv_set_packed(struct numconv *conv, unsigned int in_bytes, bool packed_out)
+{
+    conv->in_bytes = in_bytes;
+    conv->packed_out = packed_out;
+}
+
+/**
+ * @brief Makes batches check every value (see numconv_convert_status()).
+ *
+ * A checked batch counts the values raising each flag in batch->flagged,
+ * gives every failure its flags, and fails the values raising any flag in
+ * fail as if they could not be converted. Checking costs a little per
+ * value, and packed batches give up the bulk kernels for it.
+ *
+ * @param conv The context.
+ * @param checked Whether to check; contexts start unchecked.
+ * @param fail NUMCONV_OVERFLOW, NUMCONV_TRUNCATED and NUMCONV_INEXACT flags that fail a value, or 0.
+ */
+void numconv_set_checked(struct numconv *conv, bool checked, unsigned int fail)
+{
+    conv->checked = checked;
+    conv->fail = checked ? fail & (NUMCONV_OVERFLOW | NUMCONV_TRUNCATED | NUMCONV_INEXACT) : 0;
+}
+
+/* Width of the output pattern: the output format's, the set width, or that of packed or fixed-point input. */
+static unsigned int numconv_out_bits(const struct numconv *conv)
+{
+    if (conv->outputSystem == SYS_IEEE754)
+        return (unsigned int)(1 + conv->out_format.exp_bits + conv->out_format.mantissa_bits);
+    if (conv->outputSystem == SYS_FIXED)
+        return fixed_format_bits(&conv->out_fixed);
+    if (conv->numbits == 0 && conv->inputSystem == SYS_FIXED)
+        return fixed_format_bits(&conv->in_fixed);
+    return conv->numbits ? conv->numbits : 8 * conv->in_bytes;
+}
+
+/**
+ * @brief The size of a packed output element: (width + 7) / 8 bytes, or 0 for lines of text.
+ */
+unsigned int numconv_packed_size(const struct numconv *conv)
+{
+    return conv->packed_out ? (numconv_out_bits(conv) + 7) / 8 : 0;
+}
+
+/**
+ * @brief Checks that a context describes a conversion it can carry out.
+ * @param conv The context.
+ * @param error Set to a message describing the problem when false is returned.
+ * @return true if the context can convert.
+ */
+bool numconv_check(const struct numconv *conv, const char **error)
+{
+    const int inputSystem = conv->inputSystem, outputSystem = conv->outputSystem;
+    const unsigned int in_bits = (unsigned int)(1 + conv->in_format.exp_bits + conv->in_format.mantissa_bits);
+    const unsigned int out_bits = numconv_out_bits(conv);
+    if (conv->in_bytes != 0 && conv->in_bytes != 1 && conv->in_bytes != 2 && conv->in_bytes != 4 &&
+        conv->in_bytes != 8) {
+        *error = "packed input elements are 1, 2, 4 or 8 bytes";
+        return false;
+    }
+    if (conv->in_bytes && inputSystem == SYS_DECIMAL) {
+        *error = "packed input needs a binary input system";
+        return false;
+    }
+    if (conv->in_bytes && inputSystem == SYS_IEEE754 && (in_bits + 7) / 8 != conv->in_bytes) {
+        *error = "packed float input elements must be the size of the IEEE754 input format";
+        return false;
+    }
+    if (conv->in_bytes && inputSystem == SYS_FIXED &&
+        (fixed_format_bits(&conv->in_fixed) + 7) / 8 != conv->in_bytes) {
+        *error = "packed fixed-point input elements must be the size of the fixed-point input format";
+        return false;
+    }
+    if ((conv->in_bytes && conv->in_radix != 2) || (conv->packed_out && conv->out_radix != 2)) {
+        *error = "packed input and output have no digits to give a radix";
+        return false;
+    }
+    if (conv->packed_out && (outputSystem == SYS_DECIMAL || out_bits == 0 || out_bits > 64)) {
+        *error = "packed output needs a binary output system and a width of at most 64 bits";
+        return false;
+    }
+    if (conv->in_bytes && outputSystem != SYS_DECIMAL && out_bits > 64) {
+        *error = "packed input converts to widths of at most 64 bits";
+        return false;
+    }
+    if (inputSystem == SYS_DECIMAL && outputSystem != SYS_IEEE754 && outputSystem != SYS_DECIMAL &&
+        outputSystem != SYS_FIXED && conv->numbits == 0) {
+        *error = "decimal input needs an output width";
+        return false;
+    }
+    if (inputSystem == SYS_FIXED && outputSystem <= SYS_TWOS_COMPLEMENT && conv->numbits > 64) {
+        *error = "fixed-point input converts to integer widths of at most 64 bits";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Computes the buffer size numconv_convert() needs for a value of len characters.
+ */
+size_t numconv_output_size(const struct numconv *conv, size_t len)
+{
+    if (conv->inputSystem == SYS_FIXED || conv->outputSystem == SYS_FIXED)
+        return fixed_output_size(conv);
+    return convert_output_size_radix(len, conv->inputSystem, conv->in_radix, conv->outputSystem, conv->numbits,
+                                     &conv->in_format, &conv->out_format);
+}
+
+/**
+ * @brief Converts one value given as text, as convert_number_radix() does, or
+ *        convert_fixed_bits() for the digits of a pattern when either side is fixed point.
+ * @param conv The context.
+ * @param text The value, which need not be null-terminated.
+ * @param len Length of the value.
+ * @param out Buffer for the result.
+ * @param outlen Size of out: numconv_output_size() bytes are always enough.
+ * @param error Set to a message describing the failure when NULL is returned.
+ * @return out, or NULL if the value cannot be converted.
+ */
+char *numconv_convert(const struct numconv *conv, const char *text, size_t len, char *out, size_t outlen,
+                      const char **error)
+{
+    const int inputSystem = conv->inputSystem, outputSystem = conv->outputSystem;
+    if (inputSystem != SYS_FIXED && outputSystem != SYS_FIXED)
+        return convert_number_radix(text, len, inputSystem, conv->in_radix, outputSystem, conv->out_radix,
+                                    conv->numbits, &conv->in_format, &conv->out_format, conv->rounding_mode, out,
+                                    outlen, error);
+    if (!stats_enabled)
+        return convert_fixed_digits(conv, text, len, out, outlen, error);
+    struct stats_mark mark;
+    stats_begin(&mark);
+    char *result = convert_fixed_digits(conv, text, len, out, outlen, error);
+    stats_end(&mark, inputSystem, outputSystem,
+              fixed_format_bits(inputSystem == SYS_FIXED ? &conv->in_fixed : &conv->out_fixed), 1, result == NULL);
+    return result;
+}
+
+/**
+ * @brief Converts one value as numconv_convert() does, and reports what the conversion lost.
+ *
+ * The result is the same one numconv_convert() gives, saturated, truncated
+ * or rounded as usual; the status says which of those happened.
+ *
+ * @param conv The context.
+ * @param text The value, which need not be null-terminated.
+ * @param len Length of the value.
+ * @param out Buffer for the result.
+ * @param outlen Size of out: numconv_output_size() bytes are always enough.
+ * @param error Set to a message describing the failure when NUMCONV_FAILED is returned.
+ * @return The value's NUMCONV_* flags: 0 for an exact result; with NUMCONV_FAILED
+ *         there is no result, and NUMCONV_INVALID or NUMCONV_OVERFLOW says why
+ *         unless memory ran out.
+ */
+unsigned int numconv_convert_status(const struct numconv *conv, const char *text, size_t len, char *out,
+                                    size_t outlen, const char **error)
+{
+    status_flags = 0;
+    status_checking = true;
+    bool ok = numconv_convert(conv, text, len, out, outlen, error) != NULL;
+    status_checking = false;
+    return status_flags | (unsigned int)!ok * NUMCONV_FAILED;
+}
+
+/**
+ * @brief Describes why a converted value with these NUMCONV_* flags fails its checks.
+ * @return A message for the lowest of the OVERFLOW, TRUNCATED and INEXACT flags, or NULL if none is set.
+ */
+const char *numconv_status_message(unsigned int status)
+{
+    if (status & NUMCONV_OVERFLOW)
+        return "Value out of range of the output.";
+    if (status & NUMCONV_TRUNCATED)
+        return "Value has a fraction an integer output drops.";
+    if (status & NUMCONV_INEXACT)
+        return "Value cannot be represented exactly in the output format.";
+    return NULL;
+}
+
+/*
+ * Result cache.
+ *
+ * Streams of readings repeat the same few thousand values over and over, so
+ * each converting thread can keep the results of the lines it has seen in a
+ * bounded open-addressing table. A slot holds the line and its result side by
+ * side in two cache lines, and a lookup is one hash and a short linear probe.
+ * A cache serves one configuration at a time: it keeps a copy of the context
+ * it was last used with, and using it with another empties it, so the
+ * systems, width, rounding and formats are part of every key without being
+ * stored. Only successful conversions whose line and longest possible result
+ * fit in a slot are cached, with their status when the context is checked; a
+ * full neighbourhood evicts one of its slots in turn.
+ */
+#define CACHE_PROBES 8
+
+struct cache_entry {
+    uint32_t tag;           // high bits of the line's hash, never 0; 0 marks an empty slot
+    uint8_t key_len;
+    uint8_t result_len;
+    uint8_t status;         // NUMCONV_* flags of a checked conversion
+    char text[121];         // the line, then its result, neither terminated
+};
+
+struct numconv_cache {
+    struct cache_entry *slots;
+    size_t mask;
+    unsigned long hits, misses;
+    struct numconv owner;   // the configuration the cached results belong to
+    bool owned;
+};
+
+/**
+ * @brief Creates an empty result cache, for use by one thread at a time.
+ * @param entries Number of lines to remember. The table gets at least twice
+ *                as many slots, a power of two: probes grow long, and mispredict,
+ *                in a fuller table.
+ * @return The cache, or NULL if it cannot be allocated.
+ */
+struct numconv_cache *numconv_cache_new(unsigned long entries)
+{
+    size_t n = CACHE_PROBES;
+    while (n / 2 < entries && n <= SIZE_MAX / 2 / sizeof(struct cache_entry))
+        n *= 2;
+    struct numconv_cache *cache = calloc(1, sizeof(*cache));
+    if (cache == NULL)
+        return NULL;
+    // Anonymous pages come zeroed and aligned, and a large table is only paged in as it fills.
+    void *slots = mmap(NULL, n * sizeof(struct cache_entry), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                       -1, 0);
+    if (slots == MAP_FAILED) {
+        free(cache);
+        return NULL;
+    }
+    cache->slots = slots;
+    cache->mask = n - 1;
+    return cache;
+}
+
+void numconv_cache_free(struct numconv_cache *cache)
+{
+    if (cache == NULL)
+        return;
+    munmap(cache->slots, (cache->mask + 1) * sizeof(struct cache_entry));
+    free(cache);
+}
+
+/**
+ * @brief Reports how many lookups a cache has answered and missed.
+ */
+void numconv_cache_counts(const struct numconv_cache *cache, unsigned long *hits, unsigned long *misses)
+{
+    *hits = cache->hits;
+    *misses = cache->misses;
+}
+
+/* Whether two contexts convert every line to the same result. */
+static bool numconv_same(const struct numconv *a, const struct numconv *b)
+{
+    return a->inputSystem == b->inputSystem && a->outputSystem == b->outputSystem &&
+           a->in_radix == b->in_radix && a->out_radix == b->out_radix && a->numbits == b->numbits &&
+           a->rounding_mode == b->rounding_mode && a->in_format.exp_bits == b->in_format.exp_bits &&
+           a->in_format.mantissa_bits == b->in_format.mantissa_bits &&
+           a->in_format.finite == b->in_format.finite && a->out_format.exp_bits == b->out_format.exp_bits &&
+           a->out_format.mantissa_bits == b->out_format.mantissa_bits &&
+           a->out_format.finite == b->out_format.finite && a->in_fixed.int_bits == b->in_fixed.int_bits &&
+           a->in_fixed.frac_bits == b->in_fixed.frac_bits && a->in_fixed.is_unsigned == b->in_fixed.is_unsigned &&
+           a->out_fixed.int_bits == b->out_fixed.int_bits && a->out_fixed.frac_bits == b->out_fixed.frac_bits &&
+           a->out_fixed.is_unsigned == b->out_fixed.is_unsigned && a->checked == b->checked;
+}
+
+/* Hands the cache to a context, emptying it if it holds another configuration's results. */
+static void cache_claim(struct numconv_cache *cache, const struct numconv *conv)
+{
+    if (cache->owned && numconv_same(&cache->owner, conv))
+        return;
+    if (cache->owned)
+        memset(cache->slots, 0, (cache->mask + 1) * sizeof(struct cache_entry));
+    cache->owner = *conv;
+    cache->owned = true;
+}
+
+/* Hashes a line 8 bytes at a time. */
+static uint64_t cache_hash(const char *p, size_t n)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ n, w;
+    for (; n >= 8; p += 8, n -= 8) {
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 29;
+    }
+    if (n) {
+        w = 0;
+        memcpy(&w, p, n);
+        h = (h ^ w) * 0xBF58476D1CE4E5B9ull;
+    }
+    h ^= h >> 32;
+    h *= 0x94D049BB133111EBull;
+    return h ^ (h >> 29);
+}
+
+/**
+ * @brief Looks a line up in the cache.
+ * @param cache The cache.
+ * @param line The line, not terminated.
+ * @param len Length of the line.
+ * @param hash The line's cache_hash().
+ * @return The slot holding the line's result, or NULL on a miss.
+ */
+static const struct cache_entry *cache_find(struct numconv_cache *cache, const char *line, size_t len,
+                                            uint64_t hash)
+{
+    uint32_t tag = (uint32_t)(hash >> 32) | 1;
+    for (size_t i = 0; i < CACHE_PROBES; i++) {
+        const struct cache_entry *e = &cache->slots[(hash + i) & cache->mask];
+        if (e->tag == 0)
+            break;
+        if (e->tag == tag && e->key_len == len && memcmp(e->text, line, len) == 0) {
+            cache->hits++;
+            return e;
+        }
+    }
+    cache->misses++;
+    return NULL;
+}
+
+/*
+ * Copies a cached result 8 bytes at a time. Results are short and of every
+ * length, which is the worst case for the library memcpy().
+ */
+static inline void cache_copy(char *dst, const char *src, size_t n)
+{
+    uint64_t w;
+    for (; n >= 8; dst += 8, src += 8, n -= 8) {
+        memcpy(&w, src, 8);
+        memcpy(dst, &w, 8);
+    }
+    while (n--)
+        *dst++ = *src++;
+}
+
+/* Remembers a line's result; the caller checks that the two fit in a slot. */
+static void cache_store(struct numconv_cache *cache, const char *line, size_t len, uint64_t hash,
+                        const char *result, size_t result_len, unsigned int status)
+{
+    struct cache_entry *e = &cache->slots[(hash + cache->misses % CACHE_PROBES) & cache->mask];
+    for (size_t i = 0; i < CACHE_PROBES; i++) {
+        if (cache->slots[(hash + i) & cache->mask].tag == 0) {
+            e = &cache->slots[(hash + i) & cache->mask];
+            break;
+        }
+    }
+    e->tag = (uint32_t)(hash >> 32) | 1;
+    e->key_len = (uint8_t)len;
+    e->result_len = (uint8_t)result_len;
+    e->status = (uint8_t)status;
+    cache_copy(e->text, line, len);
+    cache_copy(e->text + len, result, result_len);
+}
+
+/*
+ * Bulk conversion.
+ *
+ * numconv_convert_batch() converts a whole block of values in one call:
+ * lines of text, or packed elements converted with convert_bits() and the
+ * bulk kernels so no text is ever formatted or parsed. Every value gets its
+ * place in the output, failed ones included, and the failures are listed by
+ * index, so a caller can convert blocks on many threads and still write
+ * them back in order.
+ */
+
+static bool batch_reserve(struct numconv_batch *b, size_t need)
+{
+    if (need <= b->out_cap)
+        return true;
+    size_t new_cap = b->out_cap ? b->out_cap : 4096;
+    while (new_cap < need)
+        new_cap *= 2;
+    char *grown = realloc(b->out, new_cap);
+    if (!grown)
+        return false;
+    b->out = grown;
+    b->out_cap = new_cap;
+    return true;
+}
+
+/* Lists the value at index b->count as failed, with its status in a checked context. */
+static bool batch_add_error(struct numconv_batch *b, const char *error, unsigned int status)
+{
+    if (b->nerrors == b->errors_cap) {
+        size_t cap = b->errors_cap ? b->errors_cap * 2 : 16;
+        struct numconv_error *grown = realloc(b->errors, cap * sizeof(*grown));
+        if (!grown)
+            return false;
+        b->errors = grown;
+        b->errors_cap = cap;
+    }
+    b->errors[b->nerrors].index = b->count;
+    b->errors[b->nerrors].message = error;
+    b->errors[b->nerrors].status = status;
+    b->nerrors++;
+    return true;
+}
+
+/*
+ * Counts a checked value's flags, failing a converted value that raises one
+ * the context fails on, and returns its final status.
+ */
+static unsigned int batch_check(const struct numconv *conv, struct numconv_batch *b, unsigned int status,
+                                const char **error)
+{
+    if (!(status & NUMCONV_FAILED) && (status & conv->fail)) {
+        *error = numconv_status_message(status & conv->fail);
+        status |= NUMCONV_FAILED;
+    }
+    for (int k = 0; k < NUMCONV_STATUS_BITS; k++)
+        b->flagged[k] += (status >> k) & 1;
+    return status;
+}
+
+/**
+ * @brief Converts a block of packed input elements, to packed output or to lines of text.
+ */
+static bool batch_convert_packed(const struct numconv *conv, const char *data, size_t len,
+                                 struct numconv_batch *b)
+{
+    const char *error;
+    const int inputSystem = conv->inputSystem, outputSystem = conv->outputSystem;
+    const unsigned int in_bytes = conv->in_bytes, out_bytes = numconv_packed_size(conv);
+    const struct numconv_ieee754_format *in_format = &conv->in_format, *out_format = &conv->out_format;
+    const bool fixed = inputSystem == SYS_FIXED || outputSystem == SYS_FIXED;
+    const unsigned int width = (inputSystem == SYS_IEEE754) ? (unsigned int)(1 + in_format->exp_bits +
+                                                                             in_format->mantissa_bits)
+                               : (inputSystem == SYS_FIXED) ? fixed_format_bits(&conv->in_fixed)
+                                                            : 8 * in_bytes;
+    const unsigned int outbits = (outputSystem == SYS_IEEE754)
+                                     ? (unsigned int)(1 + out_format->exp_bits + out_format->mantissa_bits)
+                                 : (outputSystem == SYS_FIXED) ? fixed_format_bits(&conv->out_fixed)
+                                                               : (conv->numbits ? conv->numbits : width);
+    size_t count = len / in_bytes;
+    const bool integer = inputSystem != SYS_IEEE754 && inputSystem != SYS_FIXED && outputSystem >= SYS_UNSIGNED &&
+                         outputSystem <= SYS_TWOS_COMPLEMENT;
+    const bool checked = conv->checked;
+    size_t per_element = out_bytes ? out_bytes
+                         : fixed ? fixed_output_size(conv) + 5
+                                 : convert_output_size(width, inputSystem, outputSystem, outbits, out_format) + 5;
+    if (!batch_reserve(b, count * per_element + sizeof("error\n")))
+        return false;
+    const char *src = data;
+    char *dst = b->out;
+    // The bulk kernels report failures but no status, so checked batches convert element by element.
+    if (integer && out_bytes && !checked) {
+        // Packed integers to packed integers: the bulk kernel, stopping only at failed elements.
+        size_t i = 0;
+        while (i < count) {
+            i += transcode_packed_integers(src + i * in_bytes, count - i, in_bytes, inputSystem, outputSystem,
+                                           outbits, dst + i * out_bytes, out_bytes);
+            if (i < count) {
+                b->count = i++;
+                if (!batch_add_error(b, "Cannot represent a negative number in an unsigned binary system.", 0))
+                    return false;
+            }
+        }
+        dst += count * out_bytes;
+        count = 0;
+    } else if (inputSystem == SYS_IEEE754 && outputSystem == SYS_IEEE754 && out_bytes && !checked) {
+        // Packed floats to packed floats: the bulk down-conversion, stopping only at NaN inputs.
+        size_t i = 0;
+        while (i < count) {
+            i += transcode_packed_floats(src + i * in_bytes, count - i, in_format, out_format, conv->rounding_mode,
+                                         dst + i * out_bytes);
+            if (i < count) {
+                b->count = i++;
+                if (!batch_add_error(b, "Invalid IEEE754 number.", 0))
+                    return false;
+            }
+        }
+        dst += count * out_bytes;
+        count = 0;
+    } else if (inputSystem == SYS_IEEE754 && outputSystem == SYS_FIXED && out_bytes && !checked) {
+        // Packed floats to packed fixed point: the bulk quantizer, stopping only at NaN inputs.
+        size_t i = 0;
+        while (i < count) {
+            i += quantize_packed_floats(src + i * in_bytes, count - i, in_format, &conv->out_fixed,
+                                        conv->rounding_mode, dst + i * out_bytes);
+            if (i < count) {
+                b->count = i++;
+                if (!batch_add_error(b, "Invalid IEEE754 number.", 0))
+                    return false;
+            }
+        }
+        dst += count * out_bytes;
+        count = 0;
+    } else if (inputSystem == SYS_FIXED && outputSystem == SYS_IEEE754 && out_bytes && !checked) {
+        // Packed fixed point to packed floats, which never fails.
+        dequantize_packed(src, count, &conv->in_fixed, out_format, conv->rounding_mode, dst);
+        dst += count * out_bytes;
+        count = 0;
+    }
+    for (size_t i = 0; i < count; i++, src += in_bytes) {
+        unsigned long bits = load_packed(src, in_bytes), result = 0;
+        unsigned int status = 0;
+        bool ok;
+        status_flags = 0;
+        status_checking = checked;
+        if (outputSystem == SYS_DECIMAL && inputSystem == SYS_FIXED) {
+            ok = true;
+            format_fixed_decimal(bits, &conv->in_fixed, dst, per_element);
+            dst += strlen(dst);
+            *dst++ = '\n';
+        } else if (outputSystem == SYS_DECIMAL) {
+            // Decimal text needs the decoded value rather than an output pattern; it is always exact.
+            long value;
+            double dvalue;
+            ok = decode_bits(bits, width, inputSystem, in_format, &value, &dvalue, &error);
+            if (ok) {
+                format_decimal(inputSystem, value, dvalue, in_format, dst, per_element);
+                dst += strlen(dst);
+                *dst++ = '\n';
+            }
+        } else if (fixed) {
+            ok = convert_fixed_bits(bits, width, inputSystem, outputSystem, outbits, in_format, out_format,
+                                    &conv->in_fixed, &conv->out_fixed, conv->rounding_mode, &result, &error);
+        } else if (integer) {
+            ok = transcode_integer_bits(bits, width, inputSystem, outputSystem, outbits, &result);
+            error = "Cannot represent a negative number in an unsigned binary system.";
+        } else {
+            ok = convert_bits(bits, width, inputSystem, outputSystem, outbits, in_format, out_format,
+                              conv->rounding_mode, &result, &error);
+        }
+        status_checking = false;
+        if (checked) {
+            status = batch_check(conv, b, status_flags | (unsigned int)!ok * NUMCONV_FAILED, &error);
+            ok = !(status & NUMCONV_FAILED);
+        }
+        if (ok && outputSystem != SYS_DECIMAL && out_bytes) {
+            store_packed(dst, result, out_bytes);
+            dst += out_bytes;
+        } else if (ok && outputSystem != SYS_DECIMAL) {
+            dst += emit_radix_digits(result, outbits, conv->out_radix, dst);
+            *dst++ = '\n';
+        }
+        if (!ok) {
+            b->count = i;
+            if (!batch_add_error(b, error, status))
+                return false;
+            // Failed elements keep their place: zeros when packed, "error" as text.
+            if (out_bytes) {
+                memset(dst, 0, out_bytes);
+                dst += out_bytes;
+            } else {
+                memcpy(dst, "error\n", 6);
+                dst += 6;
+            }
+        }
+    }
+    b->count = len / in_bytes;
+    if (len % in_bytes != 0) {
+        error = "Truncated element at the end of the input.";
+        unsigned int status = checked ? batch_check(conv, b, NUMCONV_INVALID | NUMCONV_FAILED, &error) : 0;
+        if (!batch_add_error(b, error, status))
+            return false;
+        b->count++;
+    }
+    b->out_len = (size_t)(dst - b->out);
+    return true;
+}
+
+/**
+ * @brief Converts a block of values in one call.
+ *
+ * Lines of text are separated by '\n' (a trailing "\r" is ignored) and
+ * give one line of text, or one packed element, each; packed input gives
+ * the same for each element, and a partial element at the end fails. A
+ * value that fails to convert is listed in batch->errors and its place in
+ * the output holds "error", or zeros when packed. A checked context (see
+ * numconv_set_checked()) also counts the flags of every value.
+ *
+ * @param conv The context, which numconv_check() accepts.
+ * @param cache The calling thread's result cache for lines of text, or NULL.
+ * @param data The values; the buffer is only read.
+ * @param len Size of data in bytes.
+ * @param batch Receives the output, the failures and the number of values.
+ * @return true on success, false if memory ran out.
+ */
+bool numconv_convert_batch(const struct numconv *conv, struct numconv_cache *cache, const char *data, size_t len,
+                           struct numconv_batch *batch)
+{
+    const char *error;
+    const char *p = data, *end = data + len;
+    const unsigned int out_bytes = numconv_packed_size(conv);
+    batch->out_len = 0;
+    batch->nerrors = 0;
+    batch->count = 0;
+    memset(batch->flagged, 0, sizeof(batch->flagged));
+    if (conv->in_bytes && stats_enabled) {
+        const struct numconv_ieee754_format *f = &conv->in_format;
+        unsigned int width = conv->inputSystem == SYS_IEEE754 ? (unsigned int)(1 + f->exp_bits + f->mantissa_bits)
+                                                              : 8 * conv->in_bytes;
+        struct stats_mark mark;
+        stats_begin(&mark);
+        bool ok = batch_convert_packed(conv, data, len, batch);
+        stats_end(&mark, conv->inputSystem, conv->outputSystem, width, len / conv->in_bytes, batch->nerrors);
+        return ok;
+    }
+    if (conv->in_bytes)
+        return batch_convert_packed(conv, data, len, batch);
+    if (cache)
+        cache_claim(cache, conv);
+    // Lines are passed to convert_number_radix() as slices; the input is never written.
+    while (p < end) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (!nl)
+            nl = end;
+        size_t n = (size_t)(nl - p);
+        while (n > 0 && p[n - 1] == '\r')
+            n--;
+
+        // Convert straight into the output buffer, then turn the terminator into a newline.
+        size_t need = numconv_output_size(conv, n);
+        if (need < sizeof("error"))
+            need = sizeof("error");
+        if (!batch_reserve(batch, batch->out_len + need))
+            return false;
+        char *dst = batch->out + batch->out_len;
+        uint64_t hash = 0;
+        const struct cache_entry *hit = NULL;
+        bool cacheable = cache && n + need - 1 <= sizeof(cache->slots[0].text);
+        if (cacheable) {
+            hash = cache_hash(p, n);
+            hit = cache_find(cache, p, n, hash);
+        }
+        bool ok;
+        unsigned int status = 0;
+        if (hit) {
+            cache_copy(dst, hit->text + hit->key_len, hit->result_len);
+            dst[hit->result_len] = '\0';
+            status = hit->status;
+            ok = true;
+        } else {
+            if (conv->checked) {
+                status = numconv_convert_status(conv, p, n, dst, need, &error);
+                ok = !(status & NUMCONV_FAILED);
+            } else {
+                ok = numconv_convert(conv, p, n, dst, need, &error) != NULL;
+            }
+            if (ok && cacheable)
+                cache_store(cache, p, n, hash, dst, strlen(dst), status);
+        }
+        if (conv->checked) {
+            status = batch_check(conv, batch, status, &error);
+            ok = !(status & NUMCONV_FAILED);
+        }
+        if (!ok) {
+            if (!batch_add_error(batch, error, status))
+                return false;
+            memcpy(dst, "error", sizeof("error"));
+        }
+        if (out_bytes) {
+            // Pack the binary result in place of its digits (zeros for a failed line).
+            unsigned long bits = 0;
+            if (ok)
+                scan_binary_digits_n(dst, strlen(dst), &bits);
+            store_packed(dst, bits, out_bytes);
+            batch->out_len += out_bytes;
+        } else {
+            size_t written = strlen(dst);
+            dst[written] = '\n';
+            batch->out_len += written + 1;
+        }
+        batch->count++;
+        p = nl + 1;
+    }
+    return true;
+}
+
+/* Releases a batch's buffers, leaving it ready for reuse. */
+void numconv_batch_free(struct numconv_batch *batch)
+{
+    free(batch->out);
+    free(batch->errors);
+    memset(batch, 0, sizeof(*batch));
+}
+
+/*
+ * Binary digit scanning kernels.
+ *
+ * scan_binary_digits() validates and parses a digit string in a single pass:
+ * it returns the number of leading '0'/'1' characters and accumulates their
+ * value, so s[len] == '\0' is the validity check and no separate strlen() or
+ * per-character validation loop is needed. On x86-64 the widest of the
+ * AVX2 (32 digits), SSE2 (16 digits) and SWAR (8 digits) kernels is picked
+ * at runtime; other targets use SWAR on little-endian hosts and a scalar
+ * loop otherwise.
+ *
+ * The wide kernels load whole blocks before they know where the string ends.
+ * A block load is only issued when it stays inside the current 4 KiB page,
+ * so it can never fault; bytes past the terminator are never used.
+ */
+#if defined(__GNUC__) && defined(__SANITIZE_ADDRESS__)
+#define SCAN_NO_SANITIZE __attribute__((no_sanitize_address))
+#else
+#define SCAN_NO_SANITIZE
+#endif
+
+#if defined(__GNUC__)
+#define FORCE_INLINE __attribute__((always_inline))
+#else
+#define FORCE_INLINE
+#endif
+
+#define SCAN_PAGE_SIZE 4096
+
+static inline bool scan_block_fits(const char *p, size_t width)
+{
+    return ((uintptr_t)p & (SCAN_PAGE_SIZE - 1)) <= SCAN_PAGE_SIZE - width;
+}
+
+/**
+ * @brief Reverses the bit order of a 32-bit word.
+ * @param x The word to reverse.
+ * @return x with bit 0 swapped with bit 31, bit 1 with bit 30, and so on.
+ */
+static inline uint32_t bit_reverse32(uint32_t x)
+{
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    return __builtin_bswap32(x);
+}
+
+static SCAN_NO_SANITIZE size_t scan_binary_digits_scalar(const char *s, unsigned long *value)
+{
+    unsigned long v = 0;
+    size_t n = 0;
+    while (s[n] == '0' || s[n] == '1') {
+        v = (v << 1) | (unsigned long)(s[n] & 1);
+        n++;
+    }
+    *value = v;
+    return n;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SCAN_HAVE_SWAR 1
+
+/**
+ * @brief Gathers the low bits of eight ASCII digits into one byte, first digit most significant.
+ * @param w Eight characters loaded little-endian (first character in the low byte).
+ * @return The eight bits, with the first character's bit in bit 7.
+ */
+static inline unsigned long swar_gather8(uint64_t w)
+{
+    // Byte i holds its digit in bit 8i; the multiply moves it to bit 63 - i
+    // without any carries between the partial products.
+    return (unsigned long)(((w & 0x0101010101010101ULL) * 0x8040201008040201ULL) >> 56);
+}
+
+static SCAN_NO_SANITIZE size_t scan_binary_digits_swar(const char *s, unsigned long *value)
+{
+    unsigned long v = 0;
+    size_t n = 0;
+    for (;;) {
+        const char *p = s + n;
+        if (scan_block_fits(p, 8)) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            // A byte is a digit exactly when clearing its low bit leaves '0'.
+            uint64_t bad = (w & 0xFEFEFEFEFEFEFEFEULL) ^ 0x3030303030303030ULL;
+            if (bad == 0) {
+                v = (v << 8) | swar_gather8(w);
+                n += 8;
+                continue;
+            }
+            unsigned int k = (unsigned int)__builtin_ctzll(bad) / 8;
+            if (k)
+                v = (v << k) | (swar_gather8(w) >> (8 - k));
+            *value = v;
+            return n + k;
+        }
+        if (p[0] != '0' && p[0] != '1')
+            break;
+        v = (v << 1) | (unsigned long)(p[0] & 1);
+        n++;
+    }
+    *value = v;
+    return n;
+}
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SCAN_HAVE_X86 1
+
+static SCAN_NO_SANITIZE size_t scan_binary_digits_sse2(const char *s, unsigned long *value)
+{
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i one = _mm_set1_epi8('1');
+    unsigned long v = 0;
+    size_t n = 0;
+    for (;;) {
+        const char *p = s + n;
+        if (scan_block_fits(p, 16)) {
+            __m128i c = _mm_loadu_si128((const __m128i *)p);
+            __m128i is1 = _mm_cmpeq_epi8(c, one);
+            unsigned int ok = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(c, zero), is1));
+            unsigned long bits = bit_reverse32((uint32_t)_mm_movemask_epi8(is1)) >> 16;
+            if (ok == 0xFFFF) {
+                v = (v << 16) | bits;
+                n += 16;
+                continue;
+            }
+            unsigned int k = (unsigned int)__builtin_ctz(~ok);
+            if (k)
+                v = (v << k) | (bits >> (16 - k));
+            *value = v;
+            return n + k;
+        }
+        if (p[0] != '0' && p[0] != '1')
+            break;
+        v = (v << 1) | (unsigned long)(p[0] & 1);
+        n++;
+    }
+    *value = v;
+    return n;
+}
+
+__attribute__((target("avx2")))
+static SCAN_NO_SANITIZE size_t scan_binary_digits_avx2(const char *s, unsigned long *value)
+{
+    const __m256i zero = _mm256_set1_epi8('0');
+    const __m256i one = _mm256_set1_epi8('1');
+    unsigned long v = 0;
+    size_t n = 0;
+    for (;;) {
+        const char *p = s + n;
+        if (scan_block_fits(p, 32)) {
+            __m256i c = _mm256_loadu_si256((const __m256i *)p);
+            __m256i is1 = _mm256_cmpeq_epi8(c, one);
+            uint32_t ok = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(c, zero), is1));
+            unsigned long bits = bit_reverse32((uint32_t)_mm256_movemask_epi8(is1));
+            if (ok == 0xFFFFFFFFu) {
+                v = (v << 32) | bits;
+                n += 32;
+                continue;
+            }
+            unsigned int k = (unsigned int)__builtin_ctz(~ok);
+            if (k)
+                v = (v << k) | (bits >> (32 - k));
+            *value = v;
+            return n + k;
+        }
+        if (p[0] != '0' && p[0] != '1')
+            break;
+        v = (v << 1) | (unsigned long)(p[0] & 1);
+        n++;
+    }
+    *value = v;
+    return n;
+}
+#endif
+
+static size_t scan_binary_digits_resolve(const char *s, unsigned long *value);
+
+static size_t (*scan_binary_digits_impl)(const char *, unsigned long *) = scan_binary_digits_resolve;
+
+/**
+ * @brief Picks the widest scanning kernel the CPU supports, then runs it.
+ *
+ * Setting PA2_SIMD to "scalar", "swar", "sse2" or "avx2" forces a narrower
+ * kernel, which is useful when comparing them.
+ */
+static size_t scan_binary_digits_resolve(const char *s, unsigned long *value)
+{
+    const char *force = getenv("PA2_SIMD");
+    size_t (*impl)(const char *, unsigned long *) = scan_binary_digits_scalar;
+#if defined(SCAN_HAVE_X86)
+    __builtin_cpu_init();
+    impl = __builtin_cpu_supports("avx2") ? scan_binary_digits_avx2 : scan_binary_digits_sse2;
+    if (force && strcmp(force, "sse2") == 0)
+        impl = scan_binary_digits_sse2;
+#elif defined(SCAN_HAVE_SWAR)
+    impl = scan_binary_digits_swar;
+#endif
+#if defined(SCAN_HAVE_SWAR)
+    if (force && strcmp(force, "swar") == 0)
+        impl = scan_binary_digits_swar;
+#endif
+    if (force && strcmp(force, "scalar") == 0)
+        impl = scan_binary_digits_scalar;
+    scan_binary_digits_impl = impl;
+    return impl(s, value);
+}
+
+/**
+ * @brief Validates and parses a binary digit string in one pass.
+ * @param s The null-terminated string to scan.
+ * @param value Receives the value of the digits (the low 64 bits for longer strings).
+ * @return The number of leading '0'/'1' digits; the string is valid when s[return] is '\0'.
+ */
+static size_t scan_binary_digits(const char *s, unsigned long *value)
+{
+    return scan_binary_digits_impl(s, value);
+}
+
+/**
+ * @brief Scans digits of a string whose length is already known.
+ *
+ * Every block load stays inside the len bytes, so s need not be terminated.
+ */
+static inline FORCE_INLINE size_t scan_binary_digits_known(const char *s, size_t len, unsigned long *value)
+{
+    unsigned long v = 0;
+    size_t n = 0;
+#if defined(SCAN_HAVE_SWAR)
+    for (; n + 8 <= len; n += 8) {
+        uint64_t w;
+        memcpy(&w, s + n, 8);
+        uint64_t bad = (w & 0xFEFEFEFEFEFEFEFEULL) ^ 0x3030303030303030ULL;
+        if (bad != 0) {
+            unsigned int k = (unsigned int)__builtin_ctzll(bad) / 8;
+            if (k)
+                v = (v << k) | (swar_gather8(w) >> (8 - k));
+            *value = v;
+            return n + k;
+        }
+        v = (v << 8) | swar_gather8(w);
+    }
+#endif
+    for (; n < len && (s[n] == '0' || s[n] == '1'); n++) {
+        v = (v << 1) | (unsigned long)(s[n] & 1);
+    }
+    *value = v;
+    return n;
+}
+
+/**
+ * @brief Decodes already-scanned digits in one of the four integer representations.
+ * @param system SYS_UNSIGNED, SYS_SIGNED_MAGNITUDE, SYS_ONES_COMPLEMENT or SYS_TWOS_COMPLEMENT.
+ * @param bits Value of the digit string as returned by scan_binary_digits().
+ * @param len Number of digits.
+ * @param sign_bit Whether the first digit is '1'.
+ * @return The decoded value.
+ */
+long decode_integer_bits(int system, unsigned long bits, size_t len, bool sign_bit)
+{
+    if (len == 0)
+        return 0;
+    unsigned long low_mask = (len - 1 >= 64) ? ~0UL : (1UL << (len - 1)) - 1;
+    switch (system) {
+        case SYS_SIGNED_MAGNITUDE:
+            bits &= low_mask;
+            return sign_bit ? (long)(0UL - bits) : (long)bits;
+        case SYS_ONES_COMPLEMENT:
+            bits &= low_mask;
+            return sign_bit ? (long)(0UL - (bits ^ low_mask)) : (long)bits;
+        case SYS_TWOS_COMPLEMENT:
+            // Subtract 2^len when the sign bit is set; 2^64 and above wrap to 0.
+            if (sign_bit && len < 64)
+                bits -= 1UL << len;
+            return (long)bits;
+        default:
+            return (long)bits;
+    }
+}
+
+/*
+ * Binary digit emission.
+ *
+ * emit_binary_digits() is the inverse of scan_binary_digits(): it expands a
+ * word into ASCII digits eight at a time. Each byte of the value is spread
+ * over a 64-bit word with one multiply, turned into 0x00/0x01 bytes, and
+ * stored as '0'/'1' characters with a single 8-byte store. Complementing is
+ * an XOR folded into the same step, so one's complement output does not need
+ * a second pass.
+ */
+#if defined(SCAN_HAVE_SWAR)
+/**
+ * @brief Expands one byte into eight ASCII digits, most significant bit first.
+ * @param byte The byte to expand.
+ * @param flip 0x0101010101010101 to complement the digits, or 0.
+ * @return The eight characters, first character in the low byte.
+ */
+static inline uint64_t swar_expand8(unsigned long byte, uint64_t flip)
+{
+    // Byte i of the broadcast keeps only bit 7 - i, then becomes 0 or 1.
+    uint64_t x = ((byte & 0xFF) * 0x0101010101010101ULL) & 0x0102040810204080ULL;
+    x = ((x + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+    return (x ^ flip) | 0x3030303030303030ULL;
+}
+#endif
+
+/**
+ * @brief Generic body of emit_binary_digits(), inlined into each fixed-width copy.
+ */
+static inline FORCE_INLINE void emit_binary_digits_generic(unsigned long value, unsigned int numbits,
+                                                           bool complement, char *out)
+{
+    // Leading padding past 64 bits; computed without wrapping so unoptimized builds see no huge memset.
+    unsigned int pad = numbits > 64 ? numbits - 64 : 0;
+    if (pad) {
+        memset(out, complement ? '1' : '0', pad);
+        out += pad;
+        numbits = 64;
+    }
+    unsigned int head = numbits % 8;
+    for (unsigned int i = 0; i < head; i++) {
+        out[i] = (char)('0' + (((value >> (numbits - 1 - i)) & 1) ^ complement));
+    }
+    out += head;
+    numbits -= head;
+#if defined(SCAN_HAVE_SWAR)
+    uint64_t flip = complement ? 0x0101010101010101ULL : 0;
+    while (numbits) {
+        numbits -= 8;
+        uint64_t digits = swar_expand8(value >> numbits, flip);
+        memcpy(out, &digits, 8);
+        out += 8;
+    }
+#else
+    for (unsigned int i = 0; i < numbits; i++) {
+        out[i] = (char)('0' + (((value >> (numbits - 1 - i)) & 1) ^ complement));
+    }
+#endif
+}
+
+/**
+ * @brief Clamps a value to the largest one that fits in numbits bits.
+ *
+ * This matches the compare-and-subtract loops the encoders used originally,
+ * which produced all ones for values that do not fit.
+ */
+static inline unsigned long saturate_to_width(unsigned long value, unsigned int numbits)
+{
+    if (numbits < 64 && (value >> numbits) != 0)
+        return (1UL << numbits) - 1;
+    return value;
+}
+
+/**
+ * @brief Encodes a sign and magnitude as a bit pattern in one of the integer systems.
+ *
+ * This is the value-level counterpart of the *_buf encoders: magnitudes too
+ * large for the field saturate to all ones in the same way.
+ *
+ * @param system SYS_UNSIGNED .. SYS_TWOS_COMPLEMENT; unsigned output ignores the sign.
+ * @param magnitude The magnitude.
+ * @param negative The sign.
+ * @param numbits The width of the pattern (1..64).
+ * @return The bit pattern in the low numbits bits.
+ */
+static inline FORCE_INLINE unsigned long encode_integer_bits_generic(int system, unsigned long magnitude,
+                                                                      bool negative, unsigned int numbits)
+{
+    // The sign is applied with masks rather than branches, since it is unpredictable in bulk data.
+    unsigned long mask = (numbits >= 64) ? ~0UL : (1UL << numbits) - 1;
+    unsigned long sign = 0UL - (unsigned long)negative;
+    switch (system) {
+        case SYS_SIGNED_MAGNITUDE:
+            return ((unsigned long)negative << (numbits - 1)) | saturate_to_width(magnitude, numbits - 1);
+        case SYS_ONES_COMPLEMENT:
+            return (saturate_to_width(magnitude, numbits) ^ sign) & mask;
+        case SYS_TWOS_COMPLEMENT:
+            // 2^n - magnitude when negative; 2^64 wraps to 0.
+            return saturate_to_width((sign & ((numbits < 64) ? 1UL << numbits : 0UL)) + ((magnitude ^ sign) - sign),
+                                     numbits);
+        default:
+            return saturate_to_width(magnitude, numbits);
+    }
+}
+
+/**
+ * @brief Re-encodes an integer bit pattern in another integer system, without branching on the value.
+ * @param bits The input bit pattern.
+ * @param width Its width (1..64).
+ * @param from The input system (SYS_UNSIGNED .. SYS_TWOS_COMPLEMENT).
+ * @param to The output system (SYS_UNSIGNED .. SYS_TWOS_COMPLEMENT).
+ * @param numbits The output width (1..64).
+ * @param result Receives the output bit pattern.
+ * @param status Receives the OVERFLOW flag if the value does not fit the output, or NULL.
+ * @return false if a negative value is converted to unsigned.
+ */
+static inline FORCE_INLINE bool transcode_integer_bits_generic(unsigned long bits, unsigned int width, int from,
+                                                                int to, unsigned int numbits, unsigned long *result,
+                                                                unsigned int *status)
+{
+    unsigned long mask = (width < 64) ? (1UL << width) - 1 : ~0UL;
+    bits &= mask;
+    unsigned long sign = (from == SYS_UNSIGNED) ? 0 : 0UL - ((bits >> (width - 1)) & 1);
+    unsigned long magnitude;
+    switch (from) {
+        case SYS_SIGNED_MAGNITUDE: magnitude = bits & (mask >> 1); break;
+        case SYS_ONES_COMPLEMENT:  magnitude = (bits ^ sign) & (mask >> 1); break;
+        case SYS_TWOS_COMPLEMENT:  magnitude = ((bits ^ sign) - sign) & mask; break;
+        default:                   magnitude = bits; break;
+    }
+    bool negative = (sign & (magnitude != 0)) != 0;
+    if (status)
+        *status = integer_range_status(to, magnitude, negative, numbits);
+    if (to == SYS_UNSIGNED && negative)
+        return false;
+    *result = encode_integer_bits_generic(to, magnitude, negative, numbits);
+    return true;
+}
+
+static unsigned long encode_integer_bits(int system, unsigned long magnitude, bool negative, unsigned int numbits)
+{
+    return encode_integer_bits_generic(system, magnitude, negative, numbits);
+}
+
+static bool transcode_integer_bits(unsigned long bits, unsigned int width, int from, int to, unsigned int numbits,
+                                   unsigned long *result)
+{
+    unsigned int status;
+    bool ok = transcode_integer_bits_generic(bits, width, from, to, numbits, result, &status);
+    status_raise(status);
+    return ok;
+}
+
+/**
+ * @brief Body of transcode_packed_integers(), inlined for each element size.
+ */
+static inline FORCE_INLINE size_t transcode_packed_generic(const char *src, size_t count, unsigned int in_bytes,
+                                                           int from, int to, unsigned int numbits,
+                                                           char *dst, unsigned int out_bytes)
+{
+    for (size_t i = 0; i < count; i++) {
+        unsigned long result;
+        if (!transcode_integer_bits_generic(load_packed(src + i * in_bytes, in_bytes), 8 * in_bytes, from, to,
+                                            numbits, &result, NULL)) {
+            memset(dst + i * out_bytes, 0, out_bytes);
+            return i;
+        }
+        store_packed(dst + i * out_bytes, result, out_bytes);
+    }
+    return count;
+}
+
+/**
+ * @brief Transcodes an array of packed little-endian integers into another integer system.
+ * @param src The input elements.
+ * @param count The number of elements.
+ * @param in_bytes The input element size (1, 2, 4 or 8); its bits are the input width.
+ * @param from The input system (SYS_UNSIGNED .. SYS_TWOS_COMPLEMENT).
+ * @param to The output system (SYS_UNSIGNED .. SYS_TWOS_COMPLEMENT).
+ * @param numbits The output width (1..64).
+ * @param dst Receives count elements of out_bytes bytes.
+ * @param out_bytes The output element size, at least (numbits + 7) / 8.
+ * @return The number of elements converted before the first one that failed (written as zero),
+ *         or count if none did.
+ */
+static size_t transcode_packed_integers(const char *src, size_t count, unsigned int in_bytes, int from, int to,
+                                        unsigned int numbits, char *dst, unsigned int out_bytes)
+{
+    switch (in_bytes) {
+        case 1: return transcode_packed_generic(src, count, 1, from, to, numbits, dst, out_bytes);
+        case 2: return transcode_packed_generic(src, count, 2, from, to, numbits, dst, out_bytes);
+        case 4: return transcode_packed_generic(src, count, 4, from, to, numbits, dst, out_bytes);
+        default: return transcode_packed_generic(src, count, 8, from, to, numbits, dst, out_bytes);
+    }
+}
+
+/*
+ * Lookup tables.
+ *
+ * Optionally, every 2^bits value (bits being 8 or 16) is expanded once at
+ * startup into its binary digits and its decimal text. Emitting digits then
+ * copies 8 or 16 digits per lookup instead of expanding them bit by bit, and
+ * small decimal results skip printf. The representations share the tables:
+ * sign-magnitude and two's complement differ from unsigned only in the value
+ * emitted, and one's complement output is the same digits flipped. Decoding
+ * needs no table, since scan_binary_digits() already turns eight digits into
+ * their byte with a single multiply. The 16-bit tables take 1.5 MiB, so the
+ * width (or no tables at all) is chosen with -T.
+ */
+static unsigned int lookup_table_bits;  // 0 (disabled), 8 or 16
+static uint64_t digit_table8[256];      // eight digits per byte value
+static uint64_t (*digit_table16)[2];    // sixteen digits per 16-bit value, with 16-bit tables
+static char (*decimal_table)[8];        // NUL-terminated decimal text per value
+
+/**
+ * @brief Builds (or drops) the lookup tables; call before starting any conversion threads.
+ * @param bits 0 to disable the tables, or 8 or 16.
+ * @return false if bits is unsupported or the tables cannot be allocated (they are then disabled).
+ */
+bool lookup_tables_init(unsigned int bits)
+{
+    free(digit_table16);
+    free(decimal_table);
+    digit_table16 = NULL;
+    decimal_table = NULL;
+    lookup_table_bits = 0;
+    if (bits == 0)
+        return true;
+    if (bits != 8 && bits != 16)
+        return false;
+
+    size_t count = (size_t)1 << bits;
+    decimal_table = malloc(count * sizeof(*decimal_table));
+    if (bits == 16)
+        digit_table16 = malloc(count * sizeof(*digit_table16));
+    if (!decimal_table || (bits == 16 && !digit_table16)) {
+        lookup_tables_init(0);
+        return false;
+    }
+    for (size_t v = 0; v < 256; v++)
+        emit_binary_digits_generic(v, 8, false, (char *)&digit_table8[v]);
+    for (size_t v = 0; v < count; v++) {
+        if (digit_table16)
+            emit_binary_digits_generic(v, 16, false, (char *)digit_table16[v]);
+        // At most five digits (65535), written directly so the 8-byte entry is provably large enough.
+        char digits[5], *entry = decimal_table[v];
+        unsigned int n = 0;
+        size_t rest = v;
+        do {
+            digits[n++] = (char)('0' + rest % 10);
+            rest /= 10;
+        } while (rest != 0 && n < sizeof(digits));
+        memset(entry, 0, sizeof(decimal_table[v]));
+        for (unsigned int k = 0; k < n; k++)
+            entry[k] = digits[n - 1 - k];
+    }
+    lookup_table_bits = bits;
+    return true;
+}
+
+/**
+ * @brief Reports the memory used by the lookup tables.
+ * @return The size in bytes (0 when the tables are disabled).
+ */
+size_t lookup_tables_size(void)
+{
+    if (lookup_table_bits == 0)
+        return 0;
+    size_t count = (size_t)1 << lookup_table_bits;
+    return sizeof(digit_table8) + (digit_table16 ? count * sizeof(*digit_table16) : 0) +
+           count * sizeof(*decimal_table);
+}
+
+/**
+ * @brief Returns the width of the active lookup tables.
+ * @return 0 when disabled, otherwise 8 or 16.
+ */
+unsigned int lookup_tables_bits(void)
+{
+    return lookup_table_bits;
+}
+
+/**
+ * @brief Looks up the decimal text of a small value.
+ * @param value The value.
+ * @return An 8-byte, NUL-padded entry, or NULL if value is outside the table.
+ */
+static const char *lookup_decimal_text(unsigned long value)
+{
+    if (decimal_table == NULL || (value >> lookup_table_bits) != 0)
+        return NULL;
+    return decimal_table[value];
+}
+
+/**
+ * @brief emit_binary_digits() using the digit tables for up to 64 digits.
+ */
+static void emit_binary_digits_table(unsigned long value, unsigned int numbits, bool complement, char *out)
+{
+    uint64_t flip = complement ? 0x0101010101010101ULL : 0;
+    unsigned int head = numbits % 8;
+    for (unsigned int i = 0; i < head; i++)
+        out[i] = (char)('0' + (((value >> (numbits - 1 - i)) & 1) ^ complement));
+    out += head;
+    numbits -= head;
+    // Sixteen digits per lookup where the 16-bit table exists, then eight.
+    if (digit_table16 != NULL) {
+        for (; numbits >= 16; out += 16) {
+            numbits -= 16;
+            const uint64_t *entry = digit_table16[(value >> numbits) & 0xFFFF];
+            uint64_t hi = entry[0] ^ flip, lo = entry[1] ^ flip;
+            memcpy(out, &hi, 8);
+            memcpy(out + 8, &lo, 8);
+        }
+    }
+    for (; numbits; out += 8) {
+        numbits -= 8;
+        uint64_t digits = digit_table8[(value >> numbits) & 0xFF] ^ flip;
+        memcpy(out, &digits, 8);
+    }
+}
+
+/**
+ * Part 1.1 
+ * @brief Converts a binary string into its unsigned decimal value.
+ * @param input_string The binary string to convert.
+ * @return The unsigned decimal value.
+ */
+unsigned long binary_to_unsigned_decimal(const char *input_string)
+{
+    unsigned long sum;
+    scan_binary_digits(input_string, &sum);
+    return sum;
+} 
+
+/**
+ * Part 3.2
+ * @brief Converts a binary string into its decimal value using signed magnitude representation.
+ * @param input_string The binary string to convert.
+ * @return The signed decimal value.
+ */
+long binary_to_signed_magnitude_decimal(const char *input_string)
+{
+    unsigned long bits;
+    size_t len = scan_binary_digits(input_string, &bits);
+    return decode_integer_bits(SYS_SIGNED_MAGNITUDE, bits, len, input_string[0] == '1');
+}
+
+/**
+ * Part 3.3
+ * @brief Converts a binary string into its decimal value using one's complement.
+ * @param input_string The binary string to convert.
+ * @return The signed decimal value.
+ */
+long binary_to_ones_complement_decimal(const char *input_string)
+{
+    unsigned long bits;
+    size_t len = scan_binary_digits(input_string, &bits);
+    return decode_integer_bits(SYS_ONES_COMPLEMENT, bits, len, input_string[0] == '1');
+}
+
+/**
+ * Part 1.4
+ * @brief Converts a binary string into its decimal value using two's complement.
+ * @param input_string The binary string to convert.
+ * @return The signed decimal value.
+ */
+long binary_to_twos_complement_decimal(const char *input_string)
+{
+    unsigned long bits;
+    size_t len = scan_binary_digits(input_string, &bits);
+    return decode_integer_bits(SYS_TWOS_COMPLEMENT, bits, len, input_string[0] == '1');
+}
+
+/**
+ * Part 2.1
+ * @brief Converts an unsigned decimal value into its unsigned binary representation.
+ * @param input The decimal value to convert.
+ * @param numbits The number of bits for the representation.
+ * @return The binary string (allocated on the heap).
+ */
+char *unsigned_decimal_to_binary(unsigned long input, unsigned int numbits)
+{
+    char *str = malloc(numbits + 1);
+    if (!str){
+        return NULL;
+    }
+    if (!unsigned_decimal_to_binary_buf(input, numbits, str, numbits + 1)){
+        free(str);
+        return NULL;
+    }
+    return str;
+}
+
+/**
+ * @brief Allocation-free variant of unsigned_decimal_to_binary().
+ * @param input The decimal value to convert.
+ * @param numbits The number of bits for the representation.
+ * @param out Buffer receiving the binary string.
+ * @param outlen Size of the buffer; must be at least numbits + 1.
+ * @return out, or NULL if the buffer is too small.
+ */
+char *unsigned_decimal_to_binary_buf(unsigned long input, unsigned int numbits, char *out, size_t outlen)
+{
+    if (outlen < (size_t)numbits + 1){
+        return NULL;
+    }
+    char *str = out;
+    str[numbits] = '\0';
+    emit_binary_digits(saturate_to_width(input, numbits), numbits, false, str);
+    return str;
+}
+
+/**
+ * Part 2.1
+ * @brief Converts a signed decimal value into its binary representation using signed magnitude.
+ * @param input The decimal value to convert.
+ * @param numbits The number of bits for the representation.
+ * @return The binary string (allocated on the heap).
+ */
+char *signed_decimal_to_signed_magnitude(long input, unsigned int numbits)
+{
+    if (numbits < 1){
+        return NULL;
+    }
+    char *binary = malloc(numbits + 1);
+    if (!binary){
+        return NULL;
+    }
+    if (!signed_decimal_to_signed_magnitude_buf(input, numbits, binary, numbits + 1)){
+        free(binary);
+        return NULL;
+    }
+    return binary;
+}
+
+/**
+ * @brief Allocation-free variant of signed_decimal_to_signed_magnitude().
+ * @param input The decimal value to convert.
+ * @param numbits The number of bits for the representation.
+ * @param out Buffer receiving the binary string.
+ * @param outlen Size of the buffer; must be at least numbits + 1.
+ * @return out, or NULL if numbits is 0 or the buffer is too small.
+ */
+char *signed_decimal_to_signed_magnitude_buf(long input, unsigned int numbits, char *out, size_t outlen)
+{
+    if (numbits < 1 || outlen < (size_t)numbits + 1){
+        return NULL;
+    }
+    char *binary = out;
+    binary[numbits] = '\0';
+
+    unsigned long magnitude;
+    if (input < 0){
+        binary[0] = '1';
+        magnitude = 0UL - (unsigned long)input;
+    } else {
+        binary[0] = '0';
+        magnitude = (unsigned long)input;
+    }
+    emit_binary_digits(saturate_to_width(magnitude, numbits - 1), numbits - 1, false, binary + 1);
+    return binary;
+}
+
+/**
+ * Part 2.1
+ * @brief Converts a signed decimal value into its one's complement binary representation.
+ * @param input The decimal value to convert.
+ * @param numbits The number of bits for the representation.
+ * @return The binary string (allocated on the heap).
+ */
+char *signed_decimal_to_ones_complement(long input, unsigned int numbits)
+{
+    char *binary = malloc(numbits + 1);
+    if (!binary){
+        return NULL;
+    }
+    if (!signed_decimal_to_ones_complement_buf(input, numbits, binary, numbits + 1)){
+        free(binary);
+        return NULL;
+    }
+    return binary;
+}
+
+/**
+ * @brief Allocation-free variant of signed_decimal_to_ones_complement().
+ * @param input The decimal value to convert.
+ * @param numbits The number of bits for the representation.
+ * @param out Buffer receiving the binary string.
+ * @param outlen Size of the buffer; must be at least numbits + 1.
+ * @return out, or NULL if the buffer is too small.
+ */
+char *signed_decimal_to_ones_complement_buf(long input, unsigned int numbits, char *out, size_t outlen)
+{
+    if (input >= 0) {
+        return unsigned_decimal_to_binary_buf((unsigned long)input, numbits, out, outlen);
+    }
+    if (outlen < (size_t)numbits + 1){
+        return NULL;
+    }
+    // Write the magnitude with every bit flipped in the same pass.
+    out[numbits] = '\0';
+    emit_binary_digits(saturate_to_width(0UL - (unsigned long)input, numbits), numbits, true, out);
+    return out;
+}
+
+/**
+ * Part 2.1
+ * @brief Converts a signed decimal value into its two's complement binary representation.
+ * @param input The decimal value to convert.
+ * @param numbits The number of bits for the representation.
+ * @return The binary string (allocated on the heap).
+ */
+char *signed_decimal_to_twos_complement(long input, unsigned int numbits)
+{
+    char *binary = malloc(numbits + 1);
+    if (!binary){
+        return NULL;
+    }
+    if (!signed_decimal_to_twos_complement_buf(input, numbits, binary, numbits + 1)){
+        free(binary);
+        return NULL;
+    }
+    return binary;
+}
+
+/**
+ * @brief Allocation-free variant of signed_decimal_to_twos_complement().
+ * @param input The decimal value to convert.
+ * @param numbits The number of bits for the representation.
+ * @param out Buffer receiving the binary string.
+ * @param outlen Size of the buffer; must be at least numbits + 1.
+ * @return out, or NULL if the buffer is too small.
+ */
+char *signed_decimal_to_twos_complement_buf(long input, unsigned int numbits, char *out, size_t outlen)
+{
+    if (input >= 0) {
+        return unsigned_decimal_to_binary_buf((unsigned long)input, numbits, out, outlen);
+    } else {
+        // Two's complement: add 2^n to the negative number (2^64 wraps to 0).
+        unsigned long rep = ((numbits < 64) ? (1UL << numbits) : 0UL) + (unsigned long)input;
+        return unsigned_decimal_to_binary_buf(rep, numbits, out, outlen);
+    }
+}
+
+/**
+ * Part 3.1
+ * @brief Converts an IEEE754 binary string into its decimal value.
+ * @param input The IEEE754 binary string.
+ * @param exp The number of exponent bits.
+ * @param mantissa The number of mantissa bits.
+ * @return The decimal value.
+ */
+double ieee754_to_decimal(char *input, int exp, int mantissa)
+{
+    int total_bits = 1 + exp + mantissa;
+    if (!ieee754_format_supported(exp, mantissa)) {
+        return NAN;
+    }
+    // Parse all fields as one integer in a single pass over the digits.
+    unsigned long bits;
+    size_t len = scan_binary_digits(input, &bits);
+    if (len != (size_t)total_bits || input[len] != '\0') {
+        return NAN;
+    }
+    return ieee754_decode_bits(bits, exp, mantissa);
+}
+
+/**
+ * @brief Decodes an IEEE754-style bit pattern with integer field extraction and one ldexp().
+ * @param bits The encoding in the low 1 + exp_bits + mantissa_bits bits, sign bit highest.
+ * @param exp_bits The number of exponent bits.
+ * @param mantissa_bits The number of mantissa bits.
+ * @param finite Whether the format has no infinities, the top exponent holding normal
+ *               numbers and only the all-ones exponent and mantissa being NaN.
+ * @return The decimal value (NAN for any NaN encoding).
+ */
+static inline FORCE_INLINE double ieee754_decode_generic(unsigned long bits, int exp_bits, int mantissa_bits,
+                                                        bool finite)
+{
+    int sign = ((bits >> (exp_bits + mantissa_bits)) & 1) ? -1 : 1;
+    unsigned long max_field = (1UL << exp_bits) - 1;
+    unsigned long exponent = (bits >> mantissa_bits) & max_field;
+    unsigned long fraction = bits & ((1UL << mantissa_bits) - 1);
+    long bias = (1L << (exp_bits - 1)) - 1;
+
+    // Special cases: All exponent bits 1.
+    if (exponent == max_field && finite) {
+        if (fraction == (1UL << mantissa_bits) - 1)
+            return NAN;
+    } else if (exponent == max_field) {
+        return fraction ? NAN : sign * INFINITY;
+    }
+    if (exponent == 0) {
+        return sign * ldexp((double)fraction, (int)(1 - bias - mantissa_bits));
+    }
+    return sign * ldexp((double)(fraction | (1UL << mantissa_bits)),
+                        (int)((long)exponent - bias - mantissa_bits));
+}
+
+/**
+ * Part 3.2
+ * @brief Converts a decimal value into its IEEE754 binary representation.
+ * @param input The decimal number.
+ * @param exp_bits The number of exponent bits.
+ * @param mantissa_bits The number of mantissa bits.
+ * @param rounding_mode Rounding mode (ROUNDUP, ROUNDDOWN, or ROUNDTOEVEN).
+ * @return The IEEE754 binary string (allocated on the heap).
+ */
+char *decimal_to_ieee754_binary(double input, int exp_bits, int mantissa_bits, int rounding_mode)
+{
+    int total_bits = 1 + exp_bits + mantissa_bits;
+    char *result = malloc(total_bits + 1);
+    if (!result) return NULL;
+    if (!decimal_to_ieee754_binary_buf(input, exp_bits, mantissa_bits, rounding_mode,
+                                       result, total_bits + 1)) {
+        free(result);
+        return NULL;
+    }
+    return result;
+}
+
+/**
+ * @brief Allocation-free variant of decimal_to_ieee754_binary().
+ * @param input The decimal number.
+ * @param exp_bits The number of exponent bits.
+ * @param mantissa_bits The number of mantissa bits.
+ * @param rounding_mode Rounding mode (ROUNDUP, ROUNDDOWN, or ROUNDTOEVEN).
+ * @param out Buffer receiving the IEEE754 binary string.
+ * @param outlen Size of the buffer; must be at least 1 + exp_bits + mantissa_bits + 1.
+ * @return out, or NULL if the format is unsupported or the buffer is too small.
+ */
+static char *decimal_to_ieee754_binary_buf(double input, int exp_bits, int mantissa_bits, int rounding_mode,
+                                           char *out, size_t outlen)
+{
+    if (!ieee754_format_supported(exp_bits, mantissa_bits)) return NULL;
+    int total_bits = 1 + exp_bits + mantissa_bits;
+    if (outlen < (size_t)total_bits + 1) return NULL;
+    out[total_bits] = '\0';
+    emit_binary_digits(ieee754_encode_bits(input, exp_bits, mantissa_bits, rounding_mode),
+                       total_bits, false, out);
+    return out;
+}
+
+/**
+ * @brief Checks whether the encoder and decoder support an IEEE754-style format.
+ * @param exp_bits The number of exponent bits.
+ * @param mantissa_bits The number of mantissa bits.
+ * @return true if the whole encoding (sign, exponent and mantissa) fits in 64 bits.
+ */
+bool ieee754_format_supported(int exp_bits, int mantissa_bits)
+{
+    return exp_bits >= 1 && exp_bits <= 30 && mantissa_bits >= 0 && 1 + exp_bits + mantissa_bits <= 64;
+}
+
+/**
+ * @brief Encodes a double into an IEEE754-style bit pattern using integer arithmetic only.
+ *
+ * The sign, exponent and significand are taken straight from the bits of the
+ * double, and rounding is a shift plus a comparison of the dropped bits, so
+ * the cost does not depend on the magnitude of the input. Results that
+ * overflow the exponent become infinity; NaN becomes a positive quiet NaN.
+ * Finite formats have neither: infinities, overflows and NaN all become the
+ * all-ones NaN pattern.
+ *
+ * @param input The decimal number.
+ * @param exp_bits The number of exponent bits.
+ * @param mantissa_bits The number of mantissa bits.
+ * @param rounding_mode Rounding mode (ROUNDUP rounds the magnitude up, ROUNDDOWN truncates).
+ * @param finite Whether the format has no infinities (see ieee754_decode_generic()).
+ * @return The encoding in the low 1 + exp_bits + mantissa_bits bits, sign bit highest.
+ */
+static inline FORCE_INLINE unsigned long ieee754_encode_generic(double input, int exp_bits, int mantissa_bits,
+                                                               int rounding_mode, bool finite)
+{
+    uint64_t bits;
+    memcpy(&bits, &input, sizeof(bits));
+    unsigned long sign = (unsigned long)(bits >> 63) << (exp_bits + mantissa_bits);
+    unsigned long max_field = (1UL << exp_bits) - 1;
+    unsigned long inf = max_field << mantissa_bits;
+    unsigned long finite_nan = inf | ((1UL << mantissa_bits) - 1);
+    int e = (int)((bits >> 52) & 0x7FF);
+    uint64_t sig = bits & ((1ULL << 52) - 1);
+
+    // Formats without infinities saturate to their NaN, keeping the sign like everything else.
+    if (e == 0x7FF && finite)
+        return sign | finite_nan;
+    if (e == 0x7FF) {
+        if (sig != 0) // Set a nonzero mantissa.
+            return inf | (mantissa_bits > 0 ? 1UL << (mantissa_bits - 1) : 0);
+        return sign | inf;
+    }
+    if (e == 0 && sig == 0)
+        return sign;
+
+    // Normalize so that value = sig * 2^(E - 52) with sig in [2^52, 2^53).
+    int E;
+    if (e == 0) {
+        int shift = __builtin_clzll(sig) - 11;
+        sig <<= shift;
+        E = -1022 - shift;
+    } else {
+        sig |= 1ULL << 52;
+        E = e - 1023;
+    }
+
+    long bias = (1L << (exp_bits - 1)) - 1;
+    long emin = 1 - bias;
+    if (E + bias >= (long)max_field + finite)
+        return sign | (finite ? finite_nan : inf);
+
+    // Bits of sig below the last mantissa bit; subnormal results keep fewer.
+    long drop = 52 - mantissa_bits;
+    if (E < emin)
+        drop += emin - E;
+
+    uint64_t q;
+    bool round = false;
+    if (drop <= 0) {
+        q = sig << -drop;
+    } else if (drop >= 64) {
+        // Everything is below half an ulp: only rounding up can leave a nonzero result.
+        q = 0;
+        round = (rounding_mode == ROUNDUP);
+    } else {
+        q = sig >> drop;
+        uint64_t rest = sig & ((1ULL << drop) - 1);
+        uint64_t half = 1ULL << (drop - 1);
+        if (rounding_mode == ROUNDUP)
+            round = rest != 0;
+        else if (rounding_mode == ROUNDTOEVEN)
+            round = rest > half || (rest == half && (q & 1));
+    }
+    q += round;
+
+    // q carries the hidden bit at bit mantissa_bits, so a rounding carry out of
+    // the mantissa (or out of a subnormal into the smallest normal) lands in
+    // the exponent field on its own.
+    unsigned long enc;
+    if (E >= emin)
+        enc = ((unsigned long)(E + bias) << mantissa_bits) + q - (1UL << mantissa_bits);
+    else
+        enc = q;
+    if (finite ? enc >= finite_nan : (enc >> mantissa_bits) >= max_field)
+        return sign | (finite ? finite_nan : inf);
+    return sign | enc;
+}
+
+/*
+ * Fixed-width specializations.
+ *
+ * Nearly all traffic is 8/16/32/64-bit integers and binary16/32/64 floats.
+ * The macros below stamp out a copy of the generic digit and IEEE754 code for
+ * each of those widths with the width as a compile-time constant, so the
+ * bias, masks and shift counts fold away and the 8-digit block loops unroll
+ * completely. The public entry points dispatch to them and fall back to the
+ * generic code for any other width.
+ */
+#define DEFINE_FIXED_WIDTH_DIGITS(N)                                                \
+    static void emit_binary_digits_##N(unsigned long value, bool complement, char *out) \
+    {                                                                               \
+        emit_binary_digits_generic(value, N, complement, out);                      \
+    }                                                                               \
+    static size_t scan_binary_digits_##N(const char *s, unsigned long *value)       \
+    {                                                                               \
+        return scan_binary_digits_known(s, N, value);                               \
+    }
+
+DEFINE_FIXED_WIDTH_DIGITS(8)
+DEFINE_FIXED_WIDTH_DIGITS(16)
+DEFINE_FIXED_WIDTH_DIGITS(32)
+DEFINE_FIXED_WIDTH_DIGITS(64)
+
+#define DEFINE_IEEE754_FORMAT(NAME, EXP, MANT, FINITE)                              \
+    static inline unsigned long ieee754_encode_##NAME(double input, int rounding_mode) \
+    {                                                                               \
+        return ieee754_encode_generic(input, EXP, MANT, rounding_mode, FINITE);     \
+    }                                                                               \
+    static inline double ieee754_decode_##NAME(unsigned long bits)                  \
+    {                                                                               \
+        return ieee754_decode_generic(bits, EXP, MANT, FINITE);                     \
+    }
+
+DEFINE_IEEE754_FORMAT(binary16, 5, 10, false)
+DEFINE_IEEE754_FORMAT(bfloat16, 8, 7, false)
+DEFINE_IEEE754_FORMAT(binary32, 8, 23, false)
+DEFINE_IEEE754_FORMAT(binary64, 11, 52, false)
+DEFINE_IEEE754_FORMAT(e4m3, 4, 3, true)
+DEFINE_IEEE754_FORMAT(e5m2, 5, 2, false)
+
+/**
+ * @brief Writes the low numbits bits of a value as binary digits (no terminator).
+ * @param value The value to write; widths over 64 bits are padded with leading zeros.
+ * @param numbits The number of digits to write.
+ * @param complement Whether to write every digit inverted.
+ * @param out Buffer receiving at least numbits characters.
+ */
+void emit_binary_digits(unsigned long value, unsigned int numbits, bool complement, char *out)
+{
+    if (lookup_table_bits != 0 && numbits <= 64) {
+        emit_binary_digits_table(value, numbits, complement, out);
+        return;
+    }
+    switch (numbits) {
+        case 8:  emit_binary_digits_8(value, complement, out); break;
+        case 16: emit_binary_digits_16(value, complement, out); break;
+        case 32: emit_binary_digits_32(value, complement, out); break;
+        case 64: emit_binary_digits_64(value, complement, out); break;
+        default: emit_binary_digits_generic(value, numbits, complement, out); break;
+    }
+}
+
+/**
+ * @brief Validates and parses a binary digit string of known length in one pass.
+ * @param s The digits to scan; no terminator is needed.
+ * @param len The number of characters available at s.
+ * @param value Receives the value of the digits (the low 64 bits for longer strings).
+ * @return The number of leading '0'/'1' digits; the string is valid when this equals len.
+ */
+static size_t scan_binary_digits_n(const char *s, size_t len, unsigned long *value)
+{
+    switch (len) {
+        case 8:  return scan_binary_digits_8(s, value);
+        case 16: return scan_binary_digits_16(s, value);
+        case 32: return scan_binary_digits_32(s, value);
+        case 64: return scan_binary_digits_64(s, value);
+        default: return scan_binary_digits_known(s, len, value);
+    }
+}
+
+/**
+ * @brief Decodes an IEEE754-style bit pattern.
+ *
+ * binary32 and binary64 patterns are reinterpreted directly as float/double,
+ * binary16 uses its specialized decoder, and other formats the generic one.
+ *
+ * @param bits The encoding in the low 1 + exp_bits + mantissa_bits bits, sign bit highest.
+ * @param exp_bits The number of exponent bits.
+ * @param mantissa_bits The number of mantissa bits.
+ * @return The decimal value (NAN for any NaN encoding).
+ */
+static double ieee754_decode_bits(unsigned long bits, int exp_bits, int mantissa_bits)
+{
+    if (exp_bits == 8 && mantissa_bits == 23) {
+        uint32_t b32 = (uint32_t)bits;
+        float f;
+        memcpy(&f, &b32, sizeof(f));
+        return isnan(f) ? NAN : (double)f;
+    }
+    if (exp_bits == 11 && mantissa_bits == 52) {
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        return isnan(d) ? NAN : d;
+    }
+    if (exp_bits == 5 && mantissa_bits == 10)
+        return ieee754_decode_binary16(bits);
+    if (exp_bits == 8 && mantissa_bits == 7)
+        return ieee754_decode_bfloat16(bits);
+    if (exp_bits == 5 && mantissa_bits == 2)
+        return ieee754_decode_e5m2(bits);
+    return ieee754_decode_generic(bits, exp_bits, mantissa_bits, false);
+}
+
+/**
+ * @brief Encodes a double into an IEEE754-style bit pattern (see ieee754_encode_generic()).
+ *
+ * binary32 with ROUNDTOEVEN uses the hardware double-to-float conversion,
+ * which rounds the same way under the default floating-point environment;
+ * binary64 is the input's own bit pattern.
+ *
+ * @param input The decimal number.
+ * @param exp_bits The number of exponent bits.
+ * @param mantissa_bits The number of mantissa bits.
+ * @param rounding_mode Rounding mode (ROUNDUP, ROUNDDOWN, or ROUNDTOEVEN).
+ * @return The encoding in the low 1 + exp_bits + mantissa_bits bits, sign bit highest.
+ */
+unsigned long ieee754_encode_bits(double input, int exp_bits, int mantissa_bits, int rounding_mode)
+{
+    if (exp_bits == 8 && mantissa_bits == 23) {
+        if (rounding_mode == ROUNDTOEVEN && !isnan(input)) {
+            float f = (float)input;
+            uint32_t b32;
+            memcpy(&b32, &f, sizeof(b32));
+            return b32;
+        }
+        return ieee754_encode_binary32(input, rounding_mode);
+    }
+    if (exp_bits == 11 && mantissa_bits == 52) {
+        if (!isnan(input)) {
+            uint64_t b64;
+            memcpy(&b64, &input, sizeof(b64));
+            return b64;
+        }
+        return ieee754_encode_binary64(input, rounding_mode);
+    }
+    if (exp_bits == 5 && mantissa_bits == 10)
+        return ieee754_encode_binary16(input, rounding_mode);
+    if (exp_bits == 8 && mantissa_bits == 7)
+        return ieee754_encode_bfloat16(input, rounding_mode);
+    if (exp_bits == 5 && mantissa_bits == 2)
+        return ieee754_encode_e5m2(input, rounding_mode);
+    return ieee754_encode_generic(input, exp_bits, mantissa_bits, rounding_mode, false);
+}
+
+/**
+ * @brief Decodes a bit pattern of the given format (see ieee754_decode_bits()).
+ * @param bits The encoding in the low bits, sign bit highest.
+ * @param format The format, which may be finite (no infinities).
+ * @return The decimal value (NAN for any NaN encoding).
+ */
+double ieee754_decode_format(unsigned long bits, const struct numconv_ieee754_format *format)
+{
+    if (!format->finite)
+        return ieee754_decode_bits(bits, format->exp_bits, format->mantissa_bits);
+    if (format->exp_bits == 4 && format->mantissa_bits == 3)
+        return ieee754_decode_e4m3(bits);
+    return ieee754_decode_generic(bits, format->exp_bits, format->mantissa_bits, true);
+}
+
+/**
+ * @brief Encodes a double into a bit pattern of the given format (see ieee754_encode_bits()).
+ * @param input The decimal number.
+ * @param format The format, which may be finite (no infinities).
+ * @param rounding_mode Rounding mode (ROUNDUP, ROUNDDOWN, or ROUNDTOEVEN).
+ * @return The encoding in the low bits, sign bit highest.
+ */
+unsigned long ieee754_encode_format(double input, const struct numconv_ieee754_format *format, int rounding_mode)
+{
+    if (!format->finite)
+        return ieee754_encode_bits(input, format->exp_bits, format->mantissa_bits, rounding_mode);
+    if (format->exp_bits == 4 && format->mantissa_bits == 3)
+        return ieee754_encode_e4m3(input, rounding_mode);
+    return ieee754_encode_generic(input, format->exp_bits, format->mantissa_bits, rounding_mode, true);
+}
+
+/*
+ * Bulk down-conversion.
+ *
+ * Arrays of packed floats are converted a block at a time. A block is first
+ * checked for NaN inputs, which must fail one by one like every other
+ * conversion; blocks without any are converted with round-to-nearest-even
+ * by a vector kernel where the formats have one: F16C for binary32 to
+ * binary16 (when the CPU supports it), and plain loops the compiler
+ * vectorizes for binary32 to bfloat16 and binary64 to binary32. Everything
+ * else goes element by element through the format encoders.
+ */
+#define FLOAT_BLOCK 256
+
+static void binary32_to_binary16_scalar(const char *src, size_t n, char *dst)
+{
+    for (size_t i = 0; i < n; i++) {
+        float f;
+        memcpy(&f, src + 4 * i, sizeof(f));
+        uint16_t h = (uint16_t)ieee754_encode_binary16(f, ROUNDTOEVEN);
+        memcpy(dst + 2 * i, &h, sizeof(h));
+    }
+}
+
+#if defined(SCAN_HAVE_X86)
+__attribute__((target("avx,f16c")))
+static void binary32_to_binary16_f16c(const char *src, size_t n, char *dst)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps((const float *)(const void *)(src + 4 * i));
+        __m128i h = _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128((__m128i *)(void *)(dst + 2 * i), h);
+    }
+    binary32_to_binary16_scalar(src + 4 * i, n - i, dst + 2 * i);
+}
+#endif
+
+static void binary32_to_binary16_resolve(const char *src, size_t n, char *dst);
+
+static void (*binary32_to_binary16_impl)(const char *, size_t, char *) = binary32_to_binary16_resolve;
+
+/**
+ * @brief Picks the F16C kernel when the CPU has it (and PA2_SIMD does not ask for
+ *        "scalar", "swar" or "sse2"), then runs it.
+ */
+static void binary32_to_binary16_resolve(const char *src, size_t n, char *dst)
+{
+    void (*impl)(const char *, size_t, char *) = binary32_to_binary16_scalar;
+#if defined(SCAN_HAVE_X86)
+    const char *force = getenv("PA2_SIMD");
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c") &&
+        !(force && (strcmp(force, "scalar") == 0 || strcmp(force, "swar") == 0 || strcmp(force, "sse2") == 0)))
+        impl = binary32_to_binary16_f16c;
+#endif
+    binary32_to_binary16_impl = impl;
+    impl(src, n, dst);
+}
+
+static void binary32_to_bfloat16(const char *src, size_t n, char *dst)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint32_t b;
+        memcpy(&b, src + 4 * i, sizeof(b));
+        // Round to nearest even on the dropped 16 bits; a carry moves into the exponent.
+        uint16_t h = (uint16_t)((b + 0x7FFF + ((b >> 16) & 1)) >> 16);
+        memcpy(dst + 2 * i, &h, sizeof(h));
+    }
+}
+
+static void binary64_to_binary32(const char *src, size_t n, char *dst)
+{
+    for (size_t i = 0; i < n; i++) {
+        double d;
+        memcpy(&d, src + 8 * i, sizeof(d));
+        float f = (float)d;
+        memcpy(dst + 4 * i, &f, sizeof(f));
+    }
+}
+
+/* Whether any of n packed binary32 (or binary64, with wide) elements is a NaN. */
+static bool packed_floats_have_nan(const char *src, size_t n, bool wide)
+{
+    bool nan = false;
+    if (wide) {
+        for (size_t i = 0; i < n; i++) {
+            uint64_t b;
+            memcpy(&b, src + 8 * i, sizeof(b));
+            nan |= (b & 0x7FFFFFFFFFFFFFFFULL) > 0x7FF0000000000000ULL;
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            uint32_t b;
+            memcpy(&b, src + 4 * i, sizeof(b));
+            nan |= (b & 0x7FFFFFFFu) > 0x7F800000u;
+        }
+    }
+    return nan;
+}
+
+static bool same_format(const struct numconv_ieee754_format *format, int exp_bits, int mantissa_bits)
+{
+    return !format->finite && format->exp_bits == exp_bits && format->mantissa_bits == mantissa_bits;
+}
+
+/**
+ * @brief Converts an array of packed little-endian floats into another format.
+ * @param src The input elements, of (width + 7) / 8 bytes for the input format's width.
+ * @param count The number of elements.
+ * @param from The input format.
+ * @param to The output format.
+ * @param rounding_mode Rounding mode (ROUNDUP, ROUNDDOWN, or ROUNDTOEVEN).
+ * @param dst Receives count elements of the output format's size.
+ * @return The number of elements converted before the first NaN input (written as zero),
+ *         or count if there was none.
+ */
+size_t transcode_packed_floats(const char *src, size_t count, const struct numconv_ieee754_format *from,
+                               const struct numconv_ieee754_format *to, int rounding_mode, char *dst)
+{
+    const unsigned int in_bytes = (unsigned int)(1 + from->exp_bits + from->mantissa_bits + 7) / 8;
+    const unsigned int out_bytes = (unsigned int)(1 + to->exp_bits + to->mantissa_bits + 7) / 8;
+    void (*kernel)(const char *, size_t, char *) = NULL;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (rounding_mode == ROUNDTOEVEN && same_format(from, 8, 23) && same_format(to, 5, 10))
+        kernel = binary32_to_binary16_impl;
+    else if (rounding_mode == ROUNDTOEVEN && same_format(from, 8, 23) && same_format(to, 8, 7))
+        kernel = binary32_to_bfloat16;
+    else if (rounding_mode == ROUNDTOEVEN && same_format(from, 11, 52) && same_format(to, 8, 23))
+        kernel = binary64_to_binary32;
+#endif
+    size_t i = 0;
+    while (kernel && i < count) {
+        size_t n = (count - i < FLOAT_BLOCK) ? count - i : FLOAT_BLOCK;
+        // A block holding a NaN is left to the loop below, which stops at it.
+        if (packed_floats_have_nan(src + i * in_bytes, n, in_bytes == 8))
+            break;
+        kernel(src + i * in_bytes, n, dst + i * out_bytes);
+        i += n;
+    }
+    for (; i < count; i++) {
+        double d = ieee754_decode_format(load_packed(src + i * in_bytes, in_bytes), from);
+        if (isnan(d)) {
+            memset(dst + i * out_bytes, 0, out_bytes);
+            return i;
+        }
+        store_packed(dst + i * out_bytes, ieee754_encode_format(d, to, rounding_mode), out_bytes);
+    }
+    return count;
+}
+
+/*
+ * Arbitrary-precision integers.
+ *
+ * The 64-bit decoders and encoders above cannot represent widths beyond a
+ * machine word. For those, values are held as a sign plus a magnitude of
+ * little-endian 32-bit limbs (32 bits so that every limb product fits a
+ * uint64_t). Binary digits map onto limbs directly, while decimal text is
+ * converted divide-and-conquer: the number is split around 10^(9*2^k) and
+ * both halves are converted recursively, down to a base case working in
+ * 10^9 chunks. The powers are computed once per conversion by squaring.
+ */
+#define BN_BASE_LIMBS 16        // below this many limbs, convert in 10^9 chunks
+#define BN_MAX_POWERS 32
+
+struct bignum {
+    uint32_t *limb;     // limb[0] is least significant
+    size_t len;         // limbs in use, without leading zero limbs
+    size_t cap;
+};
+
+static void bn_free(struct bignum *a)
+{
+    free(a->limb);
+    a->limb = NULL;
+    a->len = a->cap = 0;
+}
+
+static bool bn_reserve(struct bignum *a, size_t cap)
+{
+    if (cap <= a->cap)
+        return true;
+    uint32_t *grown = realloc(a->limb, cap * sizeof(uint32_t));
+    if (!grown)
+        return false;
+    stats_count_allocations(1);
+    a->limb = grown;
+    a->cap = cap;
+    return true;
+}
+
+static void bn_normalize(struct bignum *a)
+{
+    while (a->len > 0 && a->limb[a->len - 1] == 0)
+        a->len--;
+}
+
+static bool bn_copy(struct bignum *dst, const struct bignum *src)
+{
+    if (!bn_reserve(dst, src->len ? src->len : 1))
+        return false;
+    if (src->len)
+        memcpy(dst->limb, src->limb, src->len * sizeof(uint32_t));
+    dst->len = src->len;
+    return true;
+}
+
+static bool bn_set_small(struct bignum *a, uint32_t v)
+{
+    if (!bn_reserve(a, 1))
+        return false;
+    a->limb[0] = v;
+    a->len = v != 0;
+    return true;
+}
+
+static bool bn_set_u64(struct bignum *a, uint64_t v)
+{
+    if (!bn_reserve(a, 2))
+        return false;
+    a->limb[0] = (uint32_t)v;
+    a->limb[1] = (uint32_t)(v >> 32);
+    a->len = 2;
+    bn_normalize(a);
+    return true;
+}
+
+static int bn_cmp(const struct bignum *a, const struct bignum *b)
+{
+    if (a->len != b->len)
+        return a->len < b->len ? -1 : 1;
+    for (size_t i = a->len; i-- > 0;) {
+        if (a->limb[i] != b->limb[i])
+            return a->limb[i] < b->limb[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+static bool bn_is_power_of_two(const struct bignum *a)
+{
+    if (a->len == 0 || (a->limb[a->len - 1] & (a->limb[a->len - 1] - 1)) != 0)
+        return false;
+    for (size_t i = 0; i + 1 < a->len; i++) {
+        if (a->limb[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+static size_t bn_bit_length(const struct bignum *a)
+{
+    if (a->len == 0)
+        return 0;
+    return 32 * a->len - (size_t)__builtin_clz(a->limb[a->len - 1]);
+}
+
+/* a = a * m + add */
+static bool bn_mul_small_add(struct bignum *a, uint32_t m, uint32_t add)
+{
+    uint64_t carry = add;
+    for (size_t i = 0; i < a->len; i++) {
+        uint64_t t = (uint64_t)a->limb[i] * m + carry;
+        a->limb[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+    if (carry) {
+        if (!bn_reserve(a, a->len + 1))
+            return false;
+        a->limb[a->len++] = (uint32_t)carry;
+    }
+    return true;
+}
+
+/* a = a / d, returning the remainder */
+static uint32_t bn_div_small(struct bignum *a, uint32_t d)
+{
+    uint64_t rem = 0;
+    for (size_t i = a->len; i-- > 0;) {
+        uint64_t cur = (rem << 32) | a->limb[i];
+        a->limb[i] = (uint32_t)(cur / d);
+        rem = cur % d;
+    }
+    bn_normalize(a);
+    return (uint32_t)rem;
+}
+
+/* r = a + b; r may alias a */
+static bool bn_add(struct bignum *r, const struct bignum *a, const struct bignum *b)
+{
+    size_t n = a->len > b->len ? a->len : b->len;
+    if (!bn_reserve(r, n + 1))
+        return false;
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t t = carry;
+        if (i < a->len) t += a->limb[i];
+        if (i < b->len) t += b->limb[i];
+        r->limb[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+    r->limb[n] = (uint32_t)carry;
+    r->len = n + 1;
+    bn_normalize(r);
+    return true;
+}
+
+/* r = a * b (schoolbook); r must not alias a or b */
+static bool bn_mul(struct bignum *r, const struct bignum *a, const struct bignum *b)
+{
+    if (a->len == 0 || b->len == 0)
+        return bn_set_small(r, 0);
+    if (!bn_reserve(r, a->len + b->len))
+        return false;
+    memset(r->limb, 0, (a->len + b->len) * sizeof(uint32_t));
+    for (size_t i = 0; i < a->len; i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b->len; j++) {
+            uint64_t t = (uint64_t)a->limb[i] * b->limb[j] + r->limb[i + j] + carry;
+            r->limb[i + j] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        r->limb[i + b->len] = (uint32_t)carry;
+    }
+    r->len = a->len + b->len;
+    bn_normalize(r);
+    return true;
+}
+
+/**
+ * @brief Long division q = a / b, r = a % b (Knuth's algorithm D).
+ *
+ * q and r must not alias a or b, or each other. b must be nonzero.
+ */
+static bool bn_divmod(struct bignum *q, struct bignum *r, const struct bignum *a, const struct bignum *b)
+{
+    if (bn_cmp(a, b) < 0)
+        return bn_set_small(q, 0) && bn_copy(r, a);
+    if (b->len == 1) {
+        if (!bn_copy(q, a))
+            return false;
+        return bn_set_small(r, bn_div_small(q, b->limb[0]));
+    }
+
+    size_t n = b->len, m = a->len - n;
+    int s = __builtin_clz(b->limb[n - 1]);
+    uint32_t *vn = malloc(n * sizeof(uint32_t));
+    uint32_t *un = malloc((a->len + 1) * sizeof(uint32_t));
+    stats_count_allocations((vn != NULL) + (un != NULL));
+    if (!vn || !un || !bn_reserve(q, m + 1) || !bn_reserve(r, n)) {
+        free(vn);
+        free(un);
+        return false;
+    }
+    // Normalize so the divisor's top bit is set; then each quotient digit
+    // estimate is off by at most two.
+    for (size_t i = n - 1; i > 0; i--)
+        vn[i] = (b->limb[i] << s) | (s ? b->limb[i - 1] >> (32 - s) : 0);
+    vn[0] = b->limb[0] << s;
+    un[a->len] = s ? a->limb[a->len - 1] >> (32 - s) : 0;
+    for (size_t i = a->len - 1; i > 0; i--)
+        un[i] = (a->limb[i] << s) | (s ? a->limb[i - 1] >> (32 - s) : 0);
+    un[0] = a->limb[0] << s;
+
+    for (size_t j = m + 1; j-- > 0;) {
+        uint64_t num = ((uint64_t)un[j + n] << 32) | un[j + n - 1];
+        uint64_t qhat = num / vn[n - 1];
+        uint64_t rhat = num % vn[n - 1];
+        while (qhat >> 32 || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+            qhat--;
+            rhat += vn[n - 1];
+            if (rhat >> 32)
+                break;
+        }
+        // Multiply and subtract.
+        int64_t borrow = 0, t;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t p = qhat * vn[i];
+            t = (int64_t)un[i + j] - borrow - (int64_t)(p & 0xFFFFFFFFu);
+            un[i + j] = (uint32_t)t;
+            borrow = (int64_t)(p >> 32) - (t >> 32);
+        }
+        t = (int64_t)un[j + n] - borrow;
+        un[j + n] = (uint32_t)t;
+        q->limb[j] = (uint32_t)qhat;
+        if (t < 0) {
+            // The estimate was one too large: add the divisor back.
+            q->limb[j]--;
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint64_t sum = (uint64_t)un[i + j] + vn[i] + carry;
+                un[i + j] = (uint32_t)sum;
+                carry = sum >> 32;
+            }
+            un[j + n] += (uint32_t)carry;
+        }
+    }
+    q->len = m + 1;
+    bn_normalize(q);
+    for (size_t i = 0; i < n; i++)
+        r->limb[i] = (un[i] >> s) | (s ? un[i + 1] << (32 - s) : 0);
+    r->len = n;
+    bn_normalize(r);
+    free(vn);
+    free(un);
+    return true;
+}
+
+/**
+ * @brief Sets a to the magnitude of a finite double, truncated toward zero.
+ */
+static bool bn_from_double(struct bignum *a, double d)
+{
+    int exp;
+    double frac = frexp(trunc(fabs(d)), &exp);
+    if (exp <= 64)
+        return bn_set_u64(a, (uint64_t)fabs(trunc(d)));
+    // 53 significant bits, then shift left 31 bits at a time.
+    if (!bn_set_u64(a, (uint64_t)ldexp(frac, 53)))
+        return false;
+    for (exp -= 53; exp > 0; exp -= 31) {
+        int step = exp < 31 ? exp : 31;
+        if (!bn_mul_small_add(a, 1u << step, 0))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Computes pow[k] = 10^(9 * 2^k) for k = 0 .. count - 1 by repeated squaring.
+ */
+static bool bn_decimal_powers(struct bignum *pow, int count)
+{
+    if (!bn_set_small(&pow[0], 1000000000u))
+        return false;
+    for (int k = 1; k < count; k++) {
+        if (!bn_mul(&pow[k], &pow[k - 1], &pow[k - 1]))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes exactly digits decimal digits of a (a < 10^digits), zero padded. Consumes a.
+ */
+static bool bn_to_decimal_rec(struct bignum *a, char *out, size_t digits, const struct bignum *pow, int k)
+{
+    while (k >= 0 && digits <= (size_t)9 << k)
+        k--;
+    if (k < 0 || a->len <= BN_BASE_LIMBS) {
+        // Base case: peel off nine digits per single-limb division.
+        while (digits > 0) {
+            uint32_t chunk = bn_div_small(a, 1000000000u);
+            for (int i = 0; i < 9 && digits > 0; i++) {
+                out[--digits] = (char)('0' + chunk % 10);
+                chunk /= 10;
+            }
+        }
+        return true;
+    }
+    size_t low_digits = (size_t)9 << k;
+    struct bignum q = { 0 }, r = { 0 };
+    bool ok = bn_divmod(&q, &r, a, &pow[k]) &&
+              bn_to_decimal_rec(&r, out + digits - low_digits, low_digits, pow, k - 1) &&
+              bn_to_decimal_rec(&q, out, digits - low_digits, pow, k - 1);
+    bn_free(&q);
+    bn_free(&r);
+    return ok;
+}
+
+/**
+ * @brief Formats a magnitude in decimal.
+ * @param a The magnitude; it is consumed.
+ * @param negative Whether to prefix a minus sign (ignored for zero).
+ * @param out Buffer receiving the text.
+ * @param outlen Size of the buffer; bn_decimal_size() bytes are always enough.
+ * @return true on success, false on allocation failure or a short buffer.
+ */
+static bool bn_to_decimal(struct bignum *a, bool negative, char *out, size_t outlen)
+{
+    // 1234/4096 slightly exceeds log10(2), so this bounds the digit count.
+    size_t digits = bn_bit_length(a) * 1234 / 4096 + 1;
+    if (outlen < digits + 2)
+        return false;
+    struct bignum pow[BN_MAX_POWERS] = { { 0 } };
+    int levels = 0;
+    while (levels < BN_MAX_POWERS && ((size_t)9 << levels) < digits)
+        levels++;
+    bool ok = (levels == 0 || bn_decimal_powers(pow, levels)) &&
+              bn_to_decimal_rec(a, out + 1, digits, pow, levels - 1);
+    for (int k = 0; k < levels; k++)
+        bn_free(&pow[k]);
+    if (!ok)
+        return false;
+    // Drop the padding zeros (keeping one for zero) and place the sign.
+    size_t skip = 0;
+    while (skip + 1 < digits && out[1 + skip] == '0')
+        skip++;
+    bool minus = negative && !(digits - skip == 1 && out[1 + skip] == '0');
+    size_t start = minus ? skip : skip + 1;
+    if (minus)
+        out[skip] = '-';
+    memmove(out, out + start, 1 + digits - start);
+    out[1 + digits - start] = '\0';
+    return true;
+}
+
+static size_t bn_decimal_size(size_t nbits)
+{
+    return nbits * 1234 / 4096 + 3;
+}
+
+/**
+ * @brief Parses n decimal digits into r.
+ */
+static bool bn_from_decimal_rec(struct bignum *r, const char *s, size_t n, const struct bignum *pow, int k)
+{
+    while (k >= 0 && n <= (size_t)9 << k)
+        k--;
+    if (k < 0 || n <= 9 * BN_BASE_LIMBS) {
+        // Base case: multiply-accumulate nine digits at a time.
+        if (!bn_set_small(r, 0))
+            return false;
+        size_t head = n % 9 ? n % 9 : 9;
+        for (size_t i = 0; i < n; head = 9) {
+            uint32_t chunk = 0, scale = 1;
+            for (size_t j = 0; j < head; j++, i++) {
+                chunk = chunk * 10 + (uint32_t)(s[i] - '0');
+                scale *= 10;
+            }
+            if (!bn_mul_small_add(r, scale, chunk))
+                return false;
+        }
+        return true;
+    }
+    size_t low_digits = (size_t)9 << k;
+    struct bignum hi = { 0 }, lo = { 0 };
+    bool ok = bn_from_decimal_rec(&hi, s, n - low_digits, pow, k - 1) &&
+              bn_from_decimal_rec(&lo, s + n - low_digits, low_digits, pow, k - 1) &&
+              bn_mul(r, &hi, &pow[k]) &&
+              bn_add(r, r, &lo);
+    bn_free(&hi);
+    bn_free(&lo);
+    return ok;
+}
+
+static bool bn_from_decimal(struct bignum *r, const char *s, size_t n)
+{
+    struct bignum pow[BN_MAX_POWERS] = { { 0 } };
+    int levels = 0;
+    while (levels < BN_MAX_POWERS && ((size_t)9 << levels) < n)
+        levels++;
+    bool ok = (levels == 0 || bn_decimal_powers(pow, levels)) &&
+              bn_from_decimal_rec(r, s, n, pow, levels - 1);
+    for (int k = 0; k < levels; k++)
+        bn_free(&pow[k]);
+    return ok;
+}
+
+/**
+ * @brief Parses binary digits (already validated) into a magnitude.
+ */
+static bool bn_from_binary(struct bignum *a, const char *digits, size_t len)
+{
+    size_t nlimbs = (len + 31) / 32;
+    if (!bn_reserve(a, nlimbs ? nlimbs : 1))
+        return false;
+    // Limbs are filled from the least significant end, 32 digits at a time.
+    for (size_t i = 0; i < nlimbs; i++) {
+        size_t end = len - 32 * i;
+        size_t start = end >= 32 ? end - 32 : 0;
+        unsigned long bits;
+        scan_binary_digits_n(digits + start, end - start, &bits);
+        a->limb[i] = (uint32_t)bits;
+    }
+    a->len = nlimbs;
+    bn_normalize(a);
+    return true;
+}
+
+/**
+ * @brief Writes the low numbits bits of a magnitude as binary digits (no terminator).
+ */
+static void bn_to_binary(const struct bignum *a, size_t numbits, bool complement, char *out)
+{
+    size_t nlimbs = (numbits + 31) / 32;
+    size_t top = numbits - 32 * (nlimbs - 1);
+    for (size_t i = nlimbs; i-- > 0;) {
+        uint32_t limb = i < a->len ? a->limb[i] : 0;
+        unsigned int width = (i == nlimbs - 1) ? (unsigned int)top : 32;
+        emit_binary_digits(limb, width, complement, out);
+        out += width;
+    }
+}
+
+/* a = a mod 2^nbits */
+static void bn_truncate(struct bignum *a, size_t nbits)
+{
+    size_t nlimbs = (nbits + 31) / 32;
+    if (a->len > nlimbs)
+        a->len = nlimbs;
+    if (a->len == nlimbs && nbits % 32)
+        a->limb[nlimbs - 1] &= (1u << (nbits % 32)) - 1;
+    bn_normalize(a);
+}
+
+/* a = (2^nbits - a) mod 2^nbits, or with complement_only, a = (2^nbits - 1) - a */
+static bool bn_negate_mod(struct bignum *a, size_t nbits, bool complement_only)
+{
+    size_t nlimbs = (nbits + 31) / 32;
+    if (!bn_reserve(a, nlimbs ? nlimbs : 1))
+        return false;
+    for (size_t i = a->len; i < nlimbs; i++)
+        a->limb[i] = 0;
+    uint64_t carry = complement_only ? 0 : 1;
+    for (size_t i = 0; i < nlimbs; i++) {
+        uint64_t t = (uint64_t)(uint32_t)~a->limb[i] + carry;
+        a->limb[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+    a->len = nlimbs;
+    bn_truncate(a, nbits);
+    return true;
+}
+
+/**
+ * @brief Decodes binary digits of any width into a sign and magnitude.
+ * @param digits The binary digits (already validated).
+ * @param len The number of digits.
+ * @param system SYS_UNSIGNED, SYS_SIGNED_MAGNITUDE, SYS_ONES_COMPLEMENT or SYS_TWOS_COMPLEMENT.
+ * @param mag Receives the magnitude.
+ * @param negative Receives the sign (false for zero).
+ * @return false on allocation failure.
+ */
+static bool wide_decode(const char *digits, size_t len, int system, struct bignum *mag, bool *negative)
+{
+    bool sign = len > 0 && digits[0] == '1' && system != SYS_UNSIGNED;
+    bool ok;
+    switch (system) {
+        case SYS_SIGNED_MAGNITUDE:
+            ok = bn_from_binary(mag, digits + 1, len - 1);
+            break;
+        case SYS_ONES_COMPLEMENT:
+            ok = bn_from_binary(mag, digits + 1, len - 1) && (!sign || bn_negate_mod(mag, len - 1, true));
+            break;
+        case SYS_TWOS_COMPLEMENT:
+            ok = bn_from_binary(mag, digits, len) && (!sign || bn_negate_mod(mag, len, false));
+            break;
+        default:
+            ok = bn_from_binary(mag, digits, len);
+            break;
+    }
+    *negative = sign && mag->len != 0;
+    return ok;
+}
+
+/**
+ * @brief Encodes a sign and magnitude as numbits binary digits in one of the integer systems.
+ *
+ * Like the 64-bit encoders, magnitudes too large for the field saturate to all ones.
+ *
+ * @param mag The magnitude; it may be modified.
+ * @param negative The sign.
+ * @param system The output system; unsigned output must not be negative.
+ * @param numbits The output width.
+ * @param out Buffer receiving numbits digits and a terminator.
+ * @return false on allocation failure.
+ */
+static bool wide_encode(struct bignum *mag, bool negative, int system, size_t numbits, char *out)
+{
+    out[numbits] = '\0';
+    if (numbits == 0)
+        return true;
+    size_t field = (system == SYS_SIGNED_MAGNITUDE) ? numbits - 1 : numbits;
+    bool saturated = bn_bit_length(mag) > field;
+    if (system == SYS_TWOS_COMPLEMENT && negative) {
+        // 2^n - mag, where -2^n wraps to zero and anything below it saturates.
+        saturated = bn_bit_length(mag) > numbits + 1 ||
+                    (bn_bit_length(mag) == numbits + 1 && !bn_is_power_of_two(mag));
+        if (saturated)
+            memset(out, '1', numbits);
+        else if (!bn_negate_mod(mag, numbits, false))
+            return false;
+        else
+            bn_to_binary(mag, numbits, false, out);
+        return true;
+    }
+    if (system == SYS_SIGNED_MAGNITUDE) {
+        *out++ = negative ? '1' : '0';
+    }
+    bool complement = (system == SYS_ONES_COMPLEMENT && negative);
+    if (saturated)
+        memset(out, complement ? '0' : '1', field);
+    else
+        bn_to_binary(mag, field, complement, out);
+    return true;
+}
+
+/**
+ * @brief Converts binary digits of any width to decimal text.
+ * @param digits The binary digits.
+ * @param len The number of digits.
+ * @param system The integer system the digits are in.
+ * @param out Buffer receiving the decimal text.
+ * @param outlen Size of the buffer; len * 0.302 + 3 bytes are always enough.
+ * @return out, or NULL on invalid digits, allocation failure or a short buffer.
+ */
+static char *wide_binary_to_decimal_buf(const char *digits, size_t len, int system, char *out, size_t outlen)
+{
+    unsigned long ignored;
+    if (len == 0 || scan_binary_digits_n(digits, len, &ignored) != len)
+        return NULL;
+    struct bignum mag = { 0 };
+    bool negative;
+    bool ok = wide_decode(digits, len, system, &mag, &negative) &&
+              bn_to_decimal(&mag, negative, out, outlen);
+    bn_free(&mag);
+    return ok ? out : NULL;
+}
+
+/**
+ * @brief Heap-allocating variant of wide_binary_to_decimal_buf().
+ * @return The decimal text (allocated on the heap), or NULL on error.
+ */
+static char *wide_binary_to_decimal(const char *digits, size_t len, int system)
+{
+    size_t size = bn_decimal_size(len);
+    char *out = malloc(size);
+    stats_count_allocations(out != NULL);
+    if (out && !wide_binary_to_decimal_buf(digits, len, system, out, size)) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+/**
+ * @brief Converts decimal text to binary digits of any width.
+ *
+ * Plain text (an optional sign, digits and an optional fraction) is converted
+ * exactly; anything else parse_decimal() accepts, such as an exponent, is
+ * converted through a double. The fraction is truncated like the (long) conversion of
+ * the 64-bit path.
+ *
+ * @param text The decimal text.
+ * @param len Length of the text.
+ * @param system The integer output system.
+ * @param numbits The output width.
+ * @param out Buffer receiving the binary string.
+ * @param outlen Size of the buffer; must be at least numbits + 1.
+ * @param error Set to a message describing the failure when NULL is returned.
+ * @return out, or NULL on error.
+ */
+static char *wide_decimal_to_binary(const char *text, size_t len, int system, unsigned int numbits,
+                                    char *out, size_t outlen, const char **error)
+{
+    size_t i = 0;
+    bool negative = false;
+    if (numbits < 1 || outlen < (size_t)numbits + 1) {
+        *error = "Invalid number of bits.";
+        return NULL;
+    }
+    while (i < len && (text[i] == ' ' || text[i] == '\t'))
+        i++;
+    if (i < len && (text[i] == '+' || text[i] == '-'))
+        negative = text[i++] == '-';
+    size_t start = i;
+    while (i < len && text[i] >= '0' && text[i] <= '9')
+        i++;
+    size_t int_end = i;
+    bool nonzero_fraction = false;
+    if (i < len && text[i] == '.') {
+        for (i++; i < len && text[i] >= '0' && text[i] <= '9'; i++)
+            nonzero_fraction |= text[i] != '0';
+    }
+    struct bignum mag = { 0 };
+    bool ok;
+    if (i != len || int_end == start) {
+        // Not a plain decimal (an exponent, say): go through a double instead.
+        double dvalue;
+        bool exact = true;
+        if (!parse_decimal_exact(text, len, &dvalue, status_checking ? &exact : NULL)) {
+            status_raise(NUMCONV_INVALID);
+            *error = "Invalid decimal input.";
+            return NULL;
+        }
+        if (!integer_input_finite(dvalue, error))
+            return NULL;
+        negative = dvalue < 0;
+        nonzero_fraction = trunc(dvalue) != dvalue;
+        // Text the double only approximates was rounded on the way.
+        status_raise((unsigned int)!exact * NUMCONV_INEXACT);
+        ok = bn_from_double(&mag, dvalue);
+    } else {
+        while (start < int_end && text[start] == '0')
+            start++;
+        if (negative && start == int_end && !nonzero_fraction)
+            negative = false;
+        ok = bn_from_decimal(&mag, text + start, int_end - start);
+    }
+    if (ok && negative && system == SYS_UNSIGNED) {
+        bn_free(&mag);
+        status_raise(NUMCONV_OVERFLOW);
+        *error = "Cannot represent a negative number in an unsigned binary system.";
+        return NULL;
+    }
+    if (ok && status_checking)
+        status_raise(length_range_status(system, bn_bit_length(&mag), bn_is_power_of_two(&mag),
+                                         negative && mag.len != 0, numbits) |
+                     (unsigned int)nonzero_fraction * NUMCONV_TRUNCATED);
+    ok = ok && wide_encode(&mag, negative && mag.len != 0, system, numbits, out);
+    bn_free(&mag);
+    if (!ok) {
+        *error = "Conversion failed due to an error (memory allocation).";
+        return NULL;
+    }
+    return out;
+}
+
+/*
+ * Direct transcoding.
+ *
+ * Re-encoding between the four integer systems needs no arithmetic on the
+ * value: every change of representation is a bitwise transform of the digit
+ * string. Complementing flips digits, two's complement negation flips the
+ * digits left of the rightmost 1, and moving between one's and two's
+ * complement is an increment or decrement, i.e. flipping the trailing run up
+ * to the rightmost 0 or 1. Same-width conversions are therefore one pass over
+ * the digits; other widths go through the sign and magnitude digits and then
+ * pad or saturate them, exactly as the encoders do, at any width.
+ */
+
+/* dst = src with every digit flipped, eight digits per step ('0' ^ 1 == '1'). */
+static void flip_digits(char *dst, const char *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, src + i, 8);
+        w ^= 0x0101010101010101ULL;
+        memcpy(dst + i, &w, 8);
+    }
+    for (; i < n; i++)
+        dst[i] = (char)(src[i] ^ 1);
+}
+
+/* Index of the last occurrence of c in s[0..n), or n if there is none. */
+static size_t last_digit(const char *s, size_t n, char c)
+{
+    for (size_t i = n; i-- > 0;) {
+        if (s[i] == c)
+            return i;
+    }
+    return n;
+}
+
+/* dst = (2^n - src) mod 2^n: flip the digits left of the rightmost 1. dst may alias src. */
+static void negate_digits(char *dst, const char *src, size_t n)
+{
+    size_t r = last_digit(src, n, '1');
+    if (r == n) {
+        memset(dst, '0', n);
+        return;
+    }
+    if (dst != src)
+        memcpy(dst + r, src + r, n - r);
+    flip_digits(dst, src, r);
+}
+
+/*
+ * dst = src + 1 (add is true) or src - 1, modulo 2^n: the trailing run of 1s
+ * (0s) becomes 0s (1s) and the digit before it flips. dst may alias src.
+ */
+static void step_digits(char *dst, const char *src, size_t n, bool add)
+{
+    size_t r = last_digit(src, n, add ? '0' : '1');
+    if (r == n) {
+        memset(dst, add ? '0' : '1', n);
+        return;
+    }
+    if (dst != src)
+        memcpy(dst, src, r);
+    dst[r] = add ? '1' : '0';
+    memset(dst + r + 1, add ? '0' : '1', n - r - 1);
+}
+
+static bool all_digits(const char *s, size_t n, char c)
+{
+    return last_digit(s, n, c == '0' ? '1' : '0') == n;
+}
+
+/**
+ * @brief Same-width transcoding: one pass over the digits.
+ */
+static char *transcode_same_width(const char *in, size_t n, int from, int to, char *out, const char **error)
+{
+    bool negative = in[0] == '1' && from != SYS_UNSIGNED;
+    // Only unsigned values using the top digit and the most negative two's complement value lose range.
+    if (status_checking && from != to)
+        status_raise((unsigned int)((from == SYS_UNSIGNED && in[0] == '1') ||
+                                    (from == SYS_TWOS_COMPLEMENT && negative && all_digits(in + 1, n - 1, '0'))) *
+                     NUMCONV_OVERFLOW);
+    // Negative zero (sign-magnitude 10..0, one's complement 11..1) is plain zero.
+    if (negative && ((from == SYS_SIGNED_MAGNITUDE && all_digits(in + 1, n - 1, '0')) ||
+                     (from == SYS_ONES_COMPLEMENT && all_digits(in + 1, n - 1, '1')))) {
+        memset(out, '0', n);
+        return out;
+    }
+    if (from == SYS_UNSIGNED && to == SYS_SIGNED_MAGNITUDE && in[0] == '1') {
+        // No room for the sign: saturate.
+        out[0] = '0';
+        memset(out + 1, '1', n - 1);
+        return out;
+    }
+    if (from == to || !negative) {
+        memcpy(out, in, n);
+        return out;
+    }
+    if (to == SYS_UNSIGNED) {
+        status_raise(NUMCONV_OVERFLOW);
+        *error = "Cannot represent a negative number in an unsigned binary system.";
+        return NULL;
+    }
+    switch (from * 8 + to) {
+        case SYS_SIGNED_MAGNITUDE * 8 + SYS_ONES_COMPLEMENT:
+        case SYS_ONES_COMPLEMENT * 8 + SYS_SIGNED_MAGNITUDE:
+            out[0] = '1';
+            flip_digits(out + 1, in + 1, n - 1);
+            break;
+        case SYS_SIGNED_MAGNITUDE * 8 + SYS_TWOS_COMPLEMENT:
+            out[0] = '0';
+            memcpy(out + 1, in + 1, n - 1);
+            negate_digits(out, out, n);
+            break;
+        case SYS_ONES_COMPLEMENT * 8 + SYS_TWOS_COMPLEMENT:
+            step_digits(out, in, n, true);
+            break;
+        case SYS_TWOS_COMPLEMENT * 8 + SYS_SIGNED_MAGNITUDE:
+            // The most negative value's magnitude needs all n digits: saturate.
+            if (all_digits(in + 1, n - 1, '0'))
+                memset(out + 1, '1', n - 1);
+            else
+                negate_digits(out + 1, in + 1, n - 1);
+            out[0] = '1';
+            break;
+        case SYS_TWOS_COMPLEMENT * 8 + SYS_ONES_COMPLEMENT:
+            step_digits(out, in, n, false);
+            break;
+    }
+    return out;
+}
+
+/**
+ * @brief Transcodes binary digits between the integer systems without decoding the value.
+ *
+ * The result is the one decoding the input and encoding the value again
+ * would produce, including saturation to all ones when the value does not
+ * fit, but no step does arithmetic wider than a digit, so any width works.
+ *
+ * @param in The binary digits; they must already be validated.
+ * @param len The number of digits (at least one).
+ * @param from The input system (SYS_UNSIGNED .. SYS_TWOS_COMPLEMENT).
+ * @param to The output system (SYS_UNSIGNED .. SYS_TWOS_COMPLEMENT).
+ * @param numbits The output width; 0 keeps the input width.
+ * @param out Buffer receiving the binary string.
+ * @param outlen Size of the buffer; must be at least numbits + 1.
+ * @param error Set to a message describing the failure when NULL is returned.
+ * @return out, or NULL on error.
+ */
+static char *transcode_integer_digits(const char *in, size_t len, int from, int to, unsigned int numbits,
+                                      char *out, size_t outlen, const char **error)
+{
+    size_t m = numbits ? numbits : len;
+    if (outlen < m + 1) {
+        *error = "Conversion failed due to an error (invalid width or output buffer too small).";
+        return NULL;
+    }
+    out[m] = '\0';
+    if (m == len)
+        return transcode_same_width(in, len, from, to, out, error);
+
+    // Sign and magnitude digits; the complement forms need a scratch copy.
+    bool negative = in[0] == '1' && from != SYS_UNSIGNED;
+    const char *mag = in;
+    size_t mag_len = len;
+    char small[256], *scratch = NULL;
+    if (from == SYS_SIGNED_MAGNITUDE || (from == SYS_ONES_COMPLEMENT && !negative)) {
+        mag++;
+        mag_len--;
+    } else if (negative) {
+        scratch = (len <= sizeof(small)) ? small : malloc(len);
+        stats_count_allocations(scratch != small && scratch != NULL);
+        if (scratch == NULL) {
+            *error = "Conversion failed due to an error (memory allocation).";
+            return NULL;
+        }
+        if (from == SYS_ONES_COMPLEMENT) {
+            flip_digits(scratch, in + 1, len - 1);
+            mag_len--;
+        } else {
+            negate_digits(scratch, in, len);
+        }
+        mag = scratch;
+    }
+    const char *first = memchr(mag, '1', mag_len);
+    size_t lead = first ? (size_t)(first - mag) : mag_len;
+    mag += lead;
+    mag_len -= lead;
+    if (mag_len == 0)
+        negative = false;
+
+    char *result = out;
+    size_t field = (to == SYS_SIGNED_MAGNITUDE) ? m - 1 : m;
+    if (status_checking) {
+        size_t bits = m - (to != SYS_UNSIGNED);
+        bool power_of_two = mag_len == bits + 1 && all_digits(mag + 1, mag_len - 1, '0');
+        status_raise(length_range_status(to, mag_len, power_of_two, negative, m));
+    }
+    if (negative && to == SYS_UNSIGNED) {
+        status_raise(NUMCONV_OVERFLOW);
+        *error = "Cannot represent a negative number in an unsigned binary system.";
+        result = NULL;
+    } else if (negative && to == SYS_TWOS_COMPLEMENT) {
+        // 2^m - mag; -2^m wraps to zero and anything below it saturates.
+        if (mag_len > m + 1 || (mag_len == m + 1 && !all_digits(mag + 1, mag_len - 1, '0'))) {
+            memset(out, '1', m);
+        } else if (mag_len == m + 1) {
+            memset(out, '0', m);
+        } else {
+            memset(out, '0', m - mag_len);
+            memcpy(out + m - mag_len, mag, mag_len);
+            negate_digits(out, out, m);
+        }
+    } else {
+        char *dst = out;
+        if (to == SYS_SIGNED_MAGNITUDE)
+            *dst++ = negative ? '1' : '0';
+        bool complement = negative && to == SYS_ONES_COMPLEMENT;
+        if (mag_len > field) {
+            memset(dst, complement ? '0' : '1', field);
+        } else {
+            memset(dst, complement ? '1' : '0', field - mag_len);
+            if (complement)
+                flip_digits(dst + field - mag_len, mag, mag_len);
+            else
+                memcpy(dst + field - mag_len, mag, mag_len);
+        }
+    }
+    if (scratch != small)
+        free(scratch);
+    return result;
+}
+
+/*
+ * Other radixes.
+ *
+ * Bit patterns can also be written in any radix from 2 to 36, with digits
+ * 0-9 then A-Z (either case on input). A pattern of n digits is as wide as
+ * the largest value n digits can hold, so hexadecimal digits are four bits
+ * each and octal digits three, and output is zero-padded to the digits the
+ * largest value of its width needs. Power-of-two radixes map every digit to
+ * a fixed group of bits through the digit_bits table, whose last four and
+ * last three columns are the nibbles and triplets; other radixes go through
+ * the value, in a machine word or a bignum.
+ */
+static const char radix_digit_chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+/* The five binary digits of every 5-bit group (NUL padded). */
+static const char digit_bits[32][6] = {
+    "00000", "00001", "00010", "00011", "00100", "00101", "00110", "00111",
+    "01000", "01001", "01010", "01011", "01100", "01101", "01110", "01111",
+    "10000", "10001", "10010", "10011", "10100", "10101", "10110", "10111",
+    "11000", "11001", "11010", "11011", "11100", "11101", "11110", "11111",
+};
+
+/* Bits per digit of a power-of-two radix, or 0 for other radixes. */
+static inline unsigned int radix_shift(unsigned int radix)
+{
+    return (radix & (radix - 1)) == 0 ? (unsigned int)__builtin_ctz(radix) : 0;
+}
+
+/* The value of a digit in any radix up to 36, or 36 for other characters. */
+static inline unsigned int radix_digit_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return (unsigned int)(c - '0');
+    c |= 0x20;
+    if (c >= 'a' && c <= 'z')
+        return (unsigned int)(c - 'a' + 10);
+    return 36;
+}
+
+/**
+ * @brief Parses a radix given on the command line or in a menu choice.
+ * @param arg A number from 2 to 36, or "bin", "oct", "dec" or "hex".
+ * @return The radix, or 0 if the argument is not recognized.
+ */
+unsigned int parse_radix(const char *arg)
+{
+    static const char *const names[] = { "bin", "oct", "dec", "hex" };
+    static const unsigned int radixes[] = { 2, 8, 10, 16 };
+    char *end;
+    long n = strtol(arg, &end, 10);
+    if (*arg != '\0' && *end == '\0')
+        return (n >= 2 && n <= 36) ? (unsigned int)n : 0;
+    for (int i = 0; i < 4; i++) {
+        if (strcasecmp(arg, names[i]) == 0)
+            return radixes[i];
+    }
+    return 0;
+}
+
+/**
+ * @brief Computes the width of the bit pattern a number of digits holds.
+ * @param ndigits The number of digits.
+ * @param radix The radix, 2 to 36.
+ * @return The bits needed for the largest value of ndigits digits.
+ */
+static size_t radix_pattern_bits(size_t ndigits, unsigned int radix)
+{
+    unsigned int shift = radix_shift(radix);
+    if (shift)
+        return ndigits * shift;
+    // ndigits * log2(radix) is never an integer here, so the margin only guards rounding.
+    return (size_t)ceil((double)ndigits * log2(radix) + 1e-6);
+}
+
+/**
+ * @brief Computes the number of digits a bit pattern is written with.
+ * @param nbits The width of the pattern.
+ * @param radix The radix, 2 to 36.
+ * @return The digits needed for the largest value of nbits bits.
+ */
+static size_t radix_pattern_digits(size_t nbits, unsigned int radix)
+{
+    unsigned int shift = radix_shift(radix);
+    if (shift)
+        return (nbits + shift - 1) / shift;
+    return (size_t)ceil((double)nbits / log2(radix) + 1e-6);
+}
+
+/* Parses digits of a radix, holding a pattern of at most 64 bits, into its value. */
+static bool scan_radix_digits(const char *s, size_t len, unsigned int radix, unsigned long *value)
+{
+    if (radix == 2)
+        return scan_binary_digits_n(s, len, value) == len;
+    unsigned int shift = radix_shift(radix);
+    unsigned long v = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned int d = radix_digit_value(s[i]);
+        if (d >= radix)
+            return false;
+        v = shift ? (v << shift) | d : v * radix + d;
+    }
+    *value = v;
+    return true;
+}
+
+/**
+ * @brief Writes a bit pattern of at most 64 bits as digits of a radix (no terminator).
+ * @param value The pattern in its low numbits bits.
+ * @param numbits The width of the pattern, 1 to 64.
+ * @param radix The radix, 2 to 36.
+ * @param out Buffer receiving radix_pattern_digits(numbits, radix) characters.
+ * @return The number of digits written.
+ */
+static size_t emit_radix_digits(unsigned long value, unsigned int numbits, unsigned int radix, char *out)
+{
+    if (radix == 2) {
+        emit_binary_digits(value, numbits, false, out);
+        return numbits;
+    }
+    size_t n = radix_pattern_digits(numbits, radix);
+    unsigned int shift = radix_shift(radix);
+    if (numbits < 64)
+        value &= (1UL << numbits) - 1;
+    if (shift) {
+        for (size_t i = n; i-- > 0; value >>= shift)
+            out[i] = radix_digit_chars[value & (radix - 1)];
+    } else {
+        for (size_t i = n; i-- > 0; value /= radix)
+            out[i] = radix_digit_chars[value % radix];
+    }
+    return n;
+}
+
+/**
+ * @brief Converts digits of a radix to the binary digits of a bit pattern.
+ * @param in The digits; no terminator is needed.
+ * @param len The number of digits.
+ * @param radix The radix, 2 to 36.
+ * @param width The width of the pattern; the value is zero-extended to it.
+ * @param out Buffer receiving the binary string.
+ * @param outlen Size of the buffer; must be at least width + 1.
+ * @param error Set to a message describing the failure when NULL is returned.
+ * @return out, or NULL on invalid digits, a value wider than width or allocation failure.
+ */
+static char *radix_to_binary(const char *in, size_t len, unsigned int radix, size_t width, char *out, size_t outlen,
+                             const char **error)
+{
+    const char *too_wide = "Invalid number input. The value does not fit in the bit pattern.";
+    if (len == 0 || width == 0 || outlen < width + 1) {
+        status_raise(NUMCONV_INVALID);
+        *error = "Invalid number input. Please enter only digits of the chosen radix.";
+        return NULL;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (radix_digit_value(in[i]) >= radix) {
+            status_raise(NUMCONV_INVALID);
+            *error = "Invalid number input. Please enter only digits of the chosen radix.";
+            return NULL;
+        }
+    }
+    out[width] = '\0';
+
+    unsigned int shift = radix_shift(radix);
+    if (shift) {
+        // Each digit is a group of shift bits, placed from the right; bits above width must be zero.
+        size_t pos = width;
+        for (size_t i = len; i-- > 0;) {
+            const char *group = digit_bits[radix_digit_value(in[i])] + 5 - shift;
+            size_t take = pos < shift ? pos : shift;
+            if (memchr(group, '1', shift - take) != NULL) {
+                status_raise(NUMCONV_INVALID);
+                *error = too_wide;
+                return NULL;
+            }
+            pos -= take;
+            memcpy(out + pos, group + shift - take, take);
+        }
+        memset(out, '0', pos);
+        return out;
+    }
+
+    if (radix_pattern_bits(len, radix) <= 64) {
+        unsigned long value;
+        scan_radix_digits(in, len, radix, &value);
+        if (width < 64 && (value >> width) != 0) {
+            status_raise(NUMCONV_INVALID);
+            *error = too_wide;
+            return NULL;
+        }
+        if (width > 64) {
+            memset(out, '0', width - 64);
+            emit_binary_digits(value, 64, false, out + width - 64);
+        } else {
+            emit_binary_digits(value, (unsigned int)width, false, out);
+        }
+        return out;
+    }
+
+    // Wider values accumulate in a bignum, as many digits per step as fit in 32 bits.
+    struct bignum a = { 0 };
+    bool ok = true;
+    uint32_t mult = 1, acc = 0;
+    for (size_t i = 0; i < len && ok; i++) {
+        acc = acc * radix + radix_digit_value(in[i]);
+        mult *= radix;
+        if (mult > UINT32_MAX / radix || i + 1 == len) {
+            ok = bn_mul_small_add(&a, mult, acc);
+            mult = 1;
+            acc = 0;
+        }
+    }
+    char *result = out;
+    if (!ok) {
+        *error = "Conversion failed due to an error (memory allocation).";
+        result = NULL;
+    } else if (bn_bit_length(&a) > width) {
+        status_raise(NUMCONV_INVALID);
+        *error = too_wide;
+        result = NULL;
+    } else {
+        bn_to_binary(&a, width, false, out);
+    }
+    bn_free(&a);
+    return result;
+}
+
+/**
+ * @brief Writes a bit pattern given as binary digits in another radix.
+ * @param digits The binary digits (already validated).
+ * @param len The width of the pattern.
+ * @param radix The radix, 2 to 36.
+ * @param out Buffer receiving the digits; it must not overlap digits.
+ * @param outlen Size of the buffer; len + 1 bytes are always enough.
+ * @return out, or NULL on allocation failure or a short buffer.
+ */
+static char *binary_to_radix(const char *digits, size_t len, unsigned int radix, char *out, size_t outlen)
+{
+    size_t n = radix_pattern_digits(len, radix);
+    if (len == 0 || outlen < n + 1)
+        return NULL;
+    out[n] = '\0';
+
+    unsigned int shift = radix_shift(radix);
+    if (shift) {
+        // Gather shift digits per output digit from the right; the leftmost group may be short.
+        const char *end = digits + len;
+        for (size_t i = n; i-- > 0;) {
+            const char *start = (size_t)(end - digits) > shift ? end - shift : digits;
+            unsigned int v = 0;
+            for (const char *p = start; p < end; p++)
+                v = (v << 1) | (unsigned int)(*p - '0');
+            out[i] = radix_digit_chars[v];
+            end = start;
+        }
+        return out;
+    }
+
+    if (len <= 64) {
+        unsigned long value;
+        scan_binary_digits_n(digits, len, &value);
+        emit_radix_digits(value, (unsigned int)len, radix, out);
+        return out;
+    }
+
+    // Wider patterns divide a bignum by the largest power of the radix fitting in 32 bits.
+    struct bignum a = { 0 };
+    if (!bn_from_binary(&a, digits, len)) {
+        bn_free(&a);
+        return NULL;
+    }
+    unsigned int per_step = 0;
+    uint32_t divisor = 1;
+    while (divisor <= UINT32_MAX / radix) {
+        divisor *= radix;
+        per_step++;
+    }
+    for (size_t i = n; i > 0;) {
+        uint32_t rem = bn_div_small(&a, divisor);
+        for (unsigned int k = 0; k < per_step && i > 0; k++, rem /= radix)
+            out[--i] = radix_digit_chars[rem % radix];
+    }
+    bn_free(&a);
+    return out;
+}
+
+/**
+ * @brief Computes the buffer size convert_number_radix() needs for a conversion.
+ * @param len Length of the number to convert.
+ * @param inputSystem The input system.
+ * @param in_radix The radix of a binary input's digits (2 for plain binary).
+ * @param outputSystem The output system.
+ * @param numbits Width of an integer output; 0 keeps the width of a binary input.
+ * @param in_format The format of an IEEE754 input.
+ * @param out_format The format of an IEEE754 output.
+ * @return The number of bytes required, including the null terminator.
+ */
+static size_t convert_output_size_radix(size_t len, int inputSystem, unsigned int in_radix, int outputSystem,
+                                        unsigned int numbits, const struct numconv_ieee754_format *in_format,
+                                        const struct numconv_ieee754_format *out_format)
+{
+    // Digits in any radix take no more room than the binary ones.
+    if (in_radix > 2 && inputSystem == SYS_IEEE754)
+        len = (size_t)(1 + in_format->exp_bits + in_format->mantissa_bits);
+    else if (in_radix > 2 && inputSystem != SYS_DECIMAL)
+        len = radix_pattern_bits(len, in_radix);
+    return convert_output_size(len, inputSystem, outputSystem, numbits, out_format);
+}
+
+static char *convert_radix_digits(const char *numberStr, size_t len, int inputSystem, unsigned int in_radix,
+                                  int outputSystem, unsigned int out_radix, unsigned int numbits,
+                                  const struct numconv_ieee754_format *in_format,
+                                  const struct numconv_ieee754_format *out_format,
+                                  int rounding_mode, char *out, size_t outlen, const char **error);
+
+/**
+ * @brief Converts one number like convert_number(), with bit patterns written in any radix.
+ *
+ * A binary input of n digits is a pattern of radix_pattern_bits(n, in_radix)
+ * bits, except that IEEE754 input is always as wide as its format and its
+ * digits must fit in it. Binary outputs are written with radix_pattern_digits() digits.
+ * Decimal input and output are unaffected by the radixes.
+ *
+ * @param in_radix The radix of the input digits, 2 to 36.
+ * @param out_radix The radix of the output digits, 2 to 36.
+ * @param out Buffer receiving the result (see convert_output_size_radix()).
+ * @return out on success, or NULL on error.
+ */
+static char *convert_number_radix(const char *numberStr, size_t len, int inputSystem, unsigned int in_radix,
+                                  int outputSystem, unsigned int out_radix, unsigned int numbits,
+                                  const struct numconv_ieee754_format *in_format,
+                                  const struct numconv_ieee754_format *out_format,
+                                  int rounding_mode, char *out, size_t outlen, const char **error)
+{
+    if (!stats_enabled)
+        return convert_radix_digits(numberStr, len, inputSystem, in_radix, outputSystem, out_radix, numbits,
+                                    in_format, out_format, rounding_mode, out, outlen, error);
+    unsigned int width = numbits ? numbits
+                                 : inputSystem == SYS_DECIMAL ? 0 : (unsigned int)radix_pattern_bits(len, in_radix);
+    struct stats_mark mark;
+    stats_begin(&mark);
+    char *result = convert_radix_digits(numberStr, len, inputSystem, in_radix, outputSystem, out_radix, numbits,
+                                        in_format, out_format, rounding_mode, out, outlen, error);
+    stats_end(&mark, inputSystem, outputSystem, width, 1, result == NULL);
+    return result;
+}
+
+/* The conversion behind convert_number_radix(), without the statistics. */
+static char *convert_radix_digits(const char *numberStr, size_t len, int inputSystem, unsigned int in_radix,
+                                  int outputSystem, unsigned int out_radix, unsigned int numbits,
+                                  const struct numconv_ieee754_format *in_format,
+                                  const struct numconv_ieee754_format *out_format,
+                                  int rounding_mode, char *out, size_t outlen, const char **error)
+{
+    char in_small[256], out_small[256];
+    char *in_bits = NULL, *out_bits = NULL;
+    const char *digits = numberStr;
+    char *result = NULL;
+    bool ok = true;
+
+    if (in_radix <= 2 && out_radix <= 2)
+        return convert_number(numberStr, len, inputSystem, outputSystem, numbits, in_format, out_format,
+                              rounding_mode, out, outlen, error);
+
+    // Patterns of up to 64 bits convert as values, with no binary digits in between.
+    size_t held = (in_radix > 2) ? radix_pattern_bits(len, in_radix) : len;
+    size_t in_ieee = (size_t)(1 + in_format->exp_bits + in_format->mantissa_bits);
+    size_t in_width = (inputSystem == SYS_IEEE754) ? in_ieee : held;
+    size_t out_width = (outputSystem == SYS_IEEE754) ? (size_t)(1 + out_format->exp_bits + out_format->mantissa_bits)
+                                                     : (numbits ? numbits : in_width);
+    if (inputSystem != SYS_DECIMAL && outputSystem != SYS_DECIMAL && len > 0 && held <= 64 && out_width <= 64 &&
+        (in_radix > 2 || inputSystem != SYS_IEEE754 || len == in_ieee)) {
+        unsigned long bits, converted;
+        if (!scan_radix_digits(numberStr, len, in_radix, &bits)) {
+            status_raise(NUMCONV_INVALID);
+            *error = "Invalid number input. Please enter only digits of the chosen radix.";
+            return NULL;
+        }
+        if (held > in_width && (bits >> in_width) != 0) {
+            status_raise(NUMCONV_INVALID);
+            *error = "Invalid number input. The value does not fit in the bit pattern.";
+            return NULL;
+        }
+        if (!convert_bits(bits, (unsigned int)in_width, inputSystem, outputSystem, (unsigned int)out_width,
+                          in_format, out_format, rounding_mode, &converted, error))
+            return NULL;
+        if (outlen < radix_pattern_digits(out_width, out_radix) + 1) {
+            *error = "Conversion failed due to an error (invalid width or output buffer too small).";
+            return NULL;
+        }
+        out[emit_radix_digits(converted, (unsigned int)out_width, out_radix, out)] = '\0';
+        return out;
+    }
+
+    if (in_radix > 2 && inputSystem != SYS_DECIMAL) {
+        size_t width = in_width;
+        in_bits = (width < sizeof(in_small)) ? in_small : malloc(width + 1);
+        stats_count_allocations(in_bits != in_small && in_bits != NULL);
+        if (in_bits == NULL) {
+            *error = "Conversion failed due to an error (memory allocation).";
+            return NULL;
+        }
+        ok = radix_to_binary(numberStr, len, in_radix, width, in_bits, width + 1, error) != NULL;
+        digits = in_bits;
+        len = width;
+    }
+    if (ok && (out_radix <= 2 || outputSystem == SYS_DECIMAL)) {
+        result = convert_number(digits, len, inputSystem, outputSystem, numbits, in_format, out_format,
+                                rounding_mode, out, outlen, error);
+    } else if (ok) {
+        // Convert to binary digits first, then regroup them in the output radix.
+        size_t need = convert_output_size(len, inputSystem, outputSystem, numbits, out_format);
+        out_bits = (need <= sizeof(out_small)) ? out_small : malloc(need);
+        stats_count_allocations(out_bits != out_small && out_bits != NULL);
+        if (out_bits == NULL) {
+            *error = "Conversion failed due to an error (memory allocation).";
+        } else if (convert_number(digits, len, inputSystem, outputSystem, numbits, in_format, out_format,
+                                  rounding_mode, out_bits, need, error) != NULL) {
+            result = binary_to_radix(out_bits, strlen(out_bits), out_radix, out, outlen);
+            if (result == NULL)
+                *error = "Conversion failed due to an error (memory allocation or output buffer too small).";
+        }
+    }
+    if (in_bits != in_small)
+        free(in_bits);
+    if (out_bits != out_small)
+        free(out_bits);
+    return result;
+}
+
+/*
+ * Fixed point.
+ *
+ * A Qm.n value is an integer pattern read as that integer times 2^-n, so
+ * conversions between fixed-point formats and from integers are exact
+ * integer arithmetic: the value is shifted to the new fraction, the bits
+ * shifted out are rounded in the context's mode (ROUNDUP rounds the
+ * magnitude up, ROUNDDOWN truncates it, ROUNDTOEVEN goes to the nearest,
+ * ties to even) and values out of range saturate. Floating-point values
+ * are scaled by 2^n and rounded the same way, and fixed point reads back
+ * into a double exactly up to 53 significant bits. Decimal output is
+ * exact: a fraction of n bits has at most n decimal digits.
+ */
+
+/* The number of bits of a fixed-point pattern: 1 + m + n for Qm.n, m + n for UQm.n. */
+unsigned int fixed_format_bits(const struct numconv_fixed_format *format)
+{
+    return (unsigned int)(!format->is_unsigned + format->int_bits + format->frac_bits);
+}
+
+/**
+ * @brief Parses a fixed-point format given on the command line or at the prompt.
+ *
+ * Qn is short for Q0.n, so Q15 and Q31 are the 16 and 32-bit fractional
+ * formats; a leading U makes the format unsigned, without a sign bit.
+ *
+ * @param arg Qm.n, Qn, UQm.n or UQn, in either case.
+ * @param format Receives the format.
+ * @return true if the argument names a format of 1 to 64 bits.
+ */
+bool parse_fixed_format(const char *arg, struct numconv_fixed_format *format)
+{
+    bool is_unsigned = *arg == 'u' || *arg == 'U';
+    const char *p = arg + is_unsigned;
+    char *end;
+    if (*p != 'q' && *p != 'Q')
+        return false;
+    p++;
+    if (*p < '0' || *p > '9')
+        return false;
+    long int_bits = 0, frac_bits = strtol(p, &end, 10);
+    if (*end == '.') {
+        p = end + 1;
+        if (*p < '0' || *p > '9')
+            return false;
+        int_bits = frac_bits;
+        frac_bits = strtol(p, &end, 10);
+    }
+    if (*end != '\0' || int_bits > 64 || frac_bits > 64 || int_bits + frac_bits + !is_unsigned > 64 ||
+        int_bits + frac_bits + !is_unsigned < 1)
+        return false;
+    *format = (struct numconv_fixed_format){ (int)int_bits, (int)frac_bits, is_unsigned };
+    return true;
+}
+
+/* Decodes a fixed-point pattern into its sign and the magnitude of its integer. */
+static unsigned long fixed_decode_magnitude(unsigned long bits, const struct numconv_fixed_format *format,
+                                            bool *negative)
+{
+    unsigned int width = fixed_format_bits(format);
+    unsigned long mask = (width < 64) ? (1UL << width) - 1 : ~0UL;
+    bits &= mask;
+    *negative = !format->is_unsigned && ((bits >> (width - 1)) & 1);
+    return *negative ? (0UL - bits) & mask : bits;
+}
+
+/*
+ * Encodes a signed magnitude, already scaled to the format's fraction, as
+ * its pattern: magnitudes beyond the format's range saturate to its largest
+ * or smallest value (zero for negative values in unsigned formats).
+ */
+static unsigned long fixed_saturate(bool negative, unsigned __int128 magnitude,
+                                    const struct numconv_fixed_format *format)
+{
+    unsigned int width = fixed_format_bits(format), range = (unsigned int)(format->int_bits + format->frac_bits);
+    unsigned __int128 limit = ((unsigned __int128)1 << range) - !negative;
+    if (negative && format->is_unsigned)
+        limit = 0;
+    if (magnitude > limit) {
+        status_raise(NUMCONV_OVERFLOW);
+        magnitude = limit;
+    }
+    unsigned long bits = negative ? 0UL - (unsigned long)magnitude : (unsigned long)magnitude;
+    return (width < 64) ? bits & ((1UL << width) - 1) : bits;
+}
+
+/* Encodes (-1)^negative * magnitude * 2^-scale in a fixed-point format, rounding the bits it cannot keep. */
+static unsigned long fixed_encode_scaled(bool negative, unsigned long magnitude, int scale,
+                                         const struct numconv_fixed_format *format, int rounding_mode)
+{
+    unsigned __int128 m = magnitude;
+    int shift = format->frac_bits - scale;
+    if (shift >= 0) {
+        m <<= shift;
+    } else {
+        // At most 64 bits are dropped, so every intermediate fits in 128.
+        int drop = -shift;
+        unsigned __int128 kept = m >> drop, rest = m - (kept << drop), half = (unsigned __int128)1 << (drop - 1);
+        bool up = (rounding_mode == ROUNDUP) ? rest != 0
+                                             : rounding_mode == ROUNDTOEVEN && (rest > half || (rest == half &&
+                                                                                               (kept & 1)));
+        status_raise((unsigned int)(rest != 0) * NUMCONV_INEXACT);
+        m = kept + up;
+    }
+    return fixed_saturate(negative && m != 0, m, format);
+}
+
+/**
+ * @brief Reads a fixed-point pattern as a double.
+ * @param bits The pattern in its low fixed_format_bits(format) bits; higher bits are ignored.
+ * @param format The fixed-point format.
+ * @return The value, exact when its integer has at most 53 significant bits and rounded to nearest otherwise.
+ */
+double fixed_decode_double(unsigned long bits, const struct numconv_fixed_format *format)
+{
+    bool negative;
+    double value = ldexp((double)fixed_decode_magnitude(bits, format, &negative), -format->frac_bits);
+    return negative ? -value : value;
+}
+
+/**
+ * @brief Quantizes a double to a fixed-point format.
+ *
+ * The value is scaled by 2^frac_bits and rounded to an integer (ROUNDUP
+ * away from zero, ROUNDDOWN toward it, ROUNDTOEVEN to nearest even), then
+ * saturated to the format's range; infinities saturate as well.
+ *
+ * @param input The value; a NaN gives 0, so callers reject NaNs first.
+ * @param format The fixed-point format.
+ * @param rounding_mode Rounding mode (ROUNDUP, ROUNDDOWN, or ROUNDTOEVEN).
+ * @return The pattern in the low fixed_format_bits(format) bits.
+ */
+unsigned long fixed_encode_double(double input, const struct numconv_fixed_format *format, int rounding_mode)
+{
+    if (isnan(input))
+        return 0;
+    double scaled = ldexp(input, format->frac_bits), rounded;
+    if (rounding_mode == ROUNDDOWN)
+        rounded = trunc(scaled);
+    else if (rounding_mode == ROUNDUP)
+        rounded = (scaled < 0) ? floor(scaled) : ceil(scaled);
+    else
+        rounded = nearbyint(scaled);
+    status_raise((unsigned int)(rounded != scaled) * NUMCONV_INEXACT);
+    double magnitude = fabs(rounded);
+    // Anything from 2^64 up is beyond every format, and saturates like it.
+    unsigned __int128 m = (magnitude < 0x1p64) ? (unsigned __int128)(unsigned long)magnitude
+                                               : (unsigned __int128)1 << 65;
+    return fixed_saturate(rounded < 0, m, format);
+}
+
+/**
+ * @brief Writes a fixed-point pattern as exact decimal text, e.g. "-0.75" or "3".
+ * @param bits The pattern in its low fixed_format_bits(format) bits.
+ * @param format The fixed-point format.
+ * @param out Buffer receiving the text.
+ * @param outlen Size of the buffer; 23 + frac_bits bytes are always enough.
+ * @return out, or NULL if the buffer is too small.
+ */
+char *format_fixed_decimal(unsigned long bits, const struct numconv_fixed_format *format, char *out, size_t outlen)
+{
+    const int n = format->frac_bits;
+    if (outlen < 23 + (size_t)n)
+        return NULL;
+    bool negative;
+    unsigned long magnitude = fixed_decode_magnitude(bits, format, &negative);
+    unsigned __int128 mask = ((unsigned __int128)1 << n) - 1, fraction = magnitude & mask;
+    size_t len = (size_t)snprintf(out, outlen, "%s%lu", negative ? "-" : "", (n < 64) ? magnitude >> n : 0UL);
+    // Each digit of the fraction is the integer part of ten times what is left of it.
+    if (fraction != 0)
+        out[len++] = '.';
+    while (fraction != 0) {
+        fraction *= 10;
+        out[len++] = (char)('0' + (int)(fraction >> n));
+        fraction &= mask;
+    }
+    out[len] = '\0';
+    return out;
+}
+
+/**
+ * @brief Converts one value as a bit pattern, like convert_bits(), where either side may be fixed point.
+ *
+ * Fixed-point output takes integers and other fixed-point values exactly
+ * before rounding, and floats through fixed_encode_double(). Fixed-point
+ * input gives floats through fixed_decode_double() and integers by
+ * truncating the fraction toward zero. Conversions without a fixed-point
+ * side are passed to convert_bits().
+ *
+ * @param bits The input bit pattern.
+ * @param width Its width: 1..64 for the integer systems; that of in_format or in_fixed otherwise.
+ * @param inputSystem The input system (SYS_UNSIGNED .. SYS_IEEE754, or SYS_FIXED).
+ * @param outputSystem The output system (SYS_UNSIGNED .. SYS_IEEE754, or SYS_FIXED).
+ * @param numbits Width of an integer output (1..64); 0 keeps the input width.
+ * @param in_format The format of an IEEE754 input.
+ * @param out_format The format of an IEEE754 output.
+ * @param in_fixed The format of a fixed-point input.
+ * @param out_fixed The format of a fixed-point output.
+ * @param rounding_mode Rounding mode for IEEE754 and fixed-point output.
+ * @param result Receives the output bit pattern.
+ * @param error Set to a message describing the failure when false is returned.
+ * @return true on success.
+ */
+static bool convert_fixed_bits(unsigned long bits, unsigned int width, int inputSystem, int outputSystem,
+                               unsigned int numbits, const struct numconv_ieee754_format *in_format,
+                               const struct numconv_ieee754_format *out_format,
+                               const struct numconv_fixed_format *in_fixed,
+                               const struct numconv_fixed_format *out_fixed, int rounding_mode, unsigned long *result,
+                               const char **error)
+{
+    if (inputSystem != SYS_FIXED && outputSystem != SYS_FIXED)
+        return convert_bits(bits, width, inputSystem, outputSystem, numbits, in_format, out_format, rounding_mode,
+                            result, error);
+    if (numbits == 0)
+        numbits = width;
+    bool negative;
+    unsigned long magnitude;
+    int scale = 0;
+    if (inputSystem == SYS_IEEE754) {
+        double dvalue = ieee754_decode_format(bits, in_format);
+        if (isnan(dvalue)) {
+            status_raise(NUMCONV_INVALID);
+            *error = "Invalid IEEE754 number.";
+            return false;
+        }
+        *result = fixed_encode_double(dvalue, out_fixed, rounding_mode);
+        return true;
+    } else if (inputSystem == SYS_FIXED) {
+        magnitude = fixed_decode_magnitude(bits, in_fixed, &negative);
+        scale = in_fixed->frac_bits;
+    } else {
+        if (width < 64)
+            bits &= (1UL << width) - 1;
+        long value = decode_integer_bits(inputSystem, bits, width, (bits >> (width - 1)) & 1);
+        negative = inputSystem != SYS_UNSIGNED && value < 0;
+        magnitude = negative ? 0UL - (unsigned long)value : (unsigned long)value;
+    }
+
+    if (outputSystem == SYS_FIXED) {
+        *result = fixed_encode_scaled(negative, magnitude, scale, out_fixed, rounding_mode);
+        return true;
+    }
+    if (outputSystem == SYS_IEEE754) {
+        double dvalue = ldexp((double)magnitude, -scale);
+        if (negative)
+            dvalue = -dvalue;
+        *result = ieee754_encode_format(dvalue, out_format, rounding_mode);
+        if (status_checking)
+            status_raise(ieee754_encode_status(dvalue, *result, out_format) | magnitude_inexact_status(magnitude));
+        return true;
+    }
+    if (outputSystem < SYS_UNSIGNED || outputSystem > SYS_TWOS_COMPLEMENT || numbits < 1 || numbits > 64) {
+        *error = "Conversion failed due to an error (invalid width or output system).";
+        return false;
+    }
+    // Integer output keeps the integer part, as it does for floats.
+    if (outputSystem == SYS_UNSIGNED && negative) {
+        status_raise(NUMCONV_OVERFLOW);
+        *error = "Cannot represent a negative number in an unsigned binary system.";
+        return false;
+    }
+    unsigned long integer = (scale < 64) ? magnitude >> scale : 0;
+    bool truncated = (scale < 64) ? (integer << scale) != magnitude : magnitude != 0;
+    negative = negative && integer != 0;
+    status_raise(integer_range_status(outputSystem, integer, negative, numbits) |
+                 (unsigned int)truncated * NUMCONV_TRUNCATED);
+    *result = encode_integer_bits(outputSystem, integer, negative, numbits);
+    return true;
+}
+
+/* The buffer size convert_fixed_digits() needs for a context's conversions, which is the same for every value. */
+static size_t fixed_output_size(const struct numconv *conv)
+{
+    const struct numconv_ieee754_format *f = &conv->out_format;
+    if (conv->inputSystem == SYS_FIXED && conv->outputSystem == SYS_DECIMAL)
+        return 23 + (size_t)conv->in_fixed.frac_bits;
+    if (conv->outputSystem == SYS_FIXED)
+        return fixed_format_bits(&conv->out_fixed) + 1;
+    if (conv->outputSystem == SYS_IEEE754)
+        return (size_t)(1 + f->exp_bits + f->mantissa_bits) + 1;
+    return (conv->numbits ? conv->numbits : fixed_format_bits(&conv->in_fixed)) + 1;
+}
+
+/*
+ * The conversion behind numconv_convert() when either side is fixed point.
+ * Patterns are read and written as digits of the context's radixes: binary
+ * fixed-point input is exactly as wide as its format, like IEEE754 input,
+ * and other radixes must fit in it.
+ */
+static char *convert_fixed_digits(const struct numconv *conv, const char *text, size_t len, char *out,
+                                  size_t outlen, const char **error)
+{
+    const int inputSystem = conv->inputSystem, outputSystem = conv->outputSystem;
+    const struct numconv_ieee754_format *in_format = &conv->in_format, *out_format = &conv->out_format;
+    unsigned long bits, result;
+    unsigned int width = 0;
+
+    if (inputSystem == SYS_DECIMAL) {
+        // Decimal text is rounded to a double first, as it is for IEEE754 output.
+        double dvalue;
+        bool exact = true;
+        if (!parse_decimal_exact(text, len, &dvalue, status_checking ? &exact : NULL) || isnan(dvalue)) {
+            status_raise(NUMCONV_INVALID);
+            *error = "Invalid decimal input.";
+            return NULL;
+        }
+        status_raise((unsigned int)!exact * NUMCONV_INEXACT);
+        result = fixed_encode_double(dvalue, &conv->out_fixed, conv->rounding_mode);
+    } else {
+        size_t held = radix_pattern_bits(len, conv->in_radix);
+        width = (inputSystem == SYS_FIXED)     ? fixed_format_bits(&conv->in_fixed)
+                : (inputSystem == SYS_IEEE754) ? (unsigned int)(1 + in_format->exp_bits + in_format->mantissa_bits)
+                                               : (unsigned int)held;
+        if (len == 0 || !scan_radix_digits(text, len, conv->in_radix, &bits)) {
+            status_raise(NUMCONV_INVALID);
+            *error = "Invalid number input. Please enter only digits of the chosen radix.";
+            return NULL;
+        }
+        if (conv->in_radix == 2 && (inputSystem == SYS_FIXED || inputSystem == SYS_IEEE754) && len != width) {
+            status_raise(NUMCONV_INVALID);
+            if (inputSystem == SYS_FIXED)
+                *error = "Invalid fixed-point input. Must be as wide as the format (sign + integer + fraction).";
+            else
+                *error = "Invalid IEEE754 input. Must be exactly as wide as the format (sign + exponent + mantissa).";
+            return NULL;
+        }
+        if (held > 64 && inputSystem != SYS_FIXED && inputSystem != SYS_IEEE754) {
+            *error = "Fixed-point conversions take integers of at most 64 bits.";
+            return NULL;
+        }
+        if (held > width && (held > 64 || (bits >> width) != 0)) {
+            status_raise(NUMCONV_INVALID);
+            *error = "Invalid number input. The value does not fit in the bit pattern.";
+            return NULL;
+        }
+        if (outputSystem == SYS_DECIMAL) {
+            if (format_fixed_decimal(bits, &conv->in_fixed, out, outlen) == NULL) {
+                *error = "Conversion failed due to an error (output buffer too small).";
+                return NULL;
+            }
+            return out;
+        }
+        if (!convert_fixed_bits(bits, width, inputSystem, outputSystem, conv->numbits, in_format, out_format,
+                                &conv->in_fixed, &conv->out_fixed, conv->rounding_mode, &result, error))
+            return NULL;
+    }
+    unsigned int out_width = (outputSystem == SYS_FIXED) ? fixed_format_bits(&conv->out_fixed)
+                             : (outputSystem == SYS_IEEE754)
+                                 ? (unsigned int)(1 + out_format->exp_bits + out_format->mantissa_bits)
+                                 : (conv->numbits ? conv->numbits : width);
+    if (outlen < radix_pattern_digits(out_width, conv->out_radix) + 1) {
+        *error = "Conversion failed due to an error (invalid width or output buffer too small).";
+        return NULL;
+    }
+    out[emit_radix_digits(result, out_width, conv->out_radix, out)] = '\0';
+    return out;
+}
+
+/*
+ * Bulk quantization.
+ *
+ * Packed binary32 and binary64 samples are quantized a block at a time,
+ * blocks holding a NaN going element by element as in the bulk
+ * down-conversion. With AVX2, eight samples at a time are widened to
+ * doubles, scaled, rounded in the requested mode, clamped to the format's
+ * range and narrowed to 1, 2 or 4-byte elements, for formats whose values
+ * fit a signed 32-bit lane. Going back, eight elements are sign-extended
+ * (or zero-extended) into 32-bit lanes, converted and scaled by 2^-n, which
+ * is exact for binary64 and rounds to nearest even for binary32. Wider
+ * formats, other rounding and CPUs without AVX2 take the scalar encoders,
+ * which give the same results.
+ */
+static void quantize_block_scalar(const char *src, size_t n, bool wide, const struct numconv_fixed_format *to,
+                                  int rounding_mode, char *dst)
+{
+    const unsigned int out_bytes = (fixed_format_bits(to) + 7) / 8;
+    for (size_t i = 0; i < n; i++) {
+        double d;
+        float f;
+        if (wide) {
+            memcpy(&d, src + 8 * i, sizeof(d));
+        } else {
+            memcpy(&f, src + 4 * i, sizeof(f));
+            d = f;
+        }
+        store_packed(dst + out_bytes * i, fixed_encode_double(d, to, rounding_mode), out_bytes);
+    }
+}
+
+static void dequantize_block_scalar(const char *src, size_t n, const struct numconv_fixed_format *from, bool wide,
+                                    char *dst)
+{
+    const unsigned int in_bytes = (fixed_format_bits(from) + 7) / 8;
+    for (size_t i = 0; i < n; i++) {
+        double d = fixed_decode_double(load_packed(src + in_bytes * i, in_bytes), from);
+        float f = (float)d;
+        if (wide)
+            memcpy(dst + 8 * i, &d, sizeof(d));
+        else
+            memcpy(dst + 4 * i, &f, sizeof(f));
+    }
+}
+
+#if defined(SCAN_HAVE_X86)
+/* Scales four samples, rounds them, and clamps and converts them to 32-bit integers. */
+__attribute__((target("avx2")))
+static inline __m128i quantize_lanes(__m256d x, __m256d scale, __m256d lo, __m256d hi, int rounding_mode)
+{
+    __m256d r = _mm256_mul_pd(x, scale);
+    if (rounding_mode == ROUNDDOWN)
+        r = _mm256_round_pd(r, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    else if (rounding_mode == ROUNDUP)
+        r = _mm256_blendv_pd(_mm256_ceil_pd(r), _mm256_floor_pd(r), r);    // floor where the sign bit is set
+    else
+        r = _mm256_round_pd(r, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    return _mm256_cvttpd_epi32(_mm256_min_pd(_mm256_max_pd(r, lo), hi));
+}
+
+__attribute__((target("avx2")))
+static void quantize_block_avx2(const char *src, size_t n, bool wide, const struct numconv_fixed_format *to,
+                                int rounding_mode, char *dst)
+{
+    const unsigned int bits = fixed_format_bits(to), out_bytes = (bits + 7) / 8;
+    const int range = to->int_bits + to->frac_bits;
+    const __m256d scale = _mm256_set1_pd(ldexp(1.0, to->frac_bits));
+    const __m256d lo = _mm256_set1_pd(to->is_unsigned ? 0.0 : -ldexp(1.0, range));
+    const __m256d hi = _mm256_set1_pd(ldexp(1.0, range) - 1);
+    const __m128i mask = _mm_set1_epi32(bits < 32 ? (int)((1u << bits) - 1) : -1);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d a, b;
+        if (wide) {
+            a = _mm256_loadu_pd((const double *)(const void *)(src + 8 * i));
+            b = _mm256_loadu_pd((const double *)(const void *)(src + 8 * i + 32));
+        } else {
+            __m256 f = _mm256_loadu_ps((const float *)(const void *)(src + 4 * i));
+            a = _mm256_cvtps_pd(_mm256_castps256_ps128(f));
+            b = _mm256_cvtps_pd(_mm256_extractf128_ps(f, 1));
+        }
+        // The patterns are masked to the format's width, so narrowing them never saturates.
+        __m128i qa = _mm_and_si128(quantize_lanes(a, scale, lo, hi, rounding_mode), mask);
+        __m128i qb = _mm_and_si128(quantize_lanes(b, scale, lo, hi, rounding_mode), mask);
+        char *out = dst + out_bytes * i;
+        if (out_bytes == 4) {
+            _mm_storeu_si128((__m128i *)(void *)out, qa);
+            _mm_storeu_si128((__m128i *)(void *)(out + 16), qb);
+        } else if (out_bytes == 2) {
+            _mm_storeu_si128((__m128i *)(void *)out, _mm_packus_epi32(qa, qb));
+        } else {
+            _mm_storel_epi64((__m128i *)(void *)out, _mm_packus_epi16(_mm_packus_epi32(qa, qb), qa));
+        }
+    }
+    quantize_block_scalar(src + (wide ? 8 : 4) * i, n - i, wide, to, rounding_mode, dst + out_bytes * i);
+}
+
+__attribute__((target("avx2")))
+static void dequantize_block_avx2(const char *src, size_t n, const struct numconv_fixed_format *from, bool wide,
+                                  char *dst)
+{
+    const unsigned int bits = fixed_format_bits(from), in_bytes = (bits + 7) / 8;
+    const __m128i shift = _mm_cvtsi32_si128((int)(32 - bits));
+    const __m256 scale = _mm256_set1_ps(ldexpf(1.0f, -from->frac_bits));
+    const __m256d wide_scale = _mm256_set1_pd(ldexp(1.0, -from->frac_bits));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const char *p = src + in_bytes * i;
+        __m256i v;
+        if (in_bytes == 1)
+            v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(const void *)p));
+        else if (in_bytes == 2)
+            v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(const void *)p));
+        else
+            v = _mm256_loadu_si256((const __m256i *)(const void *)p);
+        // Extend the pattern from its own width to the whole lane.
+        v = _mm256_sll_epi32(v, shift);
+        v = from->is_unsigned ? _mm256_srl_epi32(v, shift) : _mm256_sra_epi32(v, shift);
+        if (wide) {
+            __m256d a = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), wide_scale);
+            __m256d b = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), wide_scale);
+            _mm256_storeu_pd((double *)(void *)(dst + 8 * i), a);
+            _mm256_storeu_pd((double *)(void *)(dst + 8 * i + 32), b);
+        } else {
+            _mm256_storeu_ps((float *)(void *)(dst + 4 * i), _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+        }
+    }
+    dequantize_block_scalar(src + in_bytes * i, n - i, from, wide, dst + (wide ? 8 : 4) * i);
+}
+#endif
+
+/* Whether the AVX2 kernels can be used, unless PA2_SIMD asks for "scalar", "swar" or "sse2". */
+static bool quantize_use_avx2(void)
+{
+#if defined(SCAN_HAVE_X86)
+    const char *force = getenv("PA2_SIMD");
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") &&
+           !(force && (strcmp(force, "scalar") == 0 || strcmp(force, "swar") == 0 || strcmp(force, "sse2") == 0));
+#else
+    return false;
+#endif
+}
+
+static void quantize_block_resolve(const char *src, size_t n, bool wide, const struct numconv_fixed_format *to,
+                                   int rounding_mode, char *dst);
+static void dequantize_block_resolve(const char *src, size_t n, const struct numconv_fixed_format *from, bool wide,
+                                     char *dst);
+
+static void (*quantize_block_impl)(const char *, size_t, bool, const struct numconv_fixed_format *, int,
+                                   char *) = quantize_block_resolve;
+static void (*dequantize_block_impl)(const char *, size_t, const struct numconv_fixed_format *, bool,
+                                     char *) = dequantize_block_resolve;
+
+/* Picks the AVX2 quantizer when the CPU has it, then runs it. */
+static void quantize_block_resolve(const char *src, size_t n, bool wide, const struct numconv_fixed_format *to,
+                                   int rounding_mode, char *dst)
+{
+    void (*impl)(const char *, size_t, bool, const struct numconv_fixed_format *, int, char *) = quantize_block_scalar;
+#if defined(SCAN_HAVE_X86)
+    if (quantize_use_avx2())
+        impl = quantize_block_avx2;
+#endif
+    quantize_block_impl = impl;
+    impl(src, n, wide, to, rounding_mode, dst);
+}
+
+/* Picks the AVX2 dequantizer when the CPU has it, then runs it. */
+static void dequantize_block_resolve(const char *src, size_t n, const struct numconv_fixed_format *from, bool wide,
+                                     char *dst)
+{
+    void (*impl)(const char *, size_t, const struct numconv_fixed_format *, bool, char *) = dequantize_block_scalar;
+#if defined(SCAN_HAVE_X86)
+    if (quantize_use_avx2())
+        impl = dequantize_block_avx2;
+#endif
+    dequantize_block_impl = impl;
+    impl(src, n, from, wide, dst);
+}
+
+/* Whether the block kernels handle a format: patterns of 1, 2 or 4 bytes whose values fit a signed 32-bit lane. */
+static bool fixed_block_format(const struct numconv_fixed_format *format)
+{
+    unsigned int bits = fixed_format_bits(format);
+    return (bits <= 16 || (bits > 24 && bits <= 32)) && format->int_bits + format->frac_bits <= 31;
+}
+
+/**
+ * @brief Quantizes an array of packed little-endian floats to a fixed-point format.
+ * @param src The input elements, of (width + 7) / 8 bytes for the input format's width.
+ * @param count The number of elements.
+ * @param from The input format.
+ * @param to The fixed-point format.
+ * @param rounding_mode Rounding mode (ROUNDUP, ROUNDDOWN, or ROUNDTOEVEN).
+ * @param dst Receives count patterns of (fixed_format_bits(to) + 7) / 8 bytes each.
+ * @return The number of elements converted before the first NaN input (written as zero),
+ *         or count if there was none.
+ */
+size_t quantize_packed_floats(const char *src, size_t count, const struct numconv_ieee754_format *from,
+                              const struct numconv_fixed_format *to, int rounding_mode, char *dst)
+{
+    const unsigned int in_bytes = (unsigned int)(1 + from->exp_bits + from->mantissa_bits + 7) / 8;
+    const unsigned int out_bytes = (fixed_format_bits(to) + 7) / 8;
+    bool blocks = false;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    blocks = (same_format(from, 8, 23) || same_format(from, 11, 52)) && fixed_block_format(to);
+#endif
+    size_t i = 0;
+    while (blocks && i < count) {
+        size_t n = (count - i < FLOAT_BLOCK) ? count - i : FLOAT_BLOCK;
+        // A block holding a NaN is left to the loop below, which stops at it.
+        if (packed_floats_have_nan(src + i * in_bytes, n, in_bytes == 8))
+            break;
+        quantize_block_impl(src + i * in_bytes, n, in_bytes == 8, to, rounding_mode, dst + i * out_bytes);
+        i += n;
+    }
+    for (; i < count; i++) {
+        double d = ieee754_decode_format(load_packed(src + i * in_bytes, in_bytes), from);
+        if (isnan(d)) {
+            memset(dst + i * out_bytes, 0, out_bytes);
+            return i;
+        }
+        store_packed(dst + i * out_bytes, fixed_encode_double(d, to, rounding_mode), out_bytes);
+    }
+    return count;
+}
+
+/**
+ * @brief Converts an array of packed little-endian fixed-point patterns to floats.
+ * @param src The input patterns, of (fixed_format_bits(from) + 7) / 8 bytes each; bits above the
+ *            format's width are ignored.
+ * @param count The number of elements.
+ * @param from The fixed-point format.
+ * @param to The output format.
+ * @param rounding_mode Rounding mode (ROUNDUP, ROUNDDOWN, or ROUNDTOEVEN).
+ * @param dst Receives count elements of the output format's size.
+ */
+void dequantize_packed(const char *src, size_t count, const struct numconv_fixed_format *from,
+                       const struct numconv_ieee754_format *to, int rounding_mode, char *dst)
+{
+    const unsigned int in_bytes = (fixed_format_bits(from) + 7) / 8;
+    const unsigned int out_bytes = (unsigned int)(1 + to->exp_bits + to->mantissa_bits + 7) / 8;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // binary64 holds every value exactly; binary32 rounds to nearest even, unless 24 bits hold it exactly.
+    if (fixed_block_format(from) &&
+        (same_format(to, 11, 52) ||
+         (same_format(to, 8, 23) && (rounding_mode == ROUNDTOEVEN || fixed_format_bits(from) <= 24)))) {
+        dequantize_block_impl(src, count, from, out_bytes == 8, dst);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < count; i++) {
+        double d = fixed_decode_double(load_packed(src + i * in_bytes, in_bytes), from);
+        store_packed(dst + i * out_bytes, ieee754_encode_format(d, to, rounding_mode), out_bytes);
+    }
+}
+
+/*
+ * Decimal text.
+ *
+ * Decimal input is parsed with the Eisel-Lemire algorithm: up to 19
+ * significant digits are gathered into a 64-bit w, and w * 10^q is rounded
+ * to a double from its product with a 128-bit approximation of 5^q (the
+ * power of two is just the exponent). Small cases that are exact in double
+ * arithmetic take Clinger's fast path first. Longer inputs are rounded from
+ * both w and w + 1, and when the two disagree, or the product cannot decide
+ * the rounding, or the text is not a plain decimal (hexadecimal floats,
+ * inf, nan), strtod() decides instead.
+ *
+ * Decimal output prints the shortest digits that read back as the same
+ * value, using Ryu: the value and the midpoints to its neighbours are
+ * scaled by a power of ten with 128-bit multipliers, and digits are
+ * removed while the scaled interval still contains a shorter number. The
+ * neighbours are those of the value's own format, so a binary16 0.1 prints
+ * as 0.1 rather than as the double it widens to.
+ *
+ * All three power-of-five tables are built with the bignums above, once.
+ */
+#define EL_MIN_POW10 (-342)     // below this, any 19-digit w * 10^q rounds to zero
+#define EL_MAX_POW10 308        // above this, any nonzero w * 10^q overflows
+#define RYU_POW5_BITCOUNT 125
+#define RYU_POW5_TABLE 326
+#define RYU_POW5_INV_TABLE 342
+
+static unsigned __int128 el_pow5[EL_MAX_POW10 - EL_MIN_POW10 + 1];
+static unsigned __int128 ryu_pow5[RYU_POW5_TABLE];
+static unsigned __int128 ryu_pow5_inv[RYU_POW5_INV_TABLE];
+static pthread_once_t decimal_tables_once = PTHREAD_ONCE_INIT;
+static bool decimal_tables_ready;
+
+/* Exact powers of ten for Clinger's fast path. */
+static const double exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* Bits [shift, shift + 128) of a; the bits above them must be zero. */
+static unsigned __int128 bn_bits128(const struct bignum *a, size_t shift)
+{
+    size_t first = shift / 32;
+    unsigned int s = (unsigned int)(shift % 32);
+    unsigned __int128 r = 0;
+    for (size_t i = 5; i-- > 0;) {
+        uint32_t limb = first + i < a->len ? a->limb[first + i] : 0;
+        if (i == 4)
+            r = s ? (unsigned __int128)limb << (128 - s) : 0;
+        else
+            r |= ((unsigned __int128)limb << (32 * i)) >> s;
+    }
+    return r;
+}
+
+/* The bits of a shifted so that it is exactly 'bits' bits long, truncated. */
+static unsigned __int128 bn_leading_bits(const struct bignum *a, size_t bits)
+{
+    size_t len = bn_bit_length(a);
+    if (len <= bits)
+        return bn_bits128(a, 0) << (bits - len);
+    return bn_bits128(a, len - bits);
+}
+
+/* floor(2^exp2 / d) + 1. */
+static bool bn_reciprocal_plus_one(struct bignum *q, size_t exp2, const struct bignum *d)
+{
+    struct bignum num = { 0 }, rem = { 0 };
+    size_t limbs = exp2 / 32 + 1;
+    bool ok = bn_reserve(&num, limbs);
+    if (ok) {
+        memset(num.limb, 0, limbs * sizeof(uint32_t));
+        num.limb[limbs - 1] = 1U << (exp2 % 32);
+        num.len = limbs;
+        ok = bn_divmod(q, &rem, &num, d) && bn_mul_small_add(q, 1, 1);
+    }
+    bn_free(&num);
+    bn_free(&rem);
+    return ok;
+}
+
+static void decimal_tables_build(void)
+{
+    struct bignum pow5 = { 0 }, q = { 0 };
+    bool ok = bn_set_small(&pow5, 1);
+    for (int i = 0; ok && i <= -EL_MIN_POW10; i++) {
+        size_t len = bn_bit_length(&pow5);
+        // Eisel-Lemire: 5^i truncated to 128 bits, and 2^b / 5^i rounded up and truncated.
+        if (i <= EL_MAX_POW10)
+            el_pow5[i - EL_MIN_POW10] = bn_leading_bits(&pow5, 128);
+        if (i > 0) {
+            ok = bn_reciprocal_plus_one(&q, i <= 27 ? len + 127 : 2 * len + 128, &pow5);
+            if (ok)
+                el_pow5[-i - EL_MIN_POW10] = bn_bit_length(&q) > 128 ? bn_leading_bits(&q, 128) : bn_bits128(&q, 0);
+        }
+        // Ryu: 5^i in 125 bits, and 2^(len - 1 + 125) / 5^i plus one.
+        if (ok && i < RYU_POW5_TABLE)
+            ryu_pow5[i] = bn_leading_bits(&pow5, RYU_POW5_BITCOUNT);
+        if (ok && i < RYU_POW5_INV_TABLE) {
+            ok = bn_reciprocal_plus_one(&q, len - 1 + RYU_POW5_BITCOUNT, &pow5);
+            if (ok)
+                ryu_pow5_inv[i] = bn_bits128(&q, 0);
+        }
+        ok = ok && bn_mul_small_add(&pow5, 5, 0);
+    }
+    bn_free(&pow5);
+    bn_free(&q);
+    decimal_tables_ready = ok;
+}
+
+static inline bool decimal_tables(void)
+{
+    pthread_once(&decimal_tables_once, decimal_tables_build);
+    return decimal_tables_ready;
+}
+
+/**
+ * @brief Rounds w * 10^q (w nonzero) to the nearest double with Eisel-Lemire.
+ * @return false when the 128-bit product cannot decide the rounding.
+ */
+static bool eisel_lemire(uint64_t w, int q, double *result)
+{
+    uint64_t bits;
+    if (q < EL_MIN_POW10) {
+        *result = 0.0;
+        return true;
+    }
+    if (q > EL_MAX_POW10) {
+        *result = INFINITY;
+        return true;
+    }
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+    unsigned __int128 pow5 = el_pow5[q - EL_MIN_POW10];
+    unsigned __int128 first = (unsigned __int128)w * (uint64_t)(pow5 >> 64);
+    uint64_t hi = (uint64_t)(first >> 64), lo = (uint64_t)first;
+    // Only when the bits below the 55 kept ones are all ones can the low half of 5^q carry into them.
+    const uint64_t precision_mask = UINT64_MAX >> 55;
+    if ((hi & precision_mask) == precision_mask) {
+        uint64_t second = (uint64_t)(((unsigned __int128)w * (uint64_t)pow5) >> 64);
+        lo += second;
+        hi += lo < second;
+        if (lo == UINT64_MAX && (q < -27 || q > 55))
+            return false;
+    }
+    int upperbit = (int)(hi >> 63);
+    uint64_t mantissa = hi >> (upperbit + 9);
+    int power2 = ((217706 * q) >> 16) + 63 + upperbit - lz + 1023;
+    if (power2 <= 0) {
+        // Subnormal, or zero; rounding up may still reach the smallest normal.
+        if (-power2 + 1 >= 64) {
+            *result = 0.0;
+            return true;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        bits = mantissa;
+        memcpy(result, &bits, sizeof(bits));
+        return true;
+    }
+    // An exact halfway product (only possible for small q) rounds to even rather than up.
+    if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << (upperbit + 9)) == hi)
+        mantissa &= ~1ULL;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (2ULL << 52)) {
+        mantissa = 1ULL << 52;
+        power2++;
+    }
+    if (power2 >= 0x7FF) {
+        *result = INFINITY;
+        return true;
+    }
+    bits = (uint64_t)power2 << 52 | (mantissa & ((1ULL << 52) - 1));
+    memcpy(result, &bits, sizeof(bits));
+    return true;
+}
+
+/* strtod() on a terminated copy, accepting only when it consumes all of the text. */
+static bool parse_decimal_libc(const char *text, size_t len, double *value)
+{
+    char small[128];
+    char *copy = len < sizeof(small) ? small : malloc(len + 1);
+    if (copy == NULL)
+        return false;
+    stats_count_allocations(copy != small);
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    char *end;
+    *value = strtod(copy, &end);
+    bool ok = len > 0 && end == copy + len;
+    if (copy != small)
+        free(copy);
+    return ok;
+}
+
+/**
+ * @brief Whether w * 10^q, for w > 0, is exactly a double.
+ *
+ * It is when 10^q = 2^q * 5^q leaves an odd part of at most 53 bits: w * 5^q
+ * for q >= 0, or w / 5^-q, which must divide evenly, for q < 0. Every such
+ * value is far inside the exponent range, so only the odd part is checked.
+ */
+static bool decimal_is_double(uint64_t w, int q)
+{
+    if (q > 22 || q < -27)
+        return false;       // 5^23 alone needs 54 bits; 5^28 divides no w
+    uint64_t pow5 = 1;
+    for (int i = 0; i < (q < 0 ? -q : q); i++)
+        pow5 *= 5;
+    if (q < 0) {
+        if (w % pow5 != 0)
+            return false;
+        w /= pow5;
+        pow5 = 1;
+    }
+    w >>= __builtin_ctzll(w);
+    return w <= ((1ULL << 53) - 1) / pow5;
+}
+
+/* a = a * 2^twos * 5^fives, in as few passes as fit a 32-bit multiplier. */
+static bool bn_scale_pow2_pow5(struct bignum *a, int twos, int fives)
+{
+    bool ok = true;
+    for (; ok && fives >= 13; fives -= 13)
+        ok = bn_mul_small_add(a, 1220703125, 0);    // 5^13
+    for (; ok && fives > 0; fives--)
+        ok = bn_mul_small_add(a, 5, 0);
+    for (; ok && twos >= 31; twos -= 31)
+        ok = bn_mul_small_add(a, 1U << 31, 0);
+    return ok && (twos == 0 || bn_mul_small_add(a, 1U << twos, 0));
+}
+
+/**
+ * @brief Whether decimal digits times 10^exp10 are exactly a finite double.
+ *
+ * decimal_is_double() for any number of digits: the digits between first
+ * and last (a '.' among them is skipped) are compared as a bignum with the
+ * double, D * 10^Q against m * 2^e, after moving negative powers across.
+ */
+static bool decimal_digits_are_double(const char *first, const char *last, int exp10, double value)
+{
+    if (!isfinite(value) || value == 0)
+        return false;
+    struct bignum left = { 0 }, right = { 0 };
+    uint32_t chunk = 0, scale = 1;
+    int q = exp10;
+    bool ok = true, fraction = false;
+    for (const char *p = first; ok && p < last; p++) {
+        if (*p == '.') {
+            fraction = true;
+            continue;
+        }
+        q -= fraction;
+        chunk = chunk * 10 + (uint32_t)(*p - '0');
+        scale *= 10;
+        if (scale == 1000000000) {
+            ok = bn_mul_small_add(&left, scale, chunk);
+            chunk = 0;
+            scale = 1;
+        }
+    }
+    ok = ok && bn_mul_small_add(&left, scale, chunk);
+
+    int e;
+    uint64_t m = (uint64_t)ldexp(frexp(fabs(value), &e), 53);
+    e -= 53 - __builtin_ctzll(m);
+    m >>= __builtin_ctzll(m);
+    ok = ok && bn_set_u64(&right, m) && bn_scale_pow2_pow5(&left, q > e ? q - e : 0, q > 0 ? q : 0) &&
+         bn_scale_pow2_pow5(&right, e > q ? e - q : 0, q < 0 ? -q : 0);
+    bool same = ok && bn_cmp(&left, &right) == 0;
+    bn_free(&left);
+    bn_free(&right);
+    return same;
+}
+
+/**
+ * @brief Parses decimal text into the nearest double, as strtod() would.
+ *
+ * The whole text, apart from surrounding spaces and tabs, must be a number:
+ * an optional sign, digits with an optional fraction and exponent, or any
+ * other form strtod() reads (hexadecimal floats, inf and nan).
+ *
+ * @param text The decimal text (not necessarily terminated).
+ * @param len Length of the text.
+ * @param value Receives the value.
+ * @return true on success, false if the text is not a number.
+ */
+bool parse_decimal(const char *text, size_t len, double *value)
+{
+    return parse_decimal_exact(text, len, value, NULL);
+}
+
+/**
+ * @brief parse_decimal(), also telling whether the text is exactly the double it parses to.
+ *
+ * Text with a nonzero digit past the 19th significant one is reported
+ * inexact, and the forms only strtod() reads (hexadecimal floats, inf and
+ * nan) exact.
+ *
+ * @param exact Receives whether the value was rounded; NULL when not wanted.
+ */
+static bool parse_decimal_exact(const char *text, size_t len, double *value, bool *exact)
+{
+    const char *p = text, *end = text + len;
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t'))
+        end--;
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-'))
+        negative = *p++ == '-';
+    const char *first = p;
+
+    // Up to 19 significant digits go into w; later ones only scale it or set truncated.
+    uint64_t w = 0;
+    int digits = 0, q = 0, exp10 = 0;
+    bool truncated = false, any = false;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+        if (digits < 19) {
+            w = w * 10 + (uint64_t)(*p - '0');
+            digits += w != 0;
+        } else {
+            q++;
+            truncated |= *p != '0';
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+            if (digits < 19) {
+                w = w * 10 + (uint64_t)(*p - '0');
+                digits += w != 0;
+                q--;
+            } else {
+                truncated |= *p != '0';
+            }
+        }
+    }
+    const char *last = p;
+    if (any && p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        bool exp_negative = false;
+        if (e < end && (*e == '+' || *e == '-'))
+            exp_negative = *e++ == '-';
+        if (e < end && *e >= '0' && *e <= '9') {
+            for (; e < end && *e >= '0' && *e <= '9'; e++) {
+                if (exp10 < 100000)
+                    exp10 = exp10 * 10 + (*e - '0');
+            }
+            exp10 = exp_negative ? -exp10 : exp10;
+            q += exp10;
+            p = e;
+        }
+    }
+    if (exact)
+        *exact = !any || p != end || w == 0 || (!truncated && decimal_is_double(w, q));
+
+    bool ok = true;
+    double d;
+    if (!any || p != end || !decimal_tables()) {
+        return parse_decimal_libc(start, (size_t)(end - start), value);
+    } else if (w == 0) {
+        *value = negative ? -0.0 : 0.0;
+    } else if (!truncated && q >= -22 && q <= 22 && w <= (1ULL << 53)) {
+        // Both w and 10^|q| are exact doubles, so one correctly rounded operation suffices.
+        d = q < 0 ? (double)w / exact_pow10[-q] : (double)w * exact_pow10[q];
+        *value = negative ? -d : d;
+    } else {
+        double above;
+        if (!eisel_lemire(w, q, &d) || (truncated && (!eisel_lemire(w + 1, q, &above) || above != d)))
+            ok = parse_decimal_libc(start, (size_t)(end - start), value);
+        else
+            *value = negative ? -d : d;
+    }
+    // Digits past the 19 in w can still be exact (2^-30 has 21); compare them all with the result.
+    if (ok && exact && truncated)
+        *exact = decimal_digits_are_double(first, last, exp10, *value);
+    return ok;
+}
+
+static inline uint32_t pow5_factor(uint64_t value)
+{
+    uint32_t count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        count++;
+    }
+    return count;
+}
+
+/* (m * mul) >> j, for j >= 64. */
+static inline uint64_t ryu_mul_shift(uint64_t m, unsigned __int128 mul, int j)
+{
+    unsigned __int128 low = (unsigned __int128)m * (uint64_t)mul;
+    unsigned __int128 high = (unsigned __int128)m * (uint64_t)(mul >> 64);
+    return (uint64_t)(((low >> 64) + high) >> (j - 64));
+}
+
+/**
+ * @brief Finds the shortest decimal digits * 10^exp10 that rounds back to m2 * 2^e2.
+ *
+ * e2 already includes the two extra bits that place the midpoints to the
+ * neighbours on integers: the value is mv = 4 * m2, the upper midpoint
+ * mv + 2 and the lower one mv - 1 - mm_shift, where mm_shift is zero only
+ * at a power of two whose lower neighbour is twice as close.
+ */
+static uint64_t ryu_shortest(uint64_t m2, int e2, bool mm_shift, int *exp10)
+{
+    const bool accept_bounds = (m2 & 1) == 0;
+    const uint64_t mv = 4 * m2;
+    uint64_t vr, vp, vm;
+    int e10;
+    bool vm_trailing_zeros = false, vr_trailing_zeros = false;
+    if (e2 >= 0) {
+        uint32_t q = (((uint32_t)e2 * 78913) >> 18) - (e2 > 3);
+        int k = RYU_POW5_BITCOUNT + (int)((q * 1217359) >> 19) + 1 - 1;
+        int i = -e2 + (int)q + k;
+        e10 = (int)q;
+        vr = ryu_mul_shift(4 * m2, ryu_pow5_inv[q], i);
+        vp = ryu_mul_shift(4 * m2 + 2, ryu_pow5_inv[q], i);
+        vm = ryu_mul_shift(4 * m2 - 1 - mm_shift, ryu_pow5_inv[q], i);
+        if (q <= 21) {
+            // Only one of mp, mv and mm can be a multiple of 5, if any.
+            if (mv % 5 == 0)
+                vr_trailing_zeros = pow5_factor(mv) >= q;
+            else if (accept_bounds)
+                vm_trailing_zeros = pow5_factor(mv - 1 - mm_shift) >= q;
+            else
+                vp -= pow5_factor(mv + 2) >= q;
+        }
+    } else {
+        uint32_t q = (((uint32_t)-e2 * 732923) >> 20) - (-e2 > 1);
+        int i = -e2 - (int)q;
+        int k = (int)(((uint32_t)i * 1217359) >> 19) + 1 - RYU_POW5_BITCOUNT;
+        int j = (int)q - k;
+        e10 = (int)q + e2;
+        vr = ryu_mul_shift(4 * m2, ryu_pow5[i], j);
+        vp = ryu_mul_shift(4 * m2 + 2, ryu_pow5[i], j);
+        vm = ryu_mul_shift(4 * m2 - 1 - mm_shift, ryu_pow5[i], j);
+        if (q <= 1) {
+            // mv = 4 * m2 always has two trailing zero bits; mm has one only when mm_shift is set.
+            vr_trailing_zeros = true;
+            if (accept_bounds)
+                vm_trailing_zeros = mm_shift;
+            else
+                vp--;
+        } else if (q < 63) {
+            vr_trailing_zeros = (mv & ((1ULL << q) - 1)) == 0;
+        }
+    }
+
+    // Drop digits while the interval still holds a shorter number.
+    int removed = 0;
+    uint64_t output;
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        // The rare case where the bounds or the value are exact and ties matter.
+        unsigned int last_removed = 0;
+        while (vp / 10 > vm / 10) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed == 0;
+            last_removed = (unsigned int)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vm_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_trailing_zeros &= last_removed == 0;
+                last_removed = (unsigned int)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+            last_removed = 4;   // exactly halfway: round to even
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+    } else {
+        bool round_up = false;
+        if (vp / 100 > vm / 100) {
+            round_up = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            round_up = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+    *exp10 = e10 + removed;
+    return output;
+}
+
+/* Writes digits * 10^exp10 the way "%.17g" lays numbers out, returning the length. */
+static size_t format_decimal_digits(uint64_t digits, int exp10, bool negative, char *out)
+{
+    char buf[20];
+    int n = 0;
+    do {
+        buf[n++] = (char)('0' + digits % 10);
+        digits /= 10;
+    } while (digits != 0);
+    char *p = out;
+    if (negative)
+        *p++ = '-';
+    int x = exp10 + n - 1;  // exponent of the leading digit
+    if (x < -4 || x >= 17) {
+        *p++ = buf[n - 1];
+        if (n > 1) {
+            *p++ = '.';
+            for (int i = n - 2; i >= 0; i--)
+                *p++ = buf[i];
+        }
+        *p++ = 'e';
+        *p++ = x < 0 ? '-' : '+';
+        if (x < 0)
+            x = -x;
+        if (x >= 100)
+            *p++ = (char)('0' + x / 100);
+        *p++ = (char)('0' + x / 10 % 10);
+        *p++ = (char)('0' + x % 10);
+    } else if (x < 0) {
+        *p++ = '0';
+        *p++ = '.';
+        for (int i = -1; i > x; i--)
+            *p++ = '0';
+        for (int i = n - 1; i >= 0; i--)
+            *p++ = buf[i];
+    } else {
+        for (int i = n - 1; i >= 0; i--) {
+            *p++ = buf[i];
+            if (i == n - 1 - x && i > 0)
+                *p++ = '.';
+        }
+        for (int i = n - 1; i < x; i++)
+            *p++ = '0';
+    }
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+/**
+ * @brief Writes the shortest decimal text that reads back as the same value.
+ *
+ * The value is printed as a number of the given format: it must be exactly
+ * representable there, and the digits only have to tell it apart from the
+ * format's own neighbours. Formats with more range or precision than a
+ * double use the double's neighbours.
+ *
+ * @param value The value.
+ * @param format Its IEEE754 format, or NULL for binary64.
+ * @param out Buffer of at least 32 bytes receiving the terminated text.
+ * @return The length of the text.
+ */
+static size_t format_shortest(double value, const struct numconv_ieee754_format *format, char *out)
+{
+    bool negative = signbit(value) != 0;
+    if (isnan(value))
+        return (size_t)sprintf(out, "nan");
+    if (isinf(value))
+        return (size_t)sprintf(out, negative ? "-inf" : "inf");
+    if (value == 0)
+        return (size_t)sprintf(out, negative ? "-0" : "0");
+    if (!decimal_tables())
+        return (size_t)sprintf(out, "%.17g", value);
+
+    int exp_bits = 11, mantissa_bits = 52;
+    unsigned long bits;
+    if (format != NULL && format->exp_bits <= 11 && format->mantissa_bits <= 52) {
+        exp_bits = format->exp_bits;
+        mantissa_bits = format->mantissa_bits;
+        bits = ieee754_encode_format(value, format, ROUNDTOEVEN);
+    } else {
+        memcpy(&bits, &value, sizeof(bits));
+    }
+    int bias = (1 << (exp_bits - 1)) - 1;
+    unsigned long mantissa = bits & ((1UL << mantissa_bits) - 1);
+    int exponent = (int)((bits >> mantissa_bits) & ((1UL << exp_bits) - 1));
+    uint64_t m2 = exponent == 0 ? mantissa : (1UL << mantissa_bits) | mantissa;
+    int e2 = (exponent == 0 ? 1 : exponent) - bias - mantissa_bits - 2;
+    int exp10;
+    uint64_t digits = ryu_shortest(m2, e2, mantissa != 0 || exponent <= 1, &exp10);
+    return format_decimal_digits(digits, exp10, negative, out);
+}
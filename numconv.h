@@ -0,0 +1,139 @@
+/*
+ * numconv: conversions between unsigned, signed-magnitude, one's and two's
+ * complement binary, IEEE754-style binary floating point, Qm.n fixed point
+ * and decimal text.
+ *
+ * A struct numconv context holds the systems, width, formats and rounding
+ * of a stream of conversions. numconv_convert() converts one value with it,
+ * and numconv_convert_batch() a whole block of lines or packed elements in
+ * one call; contexts are read-only while converting, so threads can share
+ * one. A checked context, or numconv_convert_status(), also reports which
+ * values overflowed, lost a fraction or were rounded.
+ *
+ * Everything here is prefixed numconv_ or NUMCONV_. The converters a
+ * context drives are shared with the command-line client pa2.c through
+ * numconv_internal.h, which is not part of the API. The library is
+ * numconv.c alone; the Makefile builds it as libnumconv.a and
+ * libnumconv.so, and pa2 on top of it.
+ */
+#ifndef NUMCONV_H
+#define NUMCONV_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped whenever a declaration below changes incompatibly.
+#define NUMCONV_API_VERSION 3
+
+// Rounding modes of IEEE754 and fixed-point output.
+#define NUMCONV_ROUND_UP 0      // away from zero
+#define NUMCONV_ROUND_DOWN 1    // toward zero
+#define NUMCONV_ROUND_EVEN 2    // to nearest, ties to even
+
+// Input/output system numbers, as listed in the interactive menus.
+#define NUMCONV_SYS_UNSIGNED 1
+#define NUMCONV_SYS_SIGNED_MAGNITUDE 2
+#define NUMCONV_SYS_ONES_COMPLEMENT 3
+#define NUMCONV_SYS_TWOS_COMPLEMENT 4
+#define NUMCONV_SYS_IEEE754 5
+#define NUMCONV_SYS_DECIMAL 6
+#define NUMCONV_SYS_FIXED 7
+
+/*
+ * Status flags of a checked conversion (see numconv_convert_status()), one
+ * for each way a result can differ from the value it was converted from.
+ */
+#define NUMCONV_INVALID 0x01    // not a number in the input system; no result
+#define NUMCONV_OVERFLOW 0x02   // out of the output's range: saturated, wrapped, or negative for unsigned output
+#define NUMCONV_TRUNCATED 0x04  // a fraction dropped for integer output
+#define NUMCONV_INEXACT 0x08    // rounded to a floating-point value on the way
+#define NUMCONV_FAILED 0x10     // no result, for the reason flagged or for lack of memory
+#define NUMCONV_STATUS_BITS 5
+
+/* An IEEE754-style binary floating-point format: 1 sign bit, exp_bits, mantissa_bits. */
+struct numconv_ieee754_format {
+    const char *name;
+    int exp_bits;
+    int mantissa_bits;
+    bool finite;        // no infinities; all ones is the only NaN (OCP FP8 E4M3)
+};
+
+/* binary32, the default format of a context. */
+extern const struct numconv_ieee754_format numconv_binary32;
+
+/*
+ * A fixed-point format Qm.n: a two's complement integer of 1 + m + n bits
+ * (m + n for unsigned UQm.n) read as that integer times 2^-n.
+ */
+struct numconv_fixed_format {
+    int int_bits;
+    int frac_bits;
+    bool is_unsigned;
+};
+
+/* Q15, the default fixed-point format of a context. */
+extern const struct numconv_fixed_format numconv_q15;
+
+/* A conversion context; see numconv_new(). */
+struct numconv;
+
+/* A per-thread cache of recent results; see numconv_cache_new(). */
+struct numconv_cache;
+
+/* A value that failed to convert, by index within its batch. */
+struct numconv_error {
+    unsigned long index;
+    const char *message;
+    unsigned int status;    // its NUMCONV_* flags in a checked context, else 0
+};
+
+/*
+ * The results of numconv_convert_batch(): the output, the failures and the
+ * number of values. Start from a zeroed batch; its buffers grow as needed,
+ * are reused by later batches and are released by numconv_batch_free().
+ */
+struct numconv_batch {
+    char *out;
+    size_t out_len, out_cap;
+    struct numconv_error *errors;
+    size_t nerrors, errors_cap;
+    unsigned long count;
+    unsigned long flagged[NUMCONV_STATUS_BITS];     // in a checked context, the values raising each flag
+};
+
+struct numconv *numconv_new(int inputSystem, int outputSystem);
+void numconv_free(struct numconv *conv);
+bool numconv_set_radix(struct numconv *conv, unsigned int in_radix, unsigned int out_radix);
+void numconv_set_width(struct numconv *conv, unsigned int numbits);
+bool numconv_set_rounding(struct numconv *conv, int rounding_mode);
+void numconv_set_formats(struct numconv *conv, const struct numconv_ieee754_format *in_format,
+                         const struct numconv_ieee754_format *out_format);
+void numconv_set_fixed(struct numconv *conv, const struct numconv_fixed_format *in_fixed,
+                       const struct numconv_fixed_format *out_fixed);
+void numconv_set_packed(struct numconv *conv, unsigned int in_bytes, bool packed_out);
+void numconv_set_checked(struct numconv *conv, bool checked, unsigned int fail);
+unsigned int numconv_packed_size(const struct numconv *conv);
+bool numconv_check(const struct numconv *conv, const char **error);
+size_t numconv_output_size(const struct numconv *conv, size_t len);
+char *numconv_convert(const struct numconv *conv, const char *text, size_t len, char *out, size_t outlen,
+                      const char **error);
+unsigned int numconv_convert_status(const struct numconv *conv, const char *text, size_t len, char *out,
+                                    size_t outlen, const char **error);
+const char *numconv_status_message(unsigned int status);
+bool numconv_convert_batch(const struct numconv *conv, struct numconv_cache *cache, const char *data, size_t len,
+                           struct numconv_batch *batch);
+void numconv_batch_free(struct numconv_batch *batch);
+struct numconv_cache *numconv_cache_new(unsigned long entries);
+void numconv_cache_free(struct numconv_cache *cache);
+void numconv_cache_counts(const struct numconv_cache *cache, unsigned long *hits, unsigned long *misses);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
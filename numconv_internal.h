@@ -0,0 +1,111 @@
+/*
+ * numconv internals shared by numconv.c and pa2.c: the single-step
+ * converters a context drives, the parsers for command-line names, the
+ * lookup tables and statistics, and short names for the NUMCONV_ system
+ * and rounding numbers. None of it is part of the API in numconv.h, and it
+ * may change with any release.
+ */
+#ifndef NUMCONV_INTERNAL_H
+#define NUMCONV_INTERNAL_H
+
+#include <stdio.h>
+#include <string.h>
+
+#include "numconv.h"
+
+#define ROUNDUP NUMCONV_ROUND_UP
+#define ROUNDDOWN NUMCONV_ROUND_DOWN
+#define ROUNDTOEVEN NUMCONV_ROUND_EVEN
+
+#define SYS_UNSIGNED NUMCONV_SYS_UNSIGNED
+#define SYS_SIGNED_MAGNITUDE NUMCONV_SYS_SIGNED_MAGNITUDE
+#define SYS_ONES_COMPLEMENT NUMCONV_SYS_ONES_COMPLEMENT
+#define SYS_TWOS_COMPLEMENT NUMCONV_SYS_TWOS_COMPLEMENT
+#define SYS_IEEE754 NUMCONV_SYS_IEEE754
+#define SYS_DECIMAL NUMCONV_SYS_DECIMAL
+#define SYS_FIXED NUMCONV_SYS_FIXED
+
+unsigned long binary_to_unsigned_decimal(const char *input_string);
+long binary_to_signed_magnitude_decimal(const char *input_string);
+long binary_to_ones_complement_decimal(const char *input_string);
+long binary_to_twos_complement_decimal(const char *input_string);
+double ieee754_to_decimal(char *input, int exp, int mantissa);
+char *unsigned_decimal_to_binary(unsigned long input, unsigned int numbits);
+char *signed_decimal_to_signed_magnitude(long input, unsigned int numbits);
+char *signed_decimal_to_ones_complement(long input, unsigned int numbits);
+char *signed_decimal_to_twos_complement(long input, unsigned int numbits);
+char *decimal_to_ieee754_binary(double input, int exp_bits, int mantissa_bits, int rounding_mode);
+char *unsigned_decimal_to_binary_buf(unsigned long input, unsigned int numbits, char *out, size_t outlen);
+char *signed_decimal_to_signed_magnitude_buf(long input, unsigned int numbits, char *out, size_t outlen);
+char *signed_decimal_to_ones_complement_buf(long input, unsigned int numbits, char *out, size_t outlen);
+char *signed_decimal_to_twos_complement_buf(long input, unsigned int numbits, char *out, size_t outlen);
+long decode_integer_bits(int system, unsigned long bits, size_t len, bool sign_bit);
+void emit_binary_digits(unsigned long value, unsigned int numbits, bool complement, char *out);
+bool ieee754_format_supported(int exp_bits, int mantissa_bits);
+unsigned long ieee754_encode_bits(double input, int exp_bits, int mantissa_bits, int rounding_mode);
+bool parse_ieee754_format(const char *arg, struct numconv_ieee754_format *format);
+double ieee754_decode_format(unsigned long bits, const struct numconv_ieee754_format *format);
+unsigned long ieee754_encode_format(double input, const struct numconv_ieee754_format *format, int rounding_mode);
+size_t transcode_packed_floats(const char *src, size_t count, const struct numconv_ieee754_format *from,
+                               const struct numconv_ieee754_format *to, int rounding_mode, char *dst);
+bool parse_fixed_format(const char *arg, struct numconv_fixed_format *format);
+unsigned int fixed_format_bits(const struct numconv_fixed_format *format);
+double fixed_decode_double(unsigned long bits, const struct numconv_fixed_format *format);
+unsigned long fixed_encode_double(double input, const struct numconv_fixed_format *format, int rounding_mode);
+char *format_fixed_decimal(unsigned long bits, const struct numconv_fixed_format *format, char *out, size_t outlen);
+size_t quantize_packed_floats(const char *src, size_t count, const struct numconv_ieee754_format *from,
+                              const struct numconv_fixed_format *to, int rounding_mode, char *dst);
+void dequantize_packed(const char *src, size_t count, const struct numconv_fixed_format *from,
+                       const struct numconv_ieee754_format *to, int rounding_mode, char *dst);
+bool lookup_tables_init(unsigned int bits);
+size_t lookup_tables_size(void);
+unsigned int lookup_tables_bits(void);
+char *convert_number(const char *numberStr, size_t len, int inputSystem, int outputSystem,
+                     unsigned int numbits, const struct numconv_ieee754_format *in_format,
+                     const struct numconv_ieee754_format *out_format, int rounding_mode, char *out, size_t outlen,
+                     const char **error);
+bool convert_bits(unsigned long bits, unsigned int width, int inputSystem, int outputSystem,
+                  unsigned int numbits, const struct numconv_ieee754_format *in_format,
+                  const struct numconv_ieee754_format *out_format, int rounding_mode, unsigned long *result,
+                  const char **error);
+unsigned int parse_radix(const char *arg);
+int parse_rounding(const char *arg);
+bool parse_decimal(const char *text, size_t len, double *value);
+int parse_system(const char *arg, unsigned int *radix);
+void stats_start(void);
+void stats_report(FILE *out, bool json);
+
+/* Little-endian loads and stores of packed elements. */
+static inline unsigned long load_packed(const char *p, unsigned int bytes)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint16_t v16;
+    uint32_t v32;
+    uint64_t v64;
+    switch (bytes) {
+        case 1: return (unsigned char)*p;
+        case 2: memcpy(&v16, p, 2); return v16;
+        case 4: memcpy(&v32, p, 4); return v32;
+        case 8: memcpy(&v64, p, 8); return v64;
+    }
+#endif
+    unsigned long v = 0;
+    for (unsigned int i = 0; i < bytes; i++)
+        v |= (unsigned long)(unsigned char)p[i] << (8 * i);
+    return v;
+}
+
+static inline void store_packed(char *p, unsigned long v, unsigned int bytes)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (bytes == 1 || bytes == 2 || bytes == 4 || bytes == 8) {
+        uint64_t v64 = v;
+        memcpy(p, &v64, bytes);
+        return;
+    }
+#endif
+    for (unsigned int i = 0; i < bytes; i++)
+        p[i] = (char)(v >> (8 * i));
+}
+
+#endif
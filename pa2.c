@@ -6,29 +6,74 @@
 #include <stdbool.h>
 #include <limits.h>
 #include <float.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <time.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
-#define ROUNDUP 0
-#define ROUNDDOWN 1
-#define ROUNDTOEVEN 2
-
-unsigned long binary_to_unsigned_decimal(const char *input_string);
-long binary_to_signed_magnitude_decimal(const char *input_string);
-long binary_to_ones_complement_decimal(const char *input_string);
-long binary_to_twos_complement_decimal(const char *input_string);
-double ieee754_to_decimal(char *input, int exp, int mantissa);
-char *unsigned_decimal_to_binary(unsigned long input, unsigned int numbits);
-char *signed_decimal_to_signed_magnitude(long input, unsigned int numbits);
-char *signed_decimal_to_ones_complement(long input, unsigned int numbits);
-char *signed_decimal_to_twos_complement(long input, unsigned int numbits);
-char *decimal_to_ieee754_binary(double input, int exp_bits, int mantissa_bits, int rounding_mode);
-
-int main(void) {
-    char choice[10];
+#include "numconv_internal.h"
+
+static unsigned int parse_bits(const char *arg);
+static unsigned long server_selftest(void);
+bool stats_enable(const char *format);
+void stats_dump(void);
+int run_batch(int argc, char **argv);
+int run_bench(int argc, char **argv);
+int run_selftest(int argc, char **argv);
+int run_server(int argc, char **argv);
+int run_load(int argc, char **argv);
+
+int main(int argc, char **argv) {
+    char choice[32];
     char numberStr[256];
     int inputSystem, outputSystem;
+    unsigned int in_radix, out_radix;   // radix of binary input and output digits
+    struct numconv_ieee754_format in_format, out_format;
+    struct numconv_fixed_format in_fixed, out_fixed;
+    int rounding_mode;
     unsigned int numbits = 0; // used for output conversion when needed
-    double dvalue = 0.0;
-    long value = 0;
+    const char *error;
+
+    // A leading --stats[=text|json] records every conversion in either mode.
+    if (argc > 1 && strncmp(argv[1], "--stats", 7) == 0 && (argv[1][7] == '\0' || argv[1][7] == '=')) {
+        if (!stats_enable(argv[1][7] ? argv[1] + 8 : "text")) {
+            fprintf(stderr, "pa2: --stats takes text or json\n");
+            return 2;
+        }
+        argv[1] = argv[0];
+        argc--;
+        argv++;
+    }
+
+    // Any command-line arguments select the non-interactive batch mode.
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return run_bench(argc - 1, argv + 1);
+    if (argc > 1 && strcmp(argv[1], "--selftest") == 0)
+        return run_selftest(argc - 1, argv + 1);
+    if (argc > 1 && strcmp(argv[1], "--serve") == 0)
+        return run_server(argc - 1, argv + 1);
+    if (argc > 1 && strcmp(argv[1], "--load") == 0)
+        return run_load(argc - 1, argv + 1);
+    if (argc > 1)
+        return run_batch(argc, argv);
+    lookup_tables_init(8);
     
     while (1) {
         // Display input system menu.
@@ -37,9 +82,11 @@ int main(void) {
         printf("  2. Signed magnitude binary (binary digits only)\n");
         printf("  3. One's complement binary (binary digits only)\n");
         printf("  4. Two's complement binary (binary digits only)\n");
-        printf("  5. IEEE754 binary (exactly 32 bits required)\n");
+        printf("  5. IEEE754 binary (binary32 unless another format is chosen)\n");
         printf("  6. Decimal (base 10)\n");
-        printf("Enter input system (1-6) or 'q'/'quit': ");
+        printf("  7. Fixed point binary (Q15 unless another format is chosen)\n");
+        printf("  (append :RADIX for 1-5 and 7 to use digits of radix 2-36, e.g. 4:16 or 4:hex)\n");
+        printf("Enter input system (1-7) or 'q'/'quit': ");
         if (!fgets(choice, sizeof(choice), stdin))
             break;
         choice[strcspn(choice, "\n")] = '\0';
@@ -47,8 +94,13 @@ int main(void) {
             break;
         }
         inputSystem = atoi(choice);
-        if (inputSystem < 1 || inputSystem > 6) {
-            printf("Invalid input system. Please enter a number from 1 to 6.\n\n");
+        if (inputSystem < SYS_UNSIGNED || inputSystem > SYS_FIXED) {
+            printf("Invalid input system. Please enter a number from 1 to 7.\n\n");
+            continue;
+        }
+        in_radix = strchr(choice, ':') ? parse_radix(strchr(choice, ':') + 1) : 2;
+        if (in_radix == 0 || (inputSystem == SYS_DECIMAL && in_radix != 2 && in_radix != 10)) {
+            printf("Invalid radix. Please enter 2-36, bin, oct or hex after a binary system.\n\n");
             continue;
         }
         
@@ -58,591 +110,3796 @@ int main(void) {
         printf("  2. Signed magnitude binary\n");
         printf("  3. One's complement binary\n");
         printf("  4. Two's complement binary\n");
-        printf("  5. IEEE754 binary (32 bits output)\n");
-        printf("Enter output system (1-5): ");
+        printf("  5. IEEE754 binary (binary32 unless another format is chosen)\n");
+        printf("  6. Decimal (base 10)\n");
+        printf("  7. Fixed point binary (Q15 unless another format is chosen)\n");
+        printf("  (append :RADIX for 1-5 and 7 to use digits of radix 2-36, e.g. 4:16 or 4:hex)\n");
+        printf("Enter output system (1-7): ");
         if (!fgets(choice, sizeof(choice), stdin))
             break;
         choice[strcspn(choice, "\n")] = '\0';
         outputSystem = atoi(choice);
-        if (outputSystem < 1 || outputSystem > 5) {
-            printf("Invalid output system. Please enter a number from 1 to 5.\n\n");
+        if (outputSystem < SYS_UNSIGNED || outputSystem > SYS_FIXED) {
+            printf("Invalid output system. Please enter a number from 1 to 7.\n\n");
+            continue;
+        }
+        out_radix = strchr(choice, ':') ? parse_radix(strchr(choice, ':') + 1) : 2;
+        if (out_radix == 0 || (outputSystem == SYS_DECIMAL && out_radix != 2 && out_radix != 10)) {
+            printf("Invalid radix. Please enter 2-36, bin, oct or hex after a binary system.\n\n");
             continue;
         }
+
+        // IEEE754 and fixed-point input and output take a format, and their output a rounding mode.
+        in_format = out_format = numconv_binary32;
+        in_fixed = out_fixed = numconv_q15;
+        rounding_mode = ROUNDTOEVEN;
+        if (inputSystem == SYS_IEEE754) {
+            printf("Enter the IEEE754 input format (binary16, bfloat16, binary32, binary64, e4m3, e5m2 or eXmY;\n"
+                   "press Enter for binary32): ");
+            if (!fgets(choice, sizeof(choice), stdin))
+                break;
+            choice[strcspn(choice, "\n")] = '\0';
+            if (*choice && !parse_ieee754_format(choice, &in_format)) {
+                printf("Invalid IEEE754 format.\n\n");
+                continue;
+            }
+        }
+        if (outputSystem == SYS_IEEE754) {
+            printf("Enter the IEEE754 output format (binary16, bfloat16, binary32, binary64, e4m3, e5m2 or eXmY;\n"
+                   "press Enter for binary32): ");
+            if (!fgets(choice, sizeof(choice), stdin))
+                break;
+            choice[strcspn(choice, "\n")] = '\0';
+            if (*choice && !parse_ieee754_format(choice, &out_format)) {
+                printf("Invalid IEEE754 format.\n\n");
+                continue;
+            }
+        }
+        if (inputSystem == SYS_FIXED) {
+            printf("Enter the fixed-point input format (Qm.n, Qn or UQm.n; press Enter for Q15): ");
+            if (!fgets(choice, sizeof(choice), stdin))
+                break;
+            choice[strcspn(choice, "\n")] = '\0';
+            if (*choice && !parse_fixed_format(choice, &in_fixed)) {
+                printf("Invalid fixed-point format.\n\n");
+                continue;
+            }
+        }
+        if (outputSystem == SYS_FIXED) {
+            printf("Enter the fixed-point output format (Qm.n, Qn or UQm.n; press Enter for Q15): ");
+            if (!fgets(choice, sizeof(choice), stdin))
+                break;
+            choice[strcspn(choice, "\n")] = '\0';
+            if (*choice && !parse_fixed_format(choice, &out_fixed)) {
+                printf("Invalid fixed-point format.\n\n");
+                continue;
+            }
+        }
+        if (outputSystem == SYS_IEEE754 || outputSystem == SYS_FIXED) {
+            printf("Enter the rounding mode (up, down or even; press Enter for even): ");
+            if (!fgets(choice, sizeof(choice), stdin))
+                break;
+            choice[strcspn(choice, "\n")] = '\0';
+            if (*choice && (rounding_mode = parse_rounding(choice)) < 0) {
+                printf("Invalid rounding mode.\n\n");
+                continue;
+            }
+        }
         
         // Prompt for the number to convert.
-        if (inputSystem >= 1 && inputSystem <= 5) {
-            if (inputSystem == 5)
-                printf("\nEnter the IEEE754 number to convert (exactly 32 binary digits): ");
+        if (inputSystem == SYS_FIXED && in_radix != 2) {
+            printf("\nEnter the fixed-point number to convert (%u bits as base-%u digits): ",
+                   fixed_format_bits(&in_fixed), in_radix);
+        } else if (inputSystem == SYS_FIXED) {
+            printf("\nEnter the fixed-point number to convert (exactly %u binary digits): ",
+                   fixed_format_bits(&in_fixed));
+        } else if (inputSystem >= SYS_UNSIGNED && inputSystem <= SYS_IEEE754) {
+            unsigned int in_bits = (unsigned int)(1 + in_format.exp_bits + in_format.mantissa_bits);
+            if (inputSystem == SYS_IEEE754 && in_radix != 2)
+                printf("\nEnter the IEEE754 number to convert (%u bits as base-%u digits): ", in_bits, in_radix);
+            else if (inputSystem == SYS_IEEE754)
+                printf("\nEnter the IEEE754 number to convert (exactly %u binary digits): ", in_bits);
+            else if (in_radix != 2)
+                printf("\nEnter the number to convert (base-%u digits only): ", in_radix);
             else
                 printf("\nEnter the number to convert (binary digits only): ");
-        } else if (inputSystem == 6) {
+        } else if (inputSystem == SYS_DECIMAL) {
             printf("\nEnter the decimal number to convert: ");
         }
         if (!fgets(numberStr, sizeof(numberStr), stdin))
             break;
         numberStr[strcspn(numberStr, "\n")] = '\0';
         
-        // Process input based on chosen system.
-        if (inputSystem >= 1 && inputSystem <= 5) {
-            // Validate that the number consists only of 0's and 1's.
-            bool valid = true;
-            for (int i = 0; numberStr[i] != '\0'; i++) {
-                if (numberStr[i] != '0' && numberStr[i] != '1') {
-                    valid = false;
-                    break;
-                }
-            }
-            if (!valid || strlen(numberStr) == 0) {
-                printf("Invalid number input. Please enter only binary digits (0 and 1).\n\n");
-                continue;
-            }
-            // For IEEE754 input, require exactly 32 bits.
-            if (inputSystem == 5 && strlen(numberStr) != 32) {
-                printf("Invalid IEEE754 input. Must be exactly 32 bits (1 sign + 8 exponent + 23 mantissa).\n\n");
+        // Binary inputs keep their own width; decimal input asks for one.
+        numbits = 0;
+        if (inputSystem == SYS_DECIMAL) {
+            double dvalue = 0;
+            if (!parse_decimal(numberStr, strlen(numberStr), &dvalue)) {
+                printf("Invalid decimal input.\n\n");
                 continue;
             }
-            // For binary-based inputs, use the length as the number of bits.
-            numbits = strlen(numberStr);
-            
-            // Convert the input string to an intermediate numeric value.
-            switch (inputSystem) {
-                case 1:
-                    value = binary_to_unsigned_decimal(numberStr);
-                    break;
-                case 2:
-                    value = binary_to_signed_magnitude_decimal(numberStr);
-                    break;
-                case 3:
-                    value = binary_to_ones_complement_decimal(numberStr);
-                    break;
-                case 4:
-                    value = binary_to_twos_complement_decimal(numberStr);
-                    break;
-                case 5:
-                    dvalue = ieee754_to_decimal(numberStr, 8, 23);
-                    if (isnan(dvalue)) {
-                        printf("Invalid IEEE754 number.\n\n");
-                        continue;
-                    }
-                    break;
-                default:
-                    printf("Unknown input system.\n\n");
-                    continue;
-            }
-        } else if (inputSystem == 6) {
-            // For decimal input, convert using strtod.
-            dvalue = strtod(numberStr, NULL);
-            // For conversions that require integer representation, we warn if there is a fractional part.
-            if (dvalue != (double)((long)dvalue) && outputSystem != 5) {
-                printf("Warning: Fractional part will be truncated for integer conversions.\n");
-            }
-            // If the output system is not IEEE754, ask for the desired bit width.
-            if (outputSystem != 5) {
+            // If the output system is a binary integer one, ask for the desired bit width.
+            if (outputSystem != SYS_IEEE754 && outputSystem != SYS_DECIMAL && outputSystem != SYS_FIXED) {
                 printf("Enter the desired number of bits for the output representation: ");
                 if (!fgets(choice, sizeof(choice), stdin))
                     break;
                 choice[strcspn(choice, "\n")] = '\0';
-                numbits = (unsigned int)atoi(choice);
+                numbits = parse_bits(choice);
                 if (numbits < 1) {
                     printf("Invalid number of bits.\n\n");
                     continue;
                 }
             }
-            // Set the integer value (truncating if necessary) for conversion functions that expect a long.
-            value = (long)dvalue;
         }
         
-        // Convert the intermediate value to the desired output representation.
+        // A checked conversion tells whether the result lost anything on the way.
+        size_t len = strlen(numberStr);
+        struct numconv *conv = numconv_new(inputSystem, outputSystem);
+        size_t outlen = 0;
         char *result = NULL;
-        switch (outputSystem) {
-            case 1:
-                // Unsigned binary conversion (if negative, report error).
-                if ((inputSystem == 5 || inputSystem == 6) ? (dvalue < 0) : (value < 0)) {
-                    printf("Cannot represent a negative number in an unsigned binary system.\n\n");
-                    continue;
-                }
-                if (inputSystem == 5)
-                    result = unsigned_decimal_to_binary((unsigned long)dvalue, numbits);
-                else if (inputSystem == 6)
-                    result = unsigned_decimal_to_binary((unsigned long)value, numbits);
-                else
-                    result = unsigned_decimal_to_binary((unsigned long)value, numbits);
-                break;
-            case 2:
-                if (inputSystem == 5)
-                    result = signed_decimal_to_signed_magnitude((long)dvalue, numbits);
-                else if (inputSystem == 6)
-                    result = signed_decimal_to_signed_magnitude(value, numbits);
-                else
-                    result = signed_decimal_to_signed_magnitude(value, numbits);
-                break;
-            case 3:
-                if (inputSystem == 5)
-                    result = signed_decimal_to_ones_complement((long)dvalue, numbits);
-                else if (inputSystem == 6)
-                    result = signed_decimal_to_ones_complement(value, numbits);
-                else
-                    result = signed_decimal_to_ones_complement(value, numbits);
-                break;
-            case 4:
-                if (inputSystem == 5)
-                    result = signed_decimal_to_twos_complement((long)dvalue, numbits);
-                else if (inputSystem == 6)
-                    result = signed_decimal_to_twos_complement(value, numbits);
-                else
-                    result = signed_decimal_to_twos_complement(value, numbits);
-                break;
-            case 5:
-                // For IEEE754, we use fixed parameters (8 exponent bits and 23 mantissa bits).
-                if (inputSystem == 5)
-                    result = decimal_to_ieee754_binary(dvalue, 8, 23, ROUNDTOEVEN);
-                else if (inputSystem == 6)
-                    result = decimal_to_ieee754_binary(dvalue, 8, 23, ROUNDTOEVEN);
-                else {
-                    double tmp = (double)value;
-                    result = decimal_to_ieee754_binary(tmp, 8, 23, ROUNDTOEVEN);
-                }
-                break;
-            default:
-                printf("Unknown output system.\n\n");
-                continue;
+        if (conv != NULL) {
+            numconv_set_radix(conv, in_radix, out_radix);
+            numconv_set_width(conv, numbits);
+            numconv_set_rounding(conv, rounding_mode);
+            numconv_set_formats(conv, &in_format, &out_format);
+            numconv_set_fixed(conv, &in_fixed, &out_fixed);
+            outlen = numconv_output_size(conv, len);
+            result = malloc(outlen);
         }
-        
         if (result == NULL) {
             printf("Conversion failed due to an error (memory allocation or invalid input).\n\n");
+            numconv_free(conv);
+            continue;
+        }
+        unsigned int status = numconv_convert_status(conv, numberStr, len, result, outlen, &error);
+        if (status & NUMCONV_FAILED) {
+            printf("%s\n\n", error);
         } else {
-            printf("Converted result: %s\n\n", result);
-            free(result);
+            printf("Converted result: %s\n", result);
+            if (status & NUMCONV_OVERFLOW)
+                printf("Warning: The value is out of the output's range; the result is a different number.\n");
+            if (status & NUMCONV_TRUNCATED)
+                printf("Warning: The fractional part was truncated.\n");
+            if (status & NUMCONV_INEXACT)
+                printf("Warning: The value was rounded to one the output format can represent.\n");
+            printf("\n");
         }
+        free(result);
+        numconv_free(conv);
     }
     
     return 0;
 }
 
 /**
- * Part 1.1 
- * @brief Converts a binary string into its unsigned decimal value.
- * @param input_string The binary string to convert.
- * @return The unsigned decimal value.
+ * @brief Parses a number of bits given on the command line or at a prompt.
+ * @param arg Decimal digits only, from 1 to UINT_MAX.
+ * @return The number of bits, or 0 if the argument is not one.
  */
-unsigned long binary_to_unsigned_decimal(const char *input_string)
+static unsigned int parse_bits(const char *arg)
 {
-    int numOfBits = strlen(input_string);
-    unsigned long sum = 0;
-    for (int i = 0; i < numOfBits; i++){
-        if (input_string[i] == '1'){
-            sum += 1UL << (numOfBits - 1 - i);
-        }
-    }
-    return sum;
-} 
+    char *end;
+    if (*arg < '0' || *arg > '9')
+        return 0;
+    errno = 0;
+    unsigned long n = strtoul(arg, &end, 10);
+    if (errno || *end || n > UINT_MAX)
+        return 0;
+    return (unsigned int)n;
+}
 
 /**
- * Part 3.2
- * @brief Converts a binary string into its decimal value using signed magnitude representation.
- * @param input_string The binary string to convert.
- * @return The signed decimal value.
+ * @brief Parses a packed element format given on the command line.
+ * @param arg One of int8, int16, int32, int64, float16, float32 or float64.
+ * @param is_float Set to whether the elements are IEEE754 floats.
+ * @return The element size in bytes, or 0 if the argument is not recognized.
  */
-long binary_to_signed_magnitude_decimal(const char *input_string)
+static unsigned int parse_packed_format(const char *arg, bool *is_float)
 {
-    bool negative = false;
-    if (input_string[0] == '1'){
-        negative = true;
+    static const char *const names[] = { "int8", "int16", "int32", "int64", "float16", "float32", "float64" };
+    static const unsigned int sizes[] = { 1, 2, 4, 8, 2, 4, 8 };
+    for (int i = 0; i < 7; i++) {
+        if (strcasecmp(arg, names[i]) == 0) {
+            *is_float = i >= 4;
+            return sizes[i];
+        }
     }
+    return 0;
+}
 
-    int len = strlen(input_string + 1);
-    char *mut_str = malloc(len + 1);  // +1 for the null terminator
-    if (!mut_str) {
+/**
+ * @brief Parses a lookup table width given on the command line.
+ * @param arg "none" (or "0"), "8" or "16".
+ * @return The width in bits, or -1 if the argument is not recognized.
+ */
+static int parse_table_bits(const char *arg)
+{
+    if (strcasecmp(arg, "none") == 0 || strcmp(arg, "0") == 0)
         return 0;
-    }
-    strcpy(mut_str, input_string + 1);
+    if (strcmp(arg, "8") == 0)
+        return 8;
+    if (strcmp(arg, "16") == 0)
+        return 16;
+    return -1;
+}
 
-    long result = 0;
-    for (int i = 0; i < len; i++){
-        if (mut_str[i] == '1'){
-            result += 1L << (len - 1 - i);
-        }
-    }
-    if (negative){
-        result = -result;
-    }
-    free(mut_str);
-    return result;
+/**
+ * @brief Parses an IEEE754 format for both sides, or IN:OUT for each.
+ * @param arg The formats, as for -F.
+ * @param in_format Receives the input format.
+ * @param out_format Receives the output format.
+ * @return false if either format is unknown.
+ */
+static bool parse_format_pair(const char *arg, struct numconv_ieee754_format *in_format,
+                              struct numconv_ieee754_format *out_format)
+{
+    char name[32];
+    const char *colon = strchr(arg, ':');
+    size_t len = colon ? (size_t)(colon - arg) : strlen(arg);
+    if (len >= sizeof(name))
+        return false;
+    memcpy(name, arg, len);
+    name[len] = '\0';
+    return parse_ieee754_format(name, in_format) && parse_ieee754_format(colon ? colon + 1 : name, out_format);
+}
+
+/**
+ * @brief Parses a fixed-point format for both sides, or IN:OUT for each.
+ * @param arg The formats, as for -Q.
+ * @param in_fixed Receives the input format.
+ * @param out_fixed Receives the output format.
+ * @return false if either format is unknown.
+ */
+static bool parse_fixed_pair(const char *arg, struct numconv_fixed_format *in_fixed,
+                             struct numconv_fixed_format *out_fixed)
+{
+    char name[32];
+    const char *colon = strchr(arg, ':');
+    size_t len = colon ? (size_t)(colon - arg) : strlen(arg);
+    if (len >= sizeof(name))
+        return false;
+    memcpy(name, arg, len);
+    name[len] = '\0';
+    return parse_fixed_format(name, in_fixed) && parse_fixed_format(colon ? colon + 1 : name, out_fixed);
+}
+
+/**
+ * @brief Parses the checks that fail a value, given on the command line.
+ * @param arg A comma-separated list of overflow, truncated and inexact, or all.
+ * @param flags Receives the NUMCONV_* flags.
+ * @return false if a name is not recognized.
+ */
+static bool parse_status_flags(const char *arg, unsigned int *flags)
+{
+    static const char *const names[] = { "overflow", "truncated", "inexact", "all" };
+    static const unsigned int values[] = { NUMCONV_OVERFLOW, NUMCONV_TRUNCATED, NUMCONV_INEXACT,
+                                           NUMCONV_OVERFLOW | NUMCONV_TRUNCATED | NUMCONV_INEXACT };
+    *flags = 0;
+    do {
+        size_t len = strcspn(arg, ",");
+        int i = 0;
+        while (i < 4 && !(strlen(names[i]) == len && strncasecmp(arg, names[i], len) == 0))
+            i++;
+        if (i == 4)
+            return false;
+        *flags |= values[i];
+        arg += len;
+    } while (*arg++ == ',');
+    return true;
 }
 
 /**
- * Part 3.3
- * @brief Converts a binary string into its decimal value using one's complement.
- * @param input_string The binary string to convert.
- * @return The signed decimal value.
+ * @brief Parses a column of delimited input to convert: "COLUMN=IN,OUT[,BITS[,MODE[,FORMAT]]]".
+ *
+ * COLUMN counts from 1; IN and OUT are systems as for -i and -o, and the
+ * optional fields are as for -b, -r and -F. Empty optional fields keep
+ * their defaults, e.g. "3=decimal,ieee754,,down".
+ *
+ * @param arg The column spec.
+ * @param field Receives the 0-based field number.
+ * @param error Set to a message describing the problem when NULL is returned.
+ * @return The column's conversion context, or NULL if the spec is invalid.
  */
-long binary_to_ones_complement_decimal(const char *input_string)
+static struct numconv *parse_column_spec(const char *arg, unsigned int *field, const char **error)
 {
-    char *mut_str = strdup(input_string);
-    int len = strlen(mut_str); 
-    if (input_string[0] == '1'){
-        // Invert every bit.
-        for (int i = 0; i < len; i++){
-            mut_str[i] = (mut_str[i] == '1') ? '0' : '1';
+    char buf[128];
+    char *parts[5] = { NULL };
+    unsigned int in_radix = 2, out_radix = 2;
+    struct numconv_ieee754_format in_format = numconv_binary32, out_format = numconv_binary32;
+    int rounding_mode = ROUNDTOEVEN;
+    char *end;
+
+    if (strlen(arg) >= sizeof(buf)) {
+        *error = "spec too long";
+        return NULL;
+    }
+    strcpy(buf, arg);
+    char *eq = strchr(buf, '=');
+    unsigned long column = strtoul(buf, &end, 10);
+    if (eq == NULL || end != eq || column < 1 || column > 65536) {
+        *error = "expected COLUMN=IN,OUT[,BITS[,MODE[,FORMAT]]] with COLUMN from 1";
+        return NULL;
+    }
+    int nparts = 0;
+    for (char *p = eq + 1; p; nparts++) {
+        if (nparts == 5) {
+            *error = "too many fields";
+            return NULL;
         }
+        parts[nparts] = p;
+        p = strchr(p, ',');
+        if (p)
+            *p++ = '\0';
     }
-  
-    unsigned long result = 0;
-    for (int i = 1; i < len; i++){
-        if (mut_str[i] == '1'){
-            result += 1UL << (len - 1 - i);
+    int inputSystem = parse_system(parts[0], &in_radix);
+    int outputSystem = parts[1] ? parse_system(parts[1], &out_radix) : 0;
+    if (!inputSystem || !outputSystem) {
+        *error = "unknown input or output system";
+        return NULL;
+    }
+    unsigned long numbits = 0;
+    if (parts[2] && *parts[2]) {
+        numbits = parse_bits(parts[2]);
+        if (numbits < 1) {
+            *error = "invalid number of bits";
+            return NULL;
         }
     }
-    free(mut_str);
-    return (input_string[0] == '1') ? -((long)result) : (long)result;
+    if (parts[3] && *parts[3] && (rounding_mode = parse_rounding(parts[3])) < 0) {
+        *error = "unknown rounding mode";
+        return NULL;
+    }
+    if (parts[4] && *parts[4] && !parse_format_pair(parts[4], &in_format, &out_format)) {
+        *error = "unknown IEEE754 format";
+        return NULL;
+    }
+    struct numconv *conv = numconv_new(inputSystem, outputSystem);
+    if (conv == NULL) {
+        *error = strerror(ENOMEM);
+        return NULL;
+    }
+    numconv_set_radix(conv, in_radix, out_radix);
+    numconv_set_width(conv, (unsigned int)numbits);
+    numconv_set_rounding(conv, rounding_mode);
+    numconv_set_formats(conv, &in_format, &out_format);
+    if (!numconv_check(conv, error)) {
+        numconv_free(conv);
+        return NULL;
+    }
+    *field = (unsigned int)(column - 1);
+    return conv;
 }
 
-/**
- * Part 1.4
- * @brief Converts a binary string into its decimal value using two's complement.
- * @param input_string The binary string to convert.
- * @return The signed decimal value.
+/*
+ * Conversion statistics.
+ *
+ * With --stats, the library counts every conversion (see stats_start()),
+ * and the report is printed on stderr at exit and whenever the process
+ * receives SIGUSR1, as text or JSON.
  */
-long binary_to_twos_complement_decimal(const char *input_string)
+static bool stats_json;
+
+/* Prints the statistics on stderr, in the format --stats asked for. */
+void stats_dump(void)
 {
-    int len = strlen(input_string);
-    unsigned long unsigned_num = binary_to_unsigned_decimal(input_string);
+    stats_report(stderr, stats_json);
+}
 
-    // Use an unsigned constant for shifting to correctly compute 2^len.
-    if (input_string[0] == '0'){
-        return (long)unsigned_num;
-    } else {
-        return (long)(unsigned_num - (1UL << len));
-    }
+/* Dumps the statistics each time SIGUSR1 arrives; every other thread has it blocked. */
+static void *stats_signal_thread(void *arg)
+{
+    sigset_t *set = arg;
+    int sig;
+    while (sigwait(set, &sig) == 0)
+        stats_dump();
+    return NULL;
 }
 
 /**
- * Part 2.1
- * @brief Converts an unsigned decimal value into its unsigned binary representation.
- * @param input The decimal value to convert.
- * @param numbits The number of bits for the representation.
- * @return The binary string (allocated on the heap).
+ * @brief Turns the statistics on ("--stats" or "--stats=text|json").
+ *
+ * Must be called before any other thread starts, so that all of them
+ * inherit the blocked SIGUSR1 and leave it to the dumping thread.
+ *
+ * @param format "text" or "json".
+ * @return false if the format is unknown.
  */
-char *unsigned_decimal_to_binary(unsigned long input, unsigned int numbits)
+bool stats_enable(const char *format)
 {
-    char *str = malloc(numbits + 1);
-    if (!str){
-        return NULL;
-    }
-    str[numbits] = '\0';
+    static sigset_t set;
+    if (strcmp(format, "text") != 0 && strcmp(format, "json") != 0)
+        return false;
+    stats_json = strcmp(format, "json") == 0;
+    stats_start();
+    atexit(stats_dump);
 
-    unsigned long remainder = input;
-    unsigned long power;
-    for (unsigned int i = 0; i < numbits; i++){
-        power = 1UL << (numbits - 1 - i);
-        if (power <= remainder){
-            str[i] = '1';
-            remainder -= power;
-        } else {
-            str[i] = '0';
-        }
+    // The dumping thread starts with every signal blocked, so that signals
+    // other threads wait for (the server's SIGINT) are never delivered to it.
+    pthread_t thread;
+    sigset_t all, old;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    sigfillset(&all);
+    if (pthread_sigmask(SIG_BLOCK, &set, NULL) == 0 && pthread_sigmask(SIG_BLOCK, &all, &old) == 0) {
+        if (pthread_create(&thread, NULL, stats_signal_thread, &set) == 0)
+            pthread_detach(thread);
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
     }
-    return str;
+    return true;
+}
+
+/*
+ * Batch engine.
+ *
+ * Input is read in chunks of whole lines. Each chunk is converted into its
+ * own output buffer by numconv_convert_batch(), so chunks can be handed to
+ * a pool of worker threads and still be written back strictly in input
+ * order. Chunk buffers live in a small ring and are reused, so a
+ * steady-state run allocates nothing.
+ *
+ * Input and output can also be packed: arrays of little-endian integers or
+ * floats instead of lines. Chunks of packed input hold whole elements.
+ *
+ * Lines can also be rows of delimited fields (CSV or TSV) where only some
+ * columns are converted, each with its own context. A chunk's rows are
+ * split once, each converted column is gathered and converted as a batch of
+ * its own, and the rows are put back together with every other byte copied
+ * straight from the input.
+ */
+#define BATCH_CHUNK_SIZE (1 << 20)
+#define BATCH_MAX_COLUMNS 256
+
+/* A converted column of delimited rows. */
+struct batch_column {
+    unsigned int field;         // 0-based field number
+    struct numconv *conv;
+};
+
+/* Settings shared by every line of a batch run. */
+struct batch_spec {
+    const struct numconv *conv;
+    unsigned int in_bytes;      // element size of packed input, 0 for lines of text
+    unsigned long cache_entries;    // lines each thread's result cache remembers, 0 for no cache
+    const struct batch_column *columns;     // converted columns by field number, or NULL for whole lines
+    unsigned int ncolumns;
+    char delim;                 // field delimiter of rows
+    bool header;                // pass the first line through unchanged
+    bool summary;               // count failures and flags instead of reporting each failed line
+};
+
+/* The values of one converted column within a chunk, and their results. */
+struct batch_column_values {
+    char *values;               // the column's fields, one per line
+    size_t len, cap;
+    struct numconv_batch result;
+    size_t cursor;              // next result line or error when the rows are rebuilt and reported
+};
+
+enum batch_chunk_state { CHUNK_EMPTY, CHUNK_READY, CHUNK_BUSY, CHUNK_DONE };
+
+/* A block of whole input lines and the results converted from them. */
+struct batch_chunk {
+    const char *data;       // the lines to convert: in, or a slice of a mapped file
+    size_t data_len;
+    char *in;
+    size_t in_len, in_cap;
+    struct numconv_batch result;
+    bool failed;            // ran out of memory while converting
+    struct batch_column_values *columns;    // one per converted column of delimited rows
+    size_t *fields;         // per row: start and end of each converted field, then the end of the row
+    size_t fields_cap;
+    enum batch_chunk_state state;
+};
+
+/*
+ * Source of batch chunks: either a stream, where the partial last line of
+ * one read is carried over to the next chunk, or a memory-mapped file, where
+ * chunks are slices of the mapping and no input byte is ever copied.
+ */
+struct batch_reader {
+    FILE *in;
+    char *carry;
+    size_t carry_len, carry_cap;
+    bool eof;
+    const char *map;
+    size_t map_len, map_pos;
+    size_t record;          // element size of packed input, 0 for lines
+};
+
+static bool grow_buffer(char **buf, size_t *cap, size_t need)
+{
+    if (need <= *cap)
+        return true;
+    size_t new_cap = *cap ? *cap : 4096;
+    while (new_cap < need)
+        new_cap *= 2;
+    char *grown = realloc(*buf, new_cap);
+    if (!grown)
+        return false;
+    *buf = grown;
+    *cap = new_cap;
+    return true;
 }
 
 /**
- * Part 2.1
- * @brief Converts a signed decimal value into its binary representation using signed magnitude.
- * @param input The decimal value to convert.
- * @param numbits The number of bits for the representation.
- * @return The binary string (allocated on the heap).
+ * @brief Fills a chunk with the next block of whole lines from the input.
+ * @param r The reader state.
+ * @param c The chunk to fill; its buffers are reused.
+ * @return 1 if the chunk holds data, 0 at end of input, -1 on read or allocation errors.
  */
-char *signed_decimal_to_signed_magnitude(long input, unsigned int numbits)
+static int batch_read_chunk(struct batch_reader *r, struct batch_chunk *c)
 {
-    if (numbits < 1){
-        return NULL;
+    if (r->map) {
+        // Extend the slice to the end of the line straddling the chunk size.
+        size_t start = r->map_pos, left = r->map_len - start;
+        if (left == 0)
+            return 0;
+        size_t len = left;
+        if (left > BATCH_CHUNK_SIZE && r->record) {
+            len = BATCH_CHUNK_SIZE - BATCH_CHUNK_SIZE % r->record;
+        } else if (left > BATCH_CHUNK_SIZE) {
+            const char *nl = memchr(r->map + start + BATCH_CHUNK_SIZE - 1, '\n', left - BATCH_CHUNK_SIZE + 1);
+            len = nl ? (size_t)(nl - (r->map + start)) + 1 : left;
+        }
+        c->data = r->map + start;
+        c->data_len = len;
+        r->map_pos += len;
+        return 1;
     }
-    char *binary = malloc(numbits + 1);
-    if (!binary){
-        return NULL;
+
+    c->in_len = 0;
+    if (!grow_buffer(&c->in, &c->in_cap, r->carry_len + BATCH_CHUNK_SIZE + 1))
+        return -1;
+    if (r->carry_len)
+        memcpy(c->in, r->carry, r->carry_len);
+    c->in_len = r->carry_len;
+    r->carry_len = 0;
+
+    if (r->record) {
+        // Packed input: fill the chunk, then carry a partial element over.
+        while (!r->eof && c->in_len < BATCH_CHUNK_SIZE) {
+            size_t got = fread(c->in + c->in_len, 1, BATCH_CHUNK_SIZE - c->in_len, r->in);
+            c->in_len += got;
+            if (got == 0) {
+                if (ferror(r->in))
+                    return -1;
+                r->eof = true;
+            }
+        }
+        size_t tail = r->eof ? 0 : c->in_len % r->record;
+        if (!grow_buffer(&r->carry, &r->carry_cap, tail + 1))
+            return -1;
+        memcpy(r->carry, c->in + c->in_len - tail, tail);
+        r->carry_len = tail;
+        c->in_len -= tail;
+        c->data = c->in;
+        c->data_len = c->in_len;
+        return c->in_len > 0;
     }
-    binary[numbits] = '\0';
 
-    unsigned long magnitude;
-    if (input < 0){
-        binary[0] = '1';
-        magnitude = (unsigned long)(-input);
-    } else {
-        binary[0] = '0';
-        magnitude = (unsigned long)input;
-    }
-    for (unsigned int i = 1; i < numbits; i++){
-        unsigned int shift = numbits - 1 - i;
-        unsigned long power = 1UL << shift;
-        if (power <= magnitude) {
-            binary[i] = '1';
-            magnitude -= power;
-        } else {
-            binary[i] = '0';
+    size_t scanned = 0;
+    for (;;) {
+        if (!r->eof) {
+            size_t got = fread(c->in + c->in_len, 1, c->in_cap - 1 - c->in_len, r->in);
+            c->in_len += got;
+            if (got == 0) {
+                if (ferror(r->in))
+                    return -1;
+                r->eof = true;
+            }
+        }
+        c->data = c->in;
+        c->data_len = c->in_len;
+        if (r->eof)
+            return c->in_len > 0;
+        // Cut after the last newline; a line longer than the buffer grows it.
+        char *last = NULL;
+        for (char *p = c->in + c->in_len; p > c->in + scanned; p--) {
+            if (p[-1] == '\n') {
+                last = p;
+                break;
+            }
+        }
+        if (last) {
+            size_t tail = (size_t)(c->in + c->in_len - last);
+            if (!grow_buffer(&r->carry, &r->carry_cap, tail + 1))
+                return -1;
+            memcpy(r->carry, last, tail);
+            r->carry_len = tail;
+            c->in_len -= tail;
+            c->data_len = c->in_len;
+            return 1;
         }
+        scanned = c->in_len;
+        if (c->in_len + 1 >= c->in_cap &&
+            !grow_buffer(&c->in, &c->in_cap, c->in_cap * 2))
+            return -1;
     }
-    return binary;
 }
 
 /**
- * Part 2.1
- * @brief Converts a signed decimal value into its one's complement binary representation.
- * @param input The decimal value to convert.
- * @param numbits The number of bits for the representation.
- * @return The binary string (allocated on the heap).
+ * @brief Frees the result caches of a converting thread, adding up their counters.
+ * @param spec The conversion settings.
+ * @param caches The caches, or NULL.
+ * @param hits Incremented by the caches' hits, unless NULL.
+ * @param misses Incremented by the caches' misses, unless NULL.
  */
-char *signed_decimal_to_ones_complement(long input, unsigned int numbits)
+static void batch_caches_free(const struct batch_spec *spec, struct numconv_cache **caches, unsigned long *hits,
+                              unsigned long *misses)
 {
-    char *binary;
-    if (input >= 0) {
-        binary = unsigned_decimal_to_binary((unsigned long)input, numbits);
-    } else {
-        binary = unsigned_decimal_to_binary((unsigned long)(-input), numbits);
-        if (!binary) return NULL;
-        // Flip each bit.
-        for (unsigned int i = 0; i < numbits; i++){
-            binary[i] = (binary[i] == '0') ? '1' : '0';
+    if (caches == NULL)
+        return;
+    for (unsigned int i = 0; i < (spec->ncolumns ? spec->ncolumns : 1); i++) {
+        if (caches[i] && hits) {
+            unsigned long h, m;
+            numconv_cache_counts(caches[i], &h, &m);
+            *hits += h;
+            *misses += m;
         }
+        numconv_cache_free(caches[i]);
     }
-    return binary;
+    free(caches);
 }
 
-/**
- * Part 2.1
- * @brief Converts a signed decimal value into its two's complement binary representation.
- * @param input The decimal value to convert.
- * @param numbits The number of bits for the representation.
- * @return The binary string (allocated on the heap).
+/*
+ * The result caches of one converting thread: one for whole lines, or one
+ * per converted column, since a cache only serves a single context. NULL if
+ * the run has none.
  */
-char *signed_decimal_to_twos_complement(long input, unsigned int numbits)
+static struct numconv_cache **batch_caches_new(const struct batch_spec *spec)
 {
-    if (input >= 0) {
-        return unsigned_decimal_to_binary((unsigned long)input, numbits);
-    } else {
-        // Two's complement: add 2^n to the negative number.
-        unsigned long rep = (1UL << numbits) + input;
-        return unsigned_decimal_to_binary(rep, numbits);
+    if (spec->cache_entries == 0)
+        return NULL;
+    unsigned int n = spec->ncolumns ? spec->ncolumns : 1;
+    struct numconv_cache **caches = calloc(n, sizeof(*caches));
+    bool ok = caches != NULL;
+    for (unsigned int i = 0; ok && i < n; i++)
+        ok = (caches[i] = numconv_cache_new(spec->cache_entries)) != NULL;
+    if (!ok) {
+        fprintf(stderr, "pa2: cannot allocate the result cache; continuing without it\n");
+        batch_caches_free(spec, caches, NULL, NULL);
+        return NULL;
+    }
+    return caches;
+}
+
+static void batch_chunk_free(const struct batch_spec *spec, struct batch_chunk *c)
+{
+    free(c->in);
+    numconv_batch_free(&c->result);
+    for (unsigned int k = 0; c->columns && k < spec->ncolumns; k++) {
+        free(c->columns[k].values);
+        numconv_batch_free(&c->columns[k].result);
     }
+    free(c->columns);
+    free(c->fields);
 }
 
 /**
- * Part 3.1
- * @brief Converts an IEEE754 binary string into its decimal value.
- * @param input The IEEE754 binary string.
- * @param exp The number of exponent bits.
- * @param mantissa The number of mantissa bits.
- * @return The decimal value.
+ * @brief Finds the first delimiter or newline at or after p.
+ *
+ * Looks at 16 bytes at a time with SSE2 on x86-64, and 8 at a time with
+ * SWAR on other little-endian hosts; no load goes past end.
+ *
+ * @return The separator, or end if there is none.
  */
-double ieee754_to_decimal(char *input, int exp, int mantissa)
+static const char *batch_next_separator(const char *p, const char *end, char delim)
 {
-    int total_bits = 1 + exp + mantissa;
-    if ((int)strlen(input) != total_bits) {
-        return NAN;
+#if defined(__x86_64__)
+    const __m128i d = _mm_set1_epi8(delim), nl = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)p);
+        unsigned int m = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(c, d), _mm_cmpeq_epi8(c, nl)));
+        if (m)
+            return p + __builtin_ctz(m);
+        p += 16;
     }
-    int sign = (input[0] == '1') ? -1 : 1;
-    
-    // Convert exponent bits.
-    unsigned int exponent = 0;
-    for (int i = 1; i <= exp; i++){
-        exponent = (exponent << 1) | (input[i] - '0');
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const uint64_t ones = 0x0101010101010101ULL, highs = 0x8080808080808080ULL;
+    while (end - p >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        // The lowest byte equal to either separator sets the lowest high bit.
+        uint64_t a = w ^ (ones * (unsigned char)delim), b = w ^ (ones * '\n');
+        uint64_t m = (((a - ones) & ~a) | ((b - ones) & ~b)) & highs;
+        if (m)
+            return p + __builtin_ctzll(m) / 8;
+        p += 8;
     }
-    int bias = (1 << (exp - 1)) - 1;
-    
-    // Convert mantissa bits to fraction.
-    double fraction = 0.0;
-    for (int i = 0; i < mantissa; i++){
-        if (input[1 + exp + i] == '1') {
-            fraction += 1.0 / (1 << (i + 1));
+#endif
+    while (p < end && *p != delim && *p != '\n')
+        p++;
+    return p;
+}
+
+/* Appends a field and a newline to a column's values. */
+static inline bool batch_column_add(struct batch_column_values *col, const char *field, size_t n)
+{
+    if (col->len + n + 1 > col->cap && !grow_buffer(&col->values, &col->cap, col->len + n + 1))
+        return false;
+    memcpy(col->values + col->len, field, n);
+    col->len += n;
+    col->values[col->len++] = '\n';
+    return true;
+}
+
+/**
+ * @brief Converts the chosen columns of a chunk of delimited rows.
+ *
+ * Every row is split once; fields after the last converted column are not
+ * split at all. A row too short to reach a converted column has that field
+ * converted as empty (so it fails and is reported) but nothing is inserted.
+ *
+ * @return false if memory ran out.
+ */
+static bool batch_convert_columns(const struct batch_spec *spec, struct batch_chunk *c, struct numconv_cache **caches)
+{
+    const unsigned int ncols = spec->ncolumns;
+    const size_t stride = 2 * (size_t)ncols + 1;
+    const char *data = c->data, *end = data + c->data_len;
+    if (c->columns == NULL && (c->columns = calloc(ncols, sizeof(*c->columns))) == NULL)
+        return false;
+    for (unsigned int k = 0; k < ncols; k++)
+        c->columns[k].len = 0;
+
+    size_t rows = 0;
+    for (const char *p = data; p < end; rows++) {
+        if ((rows + 1) * stride > c->fields_cap) {
+            size_t cap = c->fields_cap ? 2 * c->fields_cap : 1024 * stride;
+            size_t *grown = realloc(c->fields, cap * sizeof(*grown));
+            if (grown == NULL)
+                return false;
+            c->fields = grown;
+            c->fields_cap = cap;
+        }
+        size_t *f = c->fields + rows * stride;
+        unsigned int field = 0, k = 0;
+        const char *sep;
+        for (;;) {
+            sep = batch_next_separator(p, end, spec->delim);
+            if (k < ncols && spec->columns[k].field == field) {
+                const char *stop = sep;
+                if ((sep == end || *sep == '\n') && stop > p && stop[-1] == '\r')
+                    stop--;
+                f[2 * k] = (size_t)(p - data);
+                f[2 * k + 1] = (size_t)(stop - data);
+                if (!batch_column_add(&c->columns[k], p, (size_t)(stop - p)))
+                    return false;
+                k++;
+            }
+            if (sep == end || *sep == '\n')
+                break;
+            field++;
+            p = sep + 1;
+            if (k == ncols) {
+                // The rest of the row passes through untouched.
+                sep = memchr(p, '\n', (size_t)(end - p));
+                if (sep == NULL)
+                    sep = end;
+                break;
+            }
         }
+        for (; k < ncols; k++) {
+            f[2 * k] = f[2 * k + 1] = SIZE_MAX;
+            if (!batch_column_add(&c->columns[k], "", 0))
+                return false;
+        }
+        p = sep == end ? end : sep + 1;
+        f[stride - 1] = (size_t)(p - data);
     }
-    
-    // Special cases: All exponent bits 1.
-    if (exponent == ((1U << exp) - 1)) {
-        if (fraction != 0.0) {
-            return NAN;
-        } else {
-            return sign * INFINITY;
+
+    size_t need = c->data_len;
+    for (unsigned int k = 0; k < ncols; k++) {
+        struct batch_column_values *col = &c->columns[k];
+        if (!numconv_convert_batch(spec->columns[k].conv, caches ? caches[k] : NULL, col->values, col->len,
+                                   &col->result))
+            return false;
+        col->cursor = 0;
+        need += col->result.out_len;
+    }
+
+    // Rebuild the rows: untouched bytes from the input, converted fields from their columns.
+    if (!grow_buffer(&c->result.out, &c->result.out_cap, need))
+        return false;
+    char *o = c->result.out;
+    size_t pos = 0;
+    for (size_t row = 0; row < rows; row++) {
+        const size_t *f = c->fields + row * stride;
+        for (unsigned int k = 0; k < ncols; k++) {
+            struct batch_column_values *col = &c->columns[k];
+            const char *r = col->result.out + col->cursor;
+            size_t n = (size_t)((const char *)memchr(r, '\n', col->result.out_len - col->cursor) - r);
+            col->cursor += n + 1;
+            if (f[2 * k] == SIZE_MAX)
+                continue;
+            memcpy(o, data + pos, f[2 * k] - pos);
+            o += f[2 * k] - pos;
+            memcpy(o, r, n);
+            o += n;
+            pos = f[2 * k + 1];
         }
+        memcpy(o, data + pos, f[stride - 1] - pos);
+        o += f[stride - 1] - pos;
+        pos = f[stride - 1];
     }
-    
-    double significand;
-    int E;
-    if (exponent == 0) {
-        significand = fraction;
-        E = 1 - bias;
-    } else {
-        significand = 1.0 + fraction;
-        E = exponent - bias;
+    c->result.out_len = (size_t)(o - c->result.out);
+    c->result.nerrors = 0;
+    c->result.count = rows;
+    return true;
+}
+
+/* Converts a chunk with the converting thread's result caches, if it has any. */
+static void batch_convert_chunk(const struct batch_spec *spec, struct batch_chunk *c, struct numconv_cache **caches)
+{
+    if (spec->columns)
+        c->failed = !batch_convert_columns(spec, c, caches);
+    else
+        c->failed = !numconv_convert_batch(spec->conv, caches ? caches[0] : NULL, c->data, c->data_len, &c->result);
+}
+
+/* What a batch run reports back besides its output. */
+struct batch_totals {
+    unsigned long failures;     // lines that failed to convert
+    unsigned long values;       // lines or elements converted, failed ones included
+    unsigned long first_failure;    // line number of the first failure, 0 if none
+    unsigned long flagged[NUMCONV_STATUS_BITS];     // values raising each NUMCONV_* flag, when checked
+    unsigned long cache_hits;
+    unsigned long cache_misses;
+};
+
+/* Work queue shared by the batch worker threads. */
+struct batch_pool {
+    const struct batch_spec *spec;
+    struct batch_chunk *ring;
+    size_t nslots;
+    unsigned long published;    // chunks handed to the workers so far
+    unsigned long taken;        // chunks claimed by a worker so far
+    unsigned long cache_hits;   // summed from the workers' caches as they exit
+    unsigned long cache_misses;
+    bool shutdown;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+};
+
+static void *batch_worker(void *arg)
+{
+    struct batch_pool *pool = arg;
+    struct numconv_cache **caches = batch_caches_new(pool->spec);
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->taken == pool->published)
+            pthread_cond_wait(&pool->work, &pool->lock);
+        if (pool->taken == pool->published)
+            break;
+        struct batch_chunk *c = &pool->ring[pool->taken++ % pool->nslots];
+        c->state = CHUNK_BUSY;
+        pthread_mutex_unlock(&pool->lock);
+
+        batch_convert_chunk(pool->spec, c, caches);
+
+        pthread_mutex_lock(&pool->lock);
+        c->state = CHUNK_DONE;
+        pthread_cond_broadcast(&pool->done);
     }
-    
-    return sign * ldexp(significand, E);
+    batch_caches_free(pool->spec, caches, &pool->cache_hits, &pool->cache_misses);
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/* Adds a batch's failures and flag counts to the totals; the first failure is its first error. */
+static void batch_count(struct batch_totals *totals, const struct numconv_batch *r, unsigned long first_line)
+{
+    if (r->nerrors && (totals->first_failure == 0 || first_line + r->errors[0].index < totals->first_failure))
+        totals->first_failure = first_line + r->errors[0].index;
+    totals->failures += r->nerrors;
+    for (int k = 0; k < NUMCONV_STATUS_BITS; k++)
+        totals->flagged[k] += r->flagged[k];
 }
 
 /**
- * Part 3.2
- * @brief Converts a decimal value into its IEEE754 binary representation.
- * @param input The decimal number.
- * @param exp_bits The number of exponent bits.
- * @param mantissa_bits The number of mantissa bits.
- * @param rounding_mode Rounding mode (ROUNDUP, ROUNDDOWN, or ROUNDTOEVEN).
- * @return The IEEE754 binary string (allocated on the heap).
+ * @brief Writes a converted chunk and reports its failed lines, one by one or into the totals.
+ * @param spec The conversion settings.
+ * @param c The converted chunk.
+ * @param first_line The 1-based input line number of the chunk's first line.
+ * @param totals Counts the chunk's values and failures.
+ * @return 0 on success, -1 if the chunk could not be converted.
  */
-char *decimal_to_ieee754_binary(double input, int exp_bits, int mantissa_bits, int rounding_mode)
+static int batch_write_chunk(const struct batch_spec *spec, const struct batch_chunk *c, unsigned long first_line,
+                             struct batch_totals *totals)
 {
-    int total_bits = 1 + exp_bits + mantissa_bits;
-    char *result = malloc(total_bits + 1);
-    if (!result) return NULL;
-    result[total_bits] = '\0';
-    
-    int sign_bit = (input < 0) ? 1 : 0;
-    result[0] = sign_bit ? '1' : '0';
-    
-    if (isnan(input)) {
-        for (int i = 1; i <= exp_bits; i++) result[i] = '1';
-        result[1 + exp_bits] = '1'; // Set a nonzero mantissa.
-        for (int i = 1 + exp_bits + 1; i < total_bits; i++) result[i] = '0';
-        return result;
+    if (c->failed) {
+        errno = ENOMEM;
+        return -1;
     }
-    if (isinf(input)) {
-        for (int i = 1; i <= exp_bits; i++) result[i] = '1';
-        for (int i = 1 + exp_bits; i < total_bits; i++) result[i] = '0';
-        return result;
-    }
-    if (input == 0.0) {
-        for (int i = 1; i < total_bits; i++) result[i] = '0';
-        return result;
+    const struct numconv_batch *r = &c->result;
+    fwrite(r->out, 1, r->out_len, stdout);
+    totals->values += r->count;
+    if (spec->summary) {
+        // No message per line: a file full of bad records costs no more than a clean one.
+        for (unsigned int k = 0; k < spec->ncolumns; k++)
+            batch_count(totals, &c->columns[k].result, first_line);
+        batch_count(totals, r, first_line);
+        return 0;
     }
-    
-    double abs_val = fabs(input);
-    int bias = (1 << (exp_bits - 1)) - 1;
-    int extra = 3;  // Number of extra bits (guard, round, sticky)
-    int total_fraction_bits = mantissa_bits + extra;
-    double eps = 0.0;  // Using 0 to avoid unintended rounding shifts
-    
-    // Denormalized numbers: if the absolute value is too small to be normalized.
-    if (abs_val < pow(2, 1 - bias)) {
-        for (int i = 1; i <= exp_bits; i++) {
-            result[i] = '0';
-        }
-        double fraction_denorm = abs_val / pow(2, 1 - bias);
-        double scaled = fraction_denorm * (double)(1UL << total_fraction_bits) + eps;
-        unsigned long full = (unsigned long)floor(scaled);
-        
-        unsigned long mantissa_candidate = full >> extra;
-        unsigned long extra_bits_val = full & ((1UL << extra) - 1);
-        
-        int round = 0;
-        if (rounding_mode == ROUNDUP) {
-            if (extra_bits_val > 0)
-                round = 1;
-        } else if (rounding_mode == ROUNDDOWN) {
-            round = 0;
-        } else if (rounding_mode == ROUNDTOEVEN) {
-            int guard = (extra_bits_val >> (extra - 1)) & 1;
-            int round_bit = (extra > 1) ? ((extra_bits_val >> (extra - 2)) & 1) : 0;
-            int sticky = (extra > 2) ? ((extra_bits_val & ((1UL << (extra - 2)) - 1)) ? 1 : 0) : 0;
-            if (guard == 0)
-                round = 0;
-            else {
-                if (round_bit == 1 || sticky == 1)
-                    round = 1;
-                else { // exactly halfway
-                    if (mantissa_candidate & 1UL)
-                        round = 1;
-                    else
-                        round = 0;
+    if (spec->columns) {
+        // Merge the columns' failures into row order.
+        for (unsigned int k = 0; k < spec->ncolumns; k++)
+            c->columns[k].cursor = 0;
+        for (;;) {
+            const struct numconv_error *e = NULL;
+            unsigned int from = 0;
+            for (unsigned int k = 0; k < spec->ncolumns; k++) {
+                const struct batch_column_values *col = &c->columns[k];
+                if (col->cursor < col->result.nerrors &&
+                    (e == NULL || col->result.errors[col->cursor].index < e->index)) {
+                    e = &col->result.errors[col->cursor];
+                    from = k;
                 }
             }
+            if (e == NULL)
+                break;
+            fprintf(stderr, "pa2: line %lu, column %u: %s\n", first_line + e->index, spec->columns[from].field + 1,
+                    e->message);
+            c->columns[from].cursor++;
+            totals->failures++;
         }
-        if (round)
-            mantissa_candidate++;
-        // In denormalized numbers, we simply truncate to mantissa_bits.
-        for (int i = 0; i < mantissa_bits; i++) {
-            int bit = (mantissa_candidate >> (mantissa_bits - 1 - i)) & 1;
-            result[1 + exp_bits + i] = bit ? '1' : '0';
-        }
-        return result;
     }
-    
-    // Normalized numbers.
-    int E = 0;
-    double normalized = abs_val;
-    if (normalized >= 2.0) {
-        while (normalized >= 2.0) {
-            normalized /= 2.0;
-            E++;
-        }
-    } else if (normalized < 1.0) {
-        while (normalized < 1.0) {
-            normalized *= 2.0;
-            E--;
-        }
+    for (size_t i = 0; i < r->nerrors; i++) {
+        fprintf(stderr, "pa2: %s %lu: %s\n", spec->in_bytes ? "element" : "line",
+                first_line + r->errors[i].index, r->errors[i].message);
     }
-    
-    int exp_field = E + bias;
-    // Check for exponent overflow (set to infinity).
-    if (exp_field >= (1 << exp_bits) - 1) {
-        for (int i = 1; i <= exp_bits; i++) result[i] = '1';
-        for (int i = 1 + exp_bits; i < total_bits; i++) result[i] = '0';
-        return result;
+    totals->failures += r->nerrors;
+    return 0;
+}
+
+/**
+ * @brief Converts a whole input stream, spreading chunks over a pool of worker threads.
+ * @param spec The conversion settings.
+ * @param in The input stream, used when map is NULL.
+ * @param map A memory-mapped input file, or NULL.
+ * @param map_len Size of the mapping in bytes.
+ * @param nthreads Number of worker threads; 1 converts on the calling thread.
+ * @param totals Receives the number of lines that failed to convert and the result cache counters.
+ * @return 0 on success, -1 on read or allocation errors.
+ */
+static int batch_run(const struct batch_spec *spec, FILE *in, const char *map, size_t map_len,
+                     unsigned int nthreads, struct batch_totals *totals)
+{
+    struct batch_reader reader = { .in = in, .map = map, .map_len = map_len, .record = spec->in_bytes };
+    if (!in && !map)
+        return 0;
+    unsigned long next_line = 1;
+    int status = 0;
+    memset(totals, 0, sizeof(*totals));
+
+    if (spec->header) {
+        // The header line is written back as it is; line numbers still count it.
+        if (map) {
+            const char *nl = memchr(map, '\n', map_len);
+            reader.map_pos = nl ? (size_t)(nl - map) + 1 : map_len;
+            fwrite(map, 1, reader.map_pos, stdout);
+        } else {
+            char *line = NULL;
+            size_t cap = 0;
+            ssize_t n = getline(&line, &cap, in);
+            if (n > 0)
+                fwrite(line, 1, (size_t)n, stdout);
+            free(line);
+            if (n < 0 && ferror(in))
+                return -1;
+        }
+        next_line = 2;
     }
-    
-    double fraction = normalized - 1.0;
-    double X = fraction * (double)(1UL << total_fraction_bits) + eps;
-    unsigned long full = (unsigned long)floor(X);
-    unsigned long mantissa_candidate = full >> extra;
-    unsigned long extra_bits_val = full & ((1UL << extra) - 1);
-    
-    int round = 0;
-    if (rounding_mode == ROUNDUP) {
-        if (extra_bits_val > 0)
-            round = 1;
-    } else if (rounding_mode == ROUNDDOWN) {
-        round = 0;
-    } else if (rounding_mode == ROUNDTOEVEN) {
-        int guard = (extra_bits_val >> (extra - 1)) & 1;
-        int round_bit = (extra > 1) ? ((extra_bits_val >> (extra - 2)) & 1) : 0;
-        int sticky = (extra > 2) ? ((extra_bits_val & ((1UL << (extra - 2)) - 1)) ? 1 : 0) : 0;
-        if (guard == 0)
-            round = 0;
-        else {
-            if (round_bit == 1 || sticky == 1)
-                round = 1;
-            else { // exactly halfway
-                if (mantissa_candidate & 1UL)
-                    round = 1;
-                else
-                    round = 0;
+
+    if (nthreads <= 1) {
+        struct batch_chunk c = { 0 };
+        struct numconv_cache **caches = batch_caches_new(spec);
+        int got;
+        while ((got = batch_read_chunk(&reader, &c)) > 0) {
+            batch_convert_chunk(spec, &c, caches);
+            if (batch_write_chunk(spec, &c, next_line, totals) != 0) {
+                got = -1;
+                break;
             }
+            next_line += c.result.count;
         }
+        status = got < 0 ? -1 : 0;
+        batch_caches_free(spec, caches, &totals->cache_hits, &totals->cache_misses);
+        batch_chunk_free(spec, &c);
+        free(reader.carry);
+        return status;
     }
-    if (round) {
-        mantissa_candidate++;
-        if (mantissa_candidate >= (1UL << mantissa_bits)) {
-            // Rounding overflow: reset mantissa and increment exponent.
-            mantissa_candidate = 0;
-            exp_field++;
-            if (exp_field >= (1 << exp_bits) - 1) {
-                // Exponent overflow: represent infinity.
-                for (int i = 1; i <= exp_bits; i++) result[i] = '1';
-                for (int i = 1 + exp_bits; i < total_bits; i++) result[i] = '0';
-                return result;
+
+    // Two chunks per worker keep every thread busy while the main thread reads and writes.
+    struct batch_pool pool = { .spec = spec, .nslots = 2 * (size_t)nthreads };
+    pool.ring = calloc(pool.nslots, sizeof(*pool.ring));
+    pthread_t *threads = calloc(nthreads, sizeof(*threads));
+    if (!pool.ring || !threads) {
+        free(pool.ring);
+        free(threads);
+        return -1;
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.work, NULL);
+    pthread_cond_init(&pool.done, NULL);
+    unsigned int started = 0;
+    while (started < nthreads && pthread_create(&threads[started], NULL, batch_worker, &pool) == 0)
+        started++;
+    if (started == 0)
+        status = -1;
+
+    unsigned long next_read = 0, next_write = 0;
+    bool eof = false;
+    while (status == 0) {
+        // Keep the ring full, then write the oldest chunk once its worker is done.
+        while (!eof && next_read - next_write < pool.nslots) {
+            struct batch_chunk *c = &pool.ring[next_read % pool.nslots];
+            int got = batch_read_chunk(&reader, c);
+            if (got <= 0) {
+                eof = true;
+                if (got < 0)
+                    status = -1;
+                break;
             }
+            pthread_mutex_lock(&pool.lock);
+            c->state = CHUNK_READY;
+            pool.published++;
+            pthread_cond_signal(&pool.work);
+            pthread_mutex_unlock(&pool.lock);
+            next_read++;
         }
+        if (next_write == next_read)
+            break;
+        struct batch_chunk *c = &pool.ring[next_write % pool.nslots];
+        pthread_mutex_lock(&pool.lock);
+        while (c->state != CHUNK_DONE)
+            pthread_cond_wait(&pool.done, &pool.lock);
+        pthread_mutex_unlock(&pool.lock);
+        if (batch_write_chunk(spec, c, next_line, totals) != 0)
+            status = -1;
+        next_line += c->result.count;
+        c->state = CHUNK_EMPTY;
+        next_write++;
     }
-    
-    // Convert exponent field to binary.
-    for (int i = 0; i < exp_bits; i++) {
-        int bit = (exp_field >> (exp_bits - 1 - i)) & 1;
-        result[1 + i] = bit ? '1' : '0';
+
+    // Let the workers finish anything still queued, then stop them.
+    pthread_mutex_lock(&pool.lock);
+    pool.shutdown = true;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+    for (unsigned int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    totals->cache_hits = pool.cache_hits;
+    totals->cache_misses = pool.cache_misses;
+    for (size_t i = 0; i < pool.nslots; i++)
+        batch_chunk_free(spec, &pool.ring[i]);
+    pthread_cond_destroy(&pool.done);
+    pthread_cond_destroy(&pool.work);
+    pthread_mutex_destroy(&pool.lock);
+    free(pool.ring);
+    free(threads);
+    free(reader.carry);
+    return status;
+}
+
+/**
+ * @brief Maps a whole input file read-only for sequential scanning.
+ * @param path The file to map.
+ * @param len Receives the file size.
+ * @return The mapping (NULL for an empty file), or MAP_FAILED with errno set.
+ */
+static char *map_input_file(const char *path, size_t *len)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return MAP_FAILED;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return MAP_FAILED;
     }
-    
-    // Convert the mantissa to binary.
-    for (int i = 0; i < mantissa_bits; i++) {
-        int bit = (mantissa_candidate >> (mantissa_bits - 1 - i)) & 1;
-        result[1 + exp_bits + i] = bit ? '1' : '0';
+    *len = (size_t)st.st_size;
+    if (*len == 0) {
+        close(fd);
+        return NULL;
     }
-    
-    return result;
+    char *map = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map != MAP_FAILED)
+        madvise(map, *len, MADV_SEQUENTIAL);
+    return map;
+}
+
+static void batch_columns_free(struct batch_column *columns, unsigned int ncolumns)
+{
+    for (unsigned int k = 0; k < ncolumns; k++)
+        numconv_free(columns[k].conv);
+}
+
+/**
+ * @brief Builds the converted columns of a -C run, ordered by field number.
+ * @param args The -C specs (see parse_column_spec()).
+ * @param n Number of specs.
+ * @param columns Receives the columns.
+ * @return false, after reporting the problem, if a spec is invalid or names a column twice.
+ */
+static bool batch_columns_parse(const char *const *args, unsigned int n, struct batch_column *columns)
+{
+    for (unsigned int i = 0; i < n; i++) {
+        const char *error;
+        unsigned int field;
+        struct numconv *conv = parse_column_spec(args[i], &field, &error);
+        if (conv == NULL) {
+            fprintf(stderr, "pa2: column '%s': %s\n", args[i], error);
+            batch_columns_free(columns, i);
+            return false;
+        }
+        // Insertion sort: there are few columns.
+        unsigned int k = i;
+        while (k > 0 && columns[k - 1].field > field) {
+            columns[k] = columns[k - 1];
+            k--;
+        }
+        columns[k] = (struct batch_column){ field, conv };
+        if (k > 0 && columns[k - 1].field == field) {
+            fprintf(stderr, "pa2: column %u is given twice\n", field + 1);
+            batch_columns_free(columns, i + 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void batch_usage(FILE *out)
+{
+    fprintf(out,
+        "usage: pa2                                   (interactive menus)\n"
+        "       pa2 -i SYSTEM -o SYSTEM [-b BITS] [-r MODE] [-F FORMAT] [-Q FORMAT] [-j THREADS] [-m]\n"
+        "           [-T TABLES] [-v] [-I FORMAT] [-O text|packed] [-c ENTRIES] [-S CHECKS]\n"
+        "           [-E lines|summary] [FILE]\n"
+        "       pa2 -C COLUMN=IN,OUT[,BITS[,MODE[,FORMAT]]] ... [-d DELIM] [-H] [-j THREADS] [-m]\n"
+        "           [-T TABLES] [-v] [-c ENTRIES] [-S CHECKS] [-E lines|summary] [FILE]\n"
+        "       pa2 --bench [-f text|csv|json] [-n RUNS] [-t MS] [-k FILTER] [-T TABLES]\n"
+        "       pa2 --selftest [-j THREADS] [-n SAMPLES] [-s SEED] [-x] [-k FILTER]\n"
+        "       pa2 --serve [-s PATH | -p PORT] [-j THREADS] [-c ENTRIES] [-T TABLES]\n"
+        "       pa2 --load [-s PATH | -p PORT] -i SYSTEM -o SYSTEM [-b BITS] [-r MODE] [-F FORMAT]\n"
+        "           [-n LINES] [-d DEPTH] [-R PASSES] [-w] [FILE]\n"
+        "\n"
+        "Batch mode reads one number per line from FILE (or stdin when FILE is\n"
+        "omitted or '-') and writes one converted result per line to stdout.\n"
+        "Lines that cannot be converted produce \"error\" and a message on stderr.\n"
+        "Values out of range saturate, fractions are truncated and floats are\n"
+        "rounded without complaint unless -S makes them fail too.\n"
+        "\n"
+        "With -C, lines are rows of delimited fields (CSV, or TSV with -d tab) and\n"
+        "only the given columns are converted, each its own way; every other byte\n"
+        "of a row is written back unchanged. Fields are not quoted.\n"
+        "\n"
+        "A leading --stats[=text|json] before any of these records the calls, errors,\n"
+        "allocations and latency of every conversion by input system, output system\n"
+        "and width, and prints them on stderr at exit and whenever SIGUSR1 arrives.\n"
+        "\n"
+        "--serve keeps a conversion server running on a Unix domain socket or a\n"
+        "localhost TCP port, and --load drives one with pipelined batches and\n"
+        "reports its throughput and latency; see pa2 --serve -h and pa2 --load -h.\n"
+        "\n"
+        "  -i SYSTEM  input system: 1-7 or unsigned, signmag, ones, twos, ieee754, decimal,\n"
+        "             fixed\n"
+        "  -o SYSTEM  output system: 1-7 or unsigned, signmag, ones, twos, ieee754, decimal,\n"
+        "             fixed\n"
+        "             Binary systems take an optional :RADIX for their digits, 2-36 or\n"
+        "             bin, oct, hex (e.g. twos:hex); n digits hold the widest pattern\n"
+        "             they can write, and ieee754 and fixed input must fit its format\n"
+        "  -b BITS    width of integer output, any number of bits (required for\n"
+        "             decimal input; defaults to the input width for binary input)\n"
+        "  -r MODE    IEEE754 and fixed-point rounding mode: up (away from zero), down\n"
+        "             (toward zero) or even (to nearest, ties to even; the default)\n"
+        "  -F FORMAT  IEEE754 format of input and output, or IN:OUT for each: binary16,\n"
+        "             bfloat16, binary32 (the default), binary64, e4m3 (FP8 without\n"
+        "             infinities), e5m2, or eXmY for X exponent and Y mantissa bits\n"
+        "  -Q FORMAT  fixed-point format of input and output, or IN:OUT for each: Qm.n\n"
+        "             (1 sign, m integer and n fraction bits), Qn for Q0.n (Q15, the\n"
+        "             default, and Q31), or UQm.n without the sign bit; values out of\n"
+        "             range saturate\n"
+        "  -j THREADS number of conversion threads (default: one per online CPU)\n"
+        "  -m         memory-map FILE and convert lines in place instead of reading it\n"
+        "  -T TABLES  lookup tables for small values: none, 8 or 16 (default 8;\n"
+        "             16 uses 1.5 MiB)\n"
+        "  -v         report the lookup table memory, and the result cache hits and\n"
+        "             misses, on stderr\n"
+        "  -I FORMAT  packed little-endian input instead of lines: int8, int16, int32,\n"
+        "             int64 (read in the -i system, as the size of the -Q format for\n"
+        "             fixed) or float16, float32, float64 (read as binary16/32/64, or\n"
+        "             as any -F input format of that size)\n"
+        "  -O FORMAT  text (one result per line, the default) or packed: each result's\n"
+        "             bits as a little-endian integer of (BITS + 7) / 8 bytes, or of\n"
+        "             the -F or -Q output format's size for ieee754 and fixed; failed\n"
+        "             elements are written as zeros\n"
+        "  -c ENTRIES remember the results of up to ENTRIES distinct lines in each\n"
+        "             thread (256 bytes each, default 0: no cache), so repeated\n"
+        "             values are converted once\n"
+        "  -C SPEC    convert a column of delimited rows: COLUMN=IN,OUT[,BITS[,MODE[,FORMAT]]]\n"
+        "             with COLUMN from 1, IN and OUT as for -i and -o, and the optional\n"
+        "             fields as for -b, -r and -F (empty ones keep their defaults, as\n"
+        "             in 3=decimal,ieee754,,down); repeat for each column\n"
+        "  -d DELIM   field delimiter for -C: one character, or tab (default ',')\n"
+        "  -H         write the first line (a header row) back unchanged\n"
+        "  -S CHECKS  also fail values that lose information: a comma-separated list\n"
+        "             of overflow (out of the output's range), truncated (a fraction\n"
+        "             dropped for integer output), inexact (rounded), or all\n"
+        "  -E REPORT  lines (the default) reports each failed line on stderr; summary\n"
+        "             prints one line at the end with the number of failures, the\n"
+        "             first one, and how many values were invalid, overflowed, were\n"
+        "             truncated or were inexact\n"
+        "  -h         show this help\n");
 }
 
+/**
+ * @brief Runs the non-interactive batch mode: one value per input line, one result per output line.
+ * @param argc Argument count from main().
+ * @param argv Argument vector from main().
+ * @return 0 if every line converted, 1 if some lines failed, 2 on usage or I/O errors.
+ */
+int run_batch(int argc, char **argv)
+{
+    int inputSystem = 0, outputSystem = 0;
+    unsigned int in_radix = 2, out_radix = 2;
+    int rounding_mode = ROUNDTOEVEN;
+    unsigned int numbits = 0;
+    long nthreads = 0;
+    bool use_mmap = false;
+    bool verbose = false;
+    int table_bits = 8;
+    unsigned int in_bytes = 0;
+    bool in_float = false, packed_out = false;
+    struct numconv_ieee754_format in_format = numconv_binary32, out_format = numconv_binary32;
+    struct numconv_fixed_format in_fixed = numconv_q15, out_fixed = numconv_q15;
+    bool have_format = false;
+    unsigned long cache_entries = 0;
+    const char *column_args[BATCH_MAX_COLUMNS];
+    struct batch_column columns[BATCH_MAX_COLUMNS];
+    unsigned int ncolumns = 0;
+    char delim = ',';
+    bool header = false;
+    bool checked = false, summary = false;
+    unsigned int fail = 0;
+    const char *error;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:o:b:r:j:mT:vI:O:F:Q:c:C:d:HS:E:h")) != -1) {
+        switch (opt) {
+            case 'i':
+                inputSystem = parse_system(optarg, &in_radix);
+                if (!inputSystem) {
+                    fprintf(stderr, "pa2: unknown input system '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'o':
+                outputSystem = parse_system(optarg, &out_radix);
+                if (!outputSystem) {
+                    fprintf(stderr, "pa2: unknown output system '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'b':
+                numbits = parse_bits(optarg);
+                if (numbits < 1) {
+                    fprintf(stderr, "pa2: invalid number of bits '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'r':
+                rounding_mode = parse_rounding(optarg);
+                if (rounding_mode < 0) {
+                    fprintf(stderr, "pa2: unknown rounding mode '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'j':
+                nthreads = atol(optarg);
+                if (nthreads < 1) {
+                    fprintf(stderr, "pa2: invalid number of threads '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'm':
+                use_mmap = true;
+                break;
+            case 'T':
+                table_bits = parse_table_bits(optarg);
+                if (table_bits < 0) {
+                    fprintf(stderr, "pa2: unknown table width '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            case 'I':
+                in_bytes = parse_packed_format(optarg, &in_float);
+                if (!in_bytes) {
+                    fprintf(stderr, "pa2: unknown packed input format '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'O':
+                if (strcasecmp(optarg, "packed") == 0) {
+                    packed_out = true;
+                } else if (strcasecmp(optarg, "text") == 0) {
+                    packed_out = false;
+                } else {
+                    fprintf(stderr, "pa2: unknown output format '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'F':
+                if (!parse_format_pair(optarg, &in_format, &out_format)) {
+                    fprintf(stderr, "pa2: unknown IEEE754 format '%s'\n", optarg);
+                    return 2;
+                }
+                have_format = true;
+                break;
+            case 'Q':
+                if (!parse_fixed_pair(optarg, &in_fixed, &out_fixed)) {
+                    fprintf(stderr, "pa2: unknown fixed-point format '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'c': {
+                char *end;
+                errno = 0;
+                cache_entries = strtoul(optarg, &end, 10);
+                if (errno || end == optarg || *end || optarg[0] == '-') {
+                    fprintf(stderr, "pa2: invalid cache size '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            }
+            case 'C':
+                if (ncolumns == BATCH_MAX_COLUMNS) {
+                    fprintf(stderr, "pa2: at most %d columns can be converted\n", BATCH_MAX_COLUMNS);
+                    return 2;
+                }
+                column_args[ncolumns++] = optarg;
+                break;
+            case 'd':
+                if (strcasecmp(optarg, "tab") == 0 || strcmp(optarg, "\\t") == 0) {
+                    delim = '\t';
+                } else if (optarg[0] && !optarg[1] && optarg[0] != '\n' && optarg[0] != '\r') {
+                    delim = optarg[0];
+                } else {
+                    fprintf(stderr, "pa2: invalid delimiter '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'H':
+                header = true;
+                break;
+            case 'S':
+                if (!parse_status_flags(optarg, &fail)) {
+                    fprintf(stderr, "pa2: unknown checks '%s'\n", optarg);
+                    return 2;
+                }
+                checked = true;
+                break;
+            case 'E':
+                if (strcasecmp(optarg, "summary") == 0) {
+                    summary = true;
+                } else if (strcasecmp(optarg, "lines") == 0) {
+                    summary = false;
+                } else {
+                    fprintf(stderr, "pa2: unknown error report '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'h':
+                batch_usage(stdout);
+                return 0;
+            default:
+                batch_usage(stderr);
+                return 2;
+        }
+    }
+    if (in_float && !inputSystem)
+        inputSystem = SYS_IEEE754;
+    if (ncolumns && (inputSystem || outputSystem || in_bytes || packed_out)) {
+        fprintf(stderr, "pa2: -C converts columns of text rows in place of -i, -o, -I and -O\n");
+        return 2;
+    }
+    if ((!ncolumns && (!inputSystem || !outputSystem)) || optind + 1 < argc) {
+        batch_usage(stderr);
+        return 2;
+    }
+    if (in_bytes && (in_float != (inputSystem == SYS_IEEE754) || inputSystem == SYS_DECIMAL)) {
+        fprintf(stderr, "pa2: packed int input needs an integer system, float input -i ieee754\n");
+        return 2;
+    }
+    // Packed floats are binary16/32/64 unless -F names another format of that size.
+    if (in_float && !have_format)
+        parse_ieee754_format(in_bytes == 2 ? "binary16" : in_bytes == 4 ? "binary32" : "binary64", &in_format);
+    if (in_float && (unsigned int)(1 + in_format.exp_bits + in_format.mantissa_bits + 7) / 8 != in_bytes) {
+        fprintf(stderr, "pa2: packed %u-byte floats cannot hold the %s input format\n", in_bytes, in_format.name);
+        return 2;
+    }
+    // A summary counts the flags of every value, so it checks them too.
+    checked |= summary;
+    struct numconv *conv = NULL;
+    if (ncolumns) {
+        if (!batch_columns_parse(column_args, ncolumns, columns))
+            return 2;
+        for (unsigned int k = 0; k < ncolumns; k++)
+            numconv_set_checked(columns[k].conv, checked, fail);
+    } else {
+        conv = numconv_new(inputSystem, outputSystem);
+        if (conv == NULL) {
+            perror("pa2");
+            return 2;
+        }
+        numconv_set_radix(conv, in_radix, out_radix);
+        numconv_set_width(conv, numbits);
+        numconv_set_rounding(conv, rounding_mode);
+        numconv_set_formats(conv, &in_format, &out_format);
+        numconv_set_fixed(conv, &in_fixed, &out_fixed);
+        numconv_set_packed(conv, in_bytes, packed_out);
+        numconv_set_checked(conv, checked, fail);
+        if (!numconv_check(conv, &error)) {
+            fprintf(stderr, "pa2: %s\n", error);
+            numconv_free(conv);
+            return 2;
+        }
+    }
+
+    if (!lookup_tables_init((unsigned int)table_bits))
+        fprintf(stderr, "pa2: cannot allocate the lookup tables; continuing without them\n");
+    if (verbose)
+        fprintf(stderr, "pa2: lookup tables: %u-bit, %zu bytes\n", lookup_tables_bits(), lookup_tables_size());
+
+    FILE *in = stdin;
+    const char *path = (optind < argc) ? argv[optind] : "-";
+    char *map = NULL;
+    size_t map_len = 0;
+    if (use_mmap) {
+        if (strcmp(path, "-") == 0) {
+            fprintf(stderr, "pa2: -m needs an input file\n");
+            numconv_free(conv);
+            batch_columns_free(columns, ncolumns);
+            return 2;
+        }
+        map = map_input_file(path, &map_len);
+        if (map == MAP_FAILED) {
+            perror(path);
+            numconv_free(conv);
+            batch_columns_free(columns, ncolumns);
+            return 2;
+        }
+        in = NULL;
+    } else if (strcmp(path, "-") != 0) {
+        in = fopen(path, "r");
+        if (!in) {
+            perror(path);
+            numconv_free(conv);
+            batch_columns_free(columns, ncolumns);
+            return 2;
+        }
+    }
+    static char outbuf[1 << 20];
+    setvbuf(stdout, outbuf, _IOFBF, sizeof(outbuf));
+    if (nthreads == 0) {
+        nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (nthreads < 1)
+            nthreads = 1;
+    }
+
+    struct batch_spec spec = {
+        .conv = conv,
+        .in_bytes = in_bytes,
+        .cache_entries = cache_entries,
+        .columns = ncolumns ? columns : NULL,
+        .ncolumns = ncolumns,
+        .delim = delim,
+        .header = header,
+        .summary = summary,
+    };
+    struct batch_totals totals;
+    int status = batch_run(&spec, in, map, map_len, (unsigned int)nthreads, &totals);
+    if (status != 0)
+        perror("pa2");
+    numconv_free(conv);
+    batch_columns_free(columns, ncolumns);
+    if (verbose && cache_entries)
+        fprintf(stderr, "pa2: result cache: %lu hits, %lu misses\n", totals.cache_hits, totals.cache_misses);
+    if (summary) {
+        const char *unit = in_bytes ? "element" : "line";
+        fprintf(stderr, "pa2: %lu %ss, %lu failed", totals.values, unit, totals.failures);
+        if (totals.failures)
+            fprintf(stderr, " (first at %s %lu)", unit, totals.first_failure);
+        fprintf(stderr, "; %lu invalid, %lu overflowed, %lu truncated, %lu inexact\n",
+                totals.flagged[0], totals.flagged[1], totals.flagged[2], totals.flagged[3]);
+    }
+    if (map && map_len)
+        munmap(map, map_len);
+    if (in && in != stdin)
+        fclose(in);
+    if (fflush(stdout) != 0) {
+        perror("pa2: write");
+        return 2;
+    }
+    if (status != 0)
+        return 2;
+    return totals.failures ? 1 : 0;
+}
+
+/*
+ * Benchmarks.
+ *
+ * "pa2 --bench" times each of the ten conversion functions over a pool of
+ * pseudo-random inputs per case. Every case gets one untimed warmup run and
+ * then several timed runs; the iteration count is calibrated so that a run
+ * lasts at least the minimum run time. Results are reported per case as the
+ * median (and best) ns/op, ops/s and bytes/s, where bytes are the binary
+ * digits read by a decoder or written by an encoder.
+ */
+#define BENCH_POOL 1024
+
+enum bench_function {
+    BENCH_BINARY_TO_UNSIGNED,
+    BENCH_BINARY_TO_SIGNED_MAGNITUDE,
+    BENCH_BINARY_TO_ONES,
+    BENCH_BINARY_TO_TWOS,
+    BENCH_IEEE754_TO_DECIMAL,
+    BENCH_UNSIGNED_TO_BINARY,
+    BENCH_SIGNED_MAGNITUDE_TO_BINARY,
+    BENCH_ONES_TO_BINARY,
+    BENCH_TWOS_TO_BINARY,
+    BENCH_DECIMAL_TO_IEEE754,
+};
+
+static const char *const bench_function_names[] = {
+    "binary_to_unsigned_decimal",
+    "binary_to_signed_magnitude_decimal",
+    "binary_to_ones_complement_decimal",
+    "binary_to_twos_complement_decimal",
+    "ieee754_to_decimal",
+    "unsigned_decimal_to_binary",
+    "signed_decimal_to_signed_magnitude",
+    "signed_decimal_to_ones_complement",
+    "signed_decimal_to_twos_complement",
+    "decimal_to_ieee754_binary",
+};
+
+/* Kinds of floating-point input a case draws from. */
+enum bench_class { BENCH_NORMAL, BENCH_SUBNORMAL, BENCH_SPECIAL };
+
+static const char *const bench_class_names[] = { "normal", "subnormal", "nan-inf" };
+static const char *const bench_rounding_names[] = { "up", "down", "even" };
+
+struct bench_case {
+    enum bench_function function;
+    unsigned int width;         // integer width, or total IEEE754 bits
+    int exp_bits, mantissa_bits;
+    enum bench_class class;
+    int rounding_mode;
+};
+
+/* Inputs for one case, generated once before timing. */
+struct bench_inputs {
+    char digits[BENCH_POOL][65];
+    long values[BENCH_POOL];
+    double doubles[BENCH_POOL];
+};
+
+struct bench_result {
+    double ns_median, ns_min;
+    unsigned long iterations;
+};
+
+static uint64_t bench_rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t bench_random(void)
+{
+    // xorshift64*: cheap and reproducible across runs.
+    bench_rng_state ^= bench_rng_state >> 12;
+    bench_rng_state ^= bench_rng_state << 25;
+    bench_rng_state ^= bench_rng_state >> 27;
+    return bench_rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief Draws a double of the requested class that lands in the case's IEEE754 format.
+ */
+static double bench_random_double(const struct bench_case *bc)
+{
+    long bias = (1L << (bc->exp_bits - 1)) - 1;
+    double frac = (double)(bench_random() >> 11) / 9007199254740992.0;
+    switch (bc->class) {
+        case BENCH_SUBNORMAL:
+            return ldexp(frac, (int)(1 - bias)) * ((bench_random() & 1) ? -1 : 1);
+        case BENCH_SPECIAL: {
+            static const double specials[] = { INFINITY, -INFINITY, NAN };
+            return specials[bench_random() % 3];
+        }
+        default: {
+            int span = (int)(2 * bias);
+            int e = (int)(bench_random() % (unsigned)span) - (int)bias + 1;
+            return ldexp(1.0 + frac, e) * ((bench_random() & 1) ? -1 : 1);
+        }
+    }
+}
+
+static void bench_prepare(const struct bench_case *bc, struct bench_inputs *in)
+{
+    for (int i = 0; i < BENCH_POOL; i++) {
+        unsigned long raw = bench_random();
+        if (bc->width < 64)
+            raw &= (1UL << bc->width) - 1;
+        switch (bc->function) {
+            case BENCH_IEEE754_TO_DECIMAL:
+                emit_binary_digits(ieee754_encode_bits(bench_random_double(bc), bc->exp_bits,
+                                                       bc->mantissa_bits, ROUNDTOEVEN),
+                                   bc->width, false, in->digits[i]);
+                in->digits[i][bc->width] = '\0';
+                break;
+            case BENCH_DECIMAL_TO_IEEE754:
+                in->doubles[i] = bench_random_double(bc);
+                break;
+            case BENCH_UNSIGNED_TO_BINARY:
+                in->values[i] = (long)raw;
+                break;
+            case BENCH_SIGNED_MAGNITUDE_TO_BINARY:
+            case BENCH_ONES_TO_BINARY:
+            case BENCH_TWOS_TO_BINARY:
+                // Values that fit the width, half of them negative.
+                in->values[i] = (long)(raw >> 1) * ((raw & 1) ? -1 : 1);
+                break;
+            default:
+                emit_binary_digits(raw, bc->width, false, in->digits[i]);
+                in->digits[i][bc->width] = '\0';
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Runs a case for a number of iterations.
+ * @return A value derived from every result, so the calls cannot be optimized away.
+ */
+static unsigned long bench_run_case(const struct bench_case *bc, const struct bench_inputs *in,
+                                    unsigned long iterations)
+{
+    unsigned long sink = 0;
+    char *str;
+    for (unsigned long it = 0; it < iterations; it++) {
+        unsigned int i = (unsigned int)(it % BENCH_POOL);
+        switch (bc->function) {
+            case BENCH_BINARY_TO_UNSIGNED:
+                sink += binary_to_unsigned_decimal(in->digits[i]);
+                break;
+            case BENCH_BINARY_TO_SIGNED_MAGNITUDE:
+                sink += (unsigned long)binary_to_signed_magnitude_decimal(in->digits[i]);
+                break;
+            case BENCH_BINARY_TO_ONES:
+                sink += (unsigned long)binary_to_ones_complement_decimal(in->digits[i]);
+                break;
+            case BENCH_BINARY_TO_TWOS:
+                sink += (unsigned long)binary_to_twos_complement_decimal(in->digits[i]);
+                break;
+            case BENCH_IEEE754_TO_DECIMAL: {
+                double d = ieee754_to_decimal((char *)in->digits[i], bc->exp_bits, bc->mantissa_bits);
+                sink += (unsigned long)isnan(d) + (d > 0);
+                break;
+            }
+            case BENCH_UNSIGNED_TO_BINARY:
+                str = unsigned_decimal_to_binary((unsigned long)in->values[i], bc->width);
+                sink += (unsigned char)str[0];
+                free(str);
+                break;
+            case BENCH_SIGNED_MAGNITUDE_TO_BINARY:
+                str = signed_decimal_to_signed_magnitude(in->values[i], bc->width);
+                sink += (unsigned char)str[0];
+                free(str);
+                break;
+            case BENCH_ONES_TO_BINARY:
+                str = signed_decimal_to_ones_complement(in->values[i], bc->width);
+                sink += (unsigned char)str[0];
+                free(str);
+                break;
+            case BENCH_TWOS_TO_BINARY:
+                str = signed_decimal_to_twos_complement(in->values[i], bc->width);
+                sink += (unsigned char)str[0];
+                free(str);
+                break;
+            case BENCH_DECIMAL_TO_IEEE754:
+                str = decimal_to_ieee754_binary(in->doubles[i], bc->exp_bits, bc->mantissa_bits,
+                                                bc->rounding_mode);
+                sink += (unsigned char)str[bc->width - 1];
+                free(str);
+                break;
+        }
+    }
+    return sink;
+}
+
+static int bench_compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Times one case: a warmup run, calibration, then repeated timed runs.
+ */
+static void bench_measure(const struct bench_case *bc, const struct bench_inputs *in,
+                          int runs, double min_run_ns, struct bench_result *res)
+{
+    static volatile unsigned long sink;
+    unsigned long iterations = BENCH_POOL;
+    sink += bench_run_case(bc, in, iterations);
+    for (;;) {
+        double t0 = bench_now();
+        sink += bench_run_case(bc, in, iterations);
+        double elapsed = bench_now() - t0;
+        if (elapsed >= min_run_ns || iterations >= (1UL << 40))
+            break;
+        iterations *= 2;
+    }
+    double samples[64];
+    for (int r = 0; r < runs; r++) {
+        double t0 = bench_now();
+        sink += bench_run_case(bc, in, iterations);
+        samples[r] = (bench_now() - t0) / (double)iterations;
+    }
+    qsort(samples, (size_t)runs, sizeof(samples[0]), bench_compare_doubles);
+    res->ns_median = (runs % 2) ? samples[runs / 2] : (samples[runs / 2 - 1] + samples[runs / 2]) / 2;
+    res->ns_min = samples[0];
+    res->iterations = iterations;
+}
+
+/**
+ * @brief Lists every benchmark case.
+ * @param cases Array receiving the cases, or NULL to only count them.
+ * @return The number of cases.
+ */
+static size_t bench_cases(struct bench_case *cases)
+{
+    static const unsigned int int_widths[] = { 8, 16, 32, 64 };
+    static const int formats[][2] = { { 5, 10 }, { 8, 23 }, { 11, 52 } };
+    size_t n = 0;
+    for (int f = BENCH_BINARY_TO_UNSIGNED; f <= BENCH_TWOS_TO_BINARY; f++) {
+        if (f == BENCH_IEEE754_TO_DECIMAL)
+            continue;
+        for (int w = 0; w < 4; w++, n++) {
+            if (cases)
+                cases[n] = (struct bench_case){ .function = f, .width = int_widths[w] };
+        }
+    }
+    for (int fmt = 0; fmt < 3; fmt++) {
+        for (int cls = BENCH_NORMAL; cls <= BENCH_SPECIAL; cls++) {
+            struct bench_case bc = {
+                .function = BENCH_IEEE754_TO_DECIMAL,
+                .exp_bits = formats[fmt][0],
+                .mantissa_bits = formats[fmt][1],
+                .width = 1 + formats[fmt][0] + formats[fmt][1],
+                .class = cls,
+                .rounding_mode = ROUNDTOEVEN,
+            };
+            if (cases)
+                cases[n] = bc;
+            n++;
+            bc.function = BENCH_DECIMAL_TO_IEEE754;
+            for (int mode = ROUNDUP; mode <= ROUNDTOEVEN; mode++, n++) {
+                bc.rounding_mode = mode;
+                if (cases)
+                    cases[n] = bc;
+            }
+        }
+    }
+    return n;
+}
+
+static void bench_case_name(const struct bench_case *bc, char *buf, size_t len)
+{
+    if (bc->function == BENCH_IEEE754_TO_DECIMAL)
+        snprintf(buf, len, "%s/binary%u/%s", bench_function_names[bc->function], bc->width,
+                 bench_class_names[bc->class]);
+    else if (bc->function == BENCH_DECIMAL_TO_IEEE754)
+        snprintf(buf, len, "%s/binary%u/%s/%s", bench_function_names[bc->function], bc->width,
+                 bench_class_names[bc->class], bench_rounding_names[bc->rounding_mode]);
+    else
+        snprintf(buf, len, "%s/%u", bench_function_names[bc->function], bc->width);
+}
+
+static void bench_usage(FILE *out)
+{
+    fprintf(out,
+        "usage: pa2 --bench [-f text|csv|json] [-n RUNS] [-t MS] [-k FILTER] [-T TABLES]\n"
+        "\n"
+        "  -f FORMAT  output format (default text)\n"
+        "  -n RUNS    timed runs per case, after one warmup run (default 5, max 64)\n"
+        "  -t MS      minimum duration of each timed run in milliseconds (default 20)\n"
+        "  -k FILTER  only run cases whose name contains FILTER\n"
+        "  -T TABLES  lookup tables for small values: none, 8 or 16 (default 8)\n");
+}
+
+/**
+ * @brief Runs the benchmark suite ("pa2 --bench ...").
+ * @param argc Argument count, starting at "--bench".
+ * @param argv Argument vector, starting at "--bench".
+ * @return 0 on success, 2 on usage errors.
+ */
+int run_bench(int argc, char **argv)
+{
+    const char *format = "text";
+    const char *filter = NULL;
+    int runs = 5;
+    double min_run_ms = 20;
+    int table_bits = 8;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:n:t:k:T:h")) != -1) {
+        switch (opt) {
+            case 'f':
+                format = optarg;
+                break;
+            case 'n':
+                runs = atoi(optarg);
+                break;
+            case 't':
+                min_run_ms = atof(optarg);
+                break;
+            case 'k':
+                filter = optarg;
+                break;
+            case 'T':
+                table_bits = parse_table_bits(optarg);
+                break;
+            case 'h':
+                bench_usage(stdout);
+                return 0;
+            default:
+                bench_usage(stderr);
+                return 2;
+        }
+    }
+    if (runs < 1 || runs > 64 || min_run_ms <= 0 || table_bits < 0 ||
+        (strcmp(format, "text") && strcmp(format, "csv") && strcmp(format, "json"))) {
+        bench_usage(stderr);
+        return 2;
+    }
+
+    size_t ncases = bench_cases(NULL);
+    struct bench_case *cases = malloc(ncases * sizeof(*cases));
+    struct bench_inputs *inputs = malloc(sizeof(*inputs));
+    if (!cases || !inputs) {
+        free(cases);
+        free(inputs);
+        perror("pa2");
+        return 2;
+    }
+    bench_cases(cases);
+    if (!lookup_tables_init((unsigned int)table_bits))
+        fprintf(stderr, "pa2: cannot allocate the lookup tables; continuing without them\n");
+
+    if (strcmp(format, "csv") == 0)
+        printf("name,function,width,class,rounding,runs,iterations,ns_per_op,ns_per_op_min,ops_per_sec,bytes_per_sec\n");
+    else if (strcmp(format, "json") == 0)
+        printf("{\n  \"runs\": %d,\n  \"min_run_ms\": %g,\n  \"table_bits\": %u,\n  \"table_bytes\": %zu,\n"
+               "  \"benchmarks\": [", runs, min_run_ms, lookup_tables_bits(), lookup_tables_size());
+    else
+        printf("# lookup tables: %u-bit, %zu bytes\n%-58s %10s %10s %14s %12s\n", lookup_tables_bits(),
+               lookup_tables_size(), "case", "ns/op", "best", "ops/s", "MB/s");
+
+    bool first = true;
+    for (size_t i = 0; i < ncases; i++) {
+        const struct bench_case *bc = &cases[i];
+        char name[96];
+        bench_case_name(bc, name, sizeof(name));
+        if (filter && !strstr(name, filter))
+            continue;
+        struct bench_result res;
+        bench_prepare(bc, inputs);
+        bench_measure(bc, inputs, runs, min_run_ms * 1e6, &res);
+        double ops = 1e9 / res.ns_median;
+        double bytes = ops * bc->width;
+        const char *rounding = (bc->function == BENCH_DECIMAL_TO_IEEE754)
+                               ? bench_rounding_names[bc->rounding_mode] : "";
+        const char *cls = (bc->function == BENCH_IEEE754_TO_DECIMAL || bc->function == BENCH_DECIMAL_TO_IEEE754)
+                          ? bench_class_names[bc->class] : "";
+        if (strcmp(format, "csv") == 0) {
+            printf("%s,%s,%u,%s,%s,%d,%lu,%.3f,%.3f,%.0f,%.0f\n", name, bench_function_names[bc->function],
+                   bc->width, cls, rounding, runs, res.iterations, res.ns_median, res.ns_min, ops, bytes);
+        } else if (strcmp(format, "json") == 0) {
+            printf("%s\n    {\"name\": \"%s\", \"function\": \"%s\", \"width\": %u, \"class\": \"%s\", "
+                   "\"rounding\": \"%s\", \"iterations\": %lu, \"ns_per_op\": %.3f, \"ns_per_op_min\": %.3f, "
+                   "\"ops_per_sec\": %.0f, \"bytes_per_sec\": %.0f}",
+                   first ? "" : ",", name, bench_function_names[bc->function], bc->width, cls, rounding,
+                   res.iterations, res.ns_median, res.ns_min, ops, bytes);
+        } else {
+            printf("%-58s %10.2f %10.2f %14.0f %12.1f\n", name, res.ns_median, res.ns_min, ops, bytes / 1e6);
+        }
+        first = false;
+        fflush(stdout);
+    }
+    if (strcmp(format, "json") == 0)
+        printf("\n  ]\n}\n");
+    free(cases);
+    free(inputs);
+    return 0;
+}
+
+/*
+ * Self-test.
+ *
+ * "pa2 --selftest" checks the decoders and encoders against results worked
+ * out without them: integer patterns against plain sign-and-magnitude
+ * arithmetic, IEEE754 patterns against bit casts to float and double (or,
+ * for formats the hardware lacks, a widening of the fields into a binary64
+ * pattern), rounding against the hardware's double-to-float conversion, and
+ * decimal text against strtod(). Every pattern goes through the string
+ * converters, the packed decoders and encoders, convert_number() in both
+ * directions through decimal text and, for floats, the bulk converters.
+ * Patterns of up to 16 bits are checked exhaustively; wider ones are
+ * sampled, mixing in the edge patterns, unless -x asks for the full 32-bit
+ * sweeps. Samples are a function of the seed and their index only, so a
+ * failure reproduces with any number of threads.
+ */
+#define SELFTEST_BATCH 1024
+#define SELFTEST_MAX_REPORTS 10     // failures printed per case
+
+struct selftest_case {
+    char name[24];
+    int system;                     // SYS_UNSIGNED .. SYS_IEEE754
+    unsigned int width;             // total bits of a pattern
+    struct numconv_ieee754_format format;   // for SYS_IEEE754
+    bool exhaustive;
+};
+
+struct selftest_run {
+    const struct selftest_case *tc;
+    uint64_t count;                 // patterns to check
+    uint64_t seed;
+    unsigned int nthreads;
+    unsigned long failures;
+    pthread_mutex_t lock;           // guards failures and the reports on stderr
+};
+
+struct selftest_worker {
+    struct selftest_run *run;
+    unsigned int index;
+};
+
+static const char *const selftest_system_names[] = { "", "unsigned", "signmag", "ones", "twos" };
+static const struct numconv_ieee754_format selftest_binary64 = { "binary64", 11, 52, false };
+
+/* splitmix64: a well-mixed value for every index, independent of the thread that draws it. */
+static uint64_t selftest_mix(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static void selftest_fail(struct selftest_worker *w, const char *fmt, ...)
+{
+    struct selftest_run *run = w->run;
+    pthread_mutex_lock(&run->lock);
+    if (run->failures++ < SELFTEST_MAX_REPORTS) {
+        va_list ap;
+        va_start(ap, fmt);
+        fprintf(stderr, "pa2: selftest %s: ", run->tc->name);
+        vfprintf(stderr, fmt, ap);
+        fputc('\n', stderr);
+        va_end(ap);
+    }
+    pthread_mutex_unlock(&run->lock);
+}
+
+/**
+ * @brief Draws sample number index of a case: an edge pattern one time in eight, otherwise any pattern.
+ */
+static uint64_t selftest_sample(const struct selftest_case *tc, uint64_t seed, uint64_t index)
+{
+    uint64_t r = selftest_mix(seed ^ selftest_mix(index));
+    uint64_t mask = tc->width == 64 ? UINT64_MAX : (1ULL << tc->width) - 1;
+    uint64_t top = 1ULL << (tc->width - 1);
+    if ((r & 7) != 0)
+        return (r >> 3) & mask;
+    r >>= 3;
+    if (tc->system == SYS_IEEE754) {
+        // Any sign and mantissa with an exponent field of 0, 1, the largest normal or all ones.
+        int m = tc->format.mantissa_bits;
+        uint64_t max_field = (1ULL << tc->format.exp_bits) - 1;
+        static const int pick[4] = { 0, 1, -1, 0 };
+        uint64_t field = (r & 3) == 3 ? max_field : (r & 3) == 2 ? max_field - 1 : (uint64_t)pick[r & 3];
+        uint64_t mantissa = (r >> 8) & ((1ULL << m) - 1);
+        if (r & 4)
+            mantissa = (r & 8) ? (1ULL << m) - 1 : (r & 16) ? 1 : 0;
+        return ((r >> 5) & 1) * top | field << m | mantissa;
+    }
+    const uint64_t edges[] = { 0, 1, 2, mask, mask - 1, top, top + 1, top - 1, top - 2, mask >> 2 };
+    return edges[r % (sizeof(edges) / sizeof(edges[0]))];
+}
+
+/* The value of an integer pattern as a sign and a magnitude (never a negative zero). */
+static void selftest_integer_value(int system, uint64_t p, unsigned int width, bool *negative, uint64_t *magnitude)
+{
+    uint64_t mask = width == 64 ? UINT64_MAX : (1ULL << width) - 1;
+    uint64_t top = 1ULL << (width - 1);
+    *negative = system != SYS_UNSIGNED && (p & top);
+    if (!*negative)
+        *magnitude = p;
+    else if (system == SYS_SIGNED_MAGNITUDE)
+        *magnitude = p & ~top;
+    else if (system == SYS_ONES_COMPLEMENT)
+        *magnitude = ~p & mask;
+    else
+        *magnitude = (~p & mask) + 1;
+    if (*magnitude == 0)
+        *negative = false;
+}
+
+/* The canonical pattern of a signed magnitude in a system, or false if the system cannot hold it. */
+static bool selftest_integer_pattern(int system, bool negative, uint64_t magnitude, unsigned int width,
+                                     uint64_t *p)
+{
+    uint64_t mask = width == 64 ? UINT64_MAX : (1ULL << width) - 1;
+    uint64_t top = 1ULL << (width - 1);
+    if (system == SYS_UNSIGNED) {
+        *p = magnitude;
+        return !negative && magnitude <= mask;
+    }
+    if (magnitude > (negative && system == SYS_TWOS_COMPLEMENT ? top : top - 1))
+        return false;
+    if (!negative)
+        *p = magnitude;
+    else if (system == SYS_SIGNED_MAGNITUDE)
+        *p = top | magnitude;
+    else if (system == SYS_ONES_COMPLEMENT)
+        *p = ~magnitude & mask;
+    else
+        *p = (0 - magnitude) & mask;
+    return true;
+}
+
+static void selftest_check_integers(struct selftest_worker *w, const uint64_t *patterns, size_t n)
+{
+    const struct selftest_case *tc = w->run->tc;
+    const int system = tc->system;
+    const unsigned int width = tc->width;
+    const char *name = selftest_system_names[system];
+    const char *error;
+    char digits[72], text[72], expect[72], buf[160];
+    for (size_t i = 0; i < n; i++) {
+        uint64_t p = patterns[i], canonical, got;
+        bool negative;
+        uint64_t magnitude;
+        selftest_integer_value(system, p, width, &negative, &magnitude);
+        if (!selftest_integer_pattern(system, negative, magnitude, width, &canonical)) {
+            selftest_fail(w, "%s pattern %#llx has no canonical form", name, (unsigned long long)p);
+            continue;
+        }
+        long value = negative ? -(long)(magnitude - 1) - 1 : (long)magnitude;
+        emit_binary_digits(p, width, false, digits);
+        digits[width] = '\0';
+
+        // Decoders: the string ones and the packed one.
+        long decoded;
+        switch (system) {
+            case SYS_UNSIGNED:
+                decoded = (long)binary_to_unsigned_decimal(digits);
+                break;
+            case SYS_SIGNED_MAGNITUDE:
+                decoded = binary_to_signed_magnitude_decimal(digits);
+                break;
+            case SYS_ONES_COMPLEMENT:
+                decoded = binary_to_ones_complement_decimal(digits);
+                break;
+            default:
+                decoded = binary_to_twos_complement_decimal(digits);
+                break;
+        }
+        if (decoded != value)
+            selftest_fail(w, "%s decoder: %s gave %ld, expected %ld", name, digits, decoded, value);
+        decoded = decode_integer_bits(system, p, width, (p >> (width - 1)) & 1);
+        if (decoded != value)
+            selftest_fail(w, "decode_integer_bits: %s gave %ld, expected %ld", digits, decoded, value);
+
+        // Encoders: the value must come back as its canonical pattern.
+        emit_binary_digits(canonical, width, false, expect);
+        expect[width] = '\0';
+        switch (system) {
+            case SYS_UNSIGNED:
+                unsigned_decimal_to_binary_buf(magnitude, width, text, sizeof(text));
+                break;
+            case SYS_SIGNED_MAGNITUDE:
+                signed_decimal_to_signed_magnitude_buf(value, width, text, sizeof(text));
+                break;
+            case SYS_ONES_COMPLEMENT:
+                signed_decimal_to_ones_complement_buf(value, width, text, sizeof(text));
+                break;
+            default:
+                signed_decimal_to_twos_complement_buf(value, width, text, sizeof(text));
+                break;
+        }
+        if (strcmp(text, expect) != 0)
+            selftest_fail(w, "%s encoder: %ld gave %s, expected %s", name, value, text, expect);
+
+        // Every other integer system, packed and as text, wherever it can hold the value.
+        for (int to = SYS_UNSIGNED; to <= SYS_TWOS_COMPLEMENT; to++) {
+            uint64_t target;
+            bool fits = selftest_integer_pattern(to, negative, magnitude, width, &target);
+            if (!fits && !(negative && to == SYS_UNSIGNED))
+                continue;
+            bool ok = convert_bits(p, width, system, to, width, NULL, NULL, ROUNDTOEVEN, &got, &error);
+            if (ok != fits || (fits && got != target))
+                selftest_fail(w, "convert_bits %s to %s: %s gave %s %#llx, expected %#llx", name,
+                              selftest_system_names[to], digits, ok ? "" : "error", (unsigned long long)got,
+                              (unsigned long long)target);
+            char *out = convert_number(digits, width, system, to, width, NULL, NULL, ROUNDTOEVEN, buf,
+                                       sizeof(buf), &error);
+            emit_binary_digits(target, width, false, expect);
+            expect[width] = '\0';
+            if ((out != NULL) != fits || (fits && strcmp(out, expect) != 0))
+                selftest_fail(w, "convert_number %s to %s: %s gave %s, expected %s", name,
+                              selftest_system_names[to], digits, out ? out : error, fits ? expect : "an error");
+        }
+
+        // Decimal text, both ways.
+        snprintf(expect, sizeof(expect), "%s%llu", negative ? "-" : "", (unsigned long long)magnitude);
+        char *out = convert_number(digits, width, system, SYS_DECIMAL, 0, NULL, NULL, ROUNDTOEVEN, buf,
+                                   sizeof(buf), &error);
+        if (out == NULL || strcmp(out, expect) != 0)
+            selftest_fail(w, "%s to decimal: %s gave %s, expected %s", name, digits, out ? out : error, expect);
+        out = convert_number(expect, strlen(expect), SYS_DECIMAL, system, width, NULL, NULL, ROUNDTOEVEN, buf,
+                             sizeof(buf), &error);
+        emit_binary_digits(canonical, width, false, text);
+        text[width] = '\0';
+        if (out == NULL || strcmp(out, text) != 0)
+            selftest_fail(w, "decimal to %s: %s gave %s, expected %s", name, expect, out ? out : error, text);
+
+        // Fixed point: the pattern as a fraction, Q0.(width - 1) or UQ0.width.
+        if ((system == SYS_TWOS_COMPLEMENT || system == SYS_UNSIGNED) && width <= 32) {
+            const struct numconv_fixed_format q = { 0, (int)width - (system != SYS_UNSIGNED), system == SYS_UNSIGNED };
+            double ref = ldexp(negative ? -(double)magnitude : (double)magnitude, -q.frac_bits), back;
+            if (fixed_decode_double(p, &q) != ref)
+                selftest_fail(w, "fixed decode: %s gave %a, expected %a", digits, fixed_decode_double(p, &q), ref);
+            for (int mode = ROUNDUP; mode <= ROUNDTOEVEN; mode++) {
+                got = fixed_encode_double(ref, &q, mode);
+                if (got != canonical)
+                    selftest_fail(w, "fixed encode (%s): %a gave %#llx, expected %#llx", bench_rounding_names[mode],
+                                  ref, (unsigned long long)got, (unsigned long long)canonical);
+            }
+            out = format_fixed_decimal(p, &q, buf, sizeof(buf));
+            if (out == NULL || !parse_decimal(out, strlen(out), &back) || back != ref)
+                selftest_fail(w, "fixed to decimal: %s gave %s, expected %a", digits, out ? out : "nothing", ref);
+        }
+    }
+
+    // The bulk dequantizer against the element-wise decoder.
+    if ((system == SYS_TWOS_COMPLEMENT || system == SYS_UNSIGNED) && width <= 32) {
+        const struct numconv_fixed_format q = { 0, (int)width - (system != SYS_UNSIGNED), system == SYS_UNSIGNED };
+        const struct numconv_ieee754_format binary64 = { "binary64", 11, 52, false };
+        char src[SELFTEST_BATCH * 4], dst[SELFTEST_BATCH * 8];
+        for (size_t i = 0; i < n; i++)
+            store_packed(src + i * (width / 8), patterns[i], width / 8);
+        dequantize_packed(src, n, &q, &numconv_binary32, ROUNDTOEVEN, dst);
+        for (size_t i = 0; i < n; i++) {
+            float want = (float)fixed_decode_double(patterns[i], &q), got;
+            memcpy(&got, dst + 4 * i, sizeof(got));
+            if (memcmp(&got, &want, sizeof(got)) != 0)
+                selftest_fail(w, "bulk fixed to binary32: %#llx gave %a, expected %a",
+                              (unsigned long long)patterns[i], got, want);
+        }
+        dequantize_packed(src, n, &q, &binary64, ROUNDTOEVEN, dst);
+        for (size_t i = 0; i < n; i++) {
+            double want = fixed_decode_double(patterns[i], &q), got;
+            memcpy(&got, dst + 8 * i, sizeof(got));
+            if (memcmp(&got, &want, sizeof(got)) != 0)
+                selftest_fail(w, "bulk fixed to binary64: %#llx gave %a, expected %a",
+                              (unsigned long long)patterns[i], got, want);
+        }
+    }
+}
+
+/*
+ * Non-finite decimal text to an integer system: rejected alike on either
+ * side of 53 bits, where decimal input switches from a double to exact digits.
+ */
+static void selftest_check_nonfinite(struct selftest_worker *w)
+{
+    static const char *const texts[] = { "nan", "inf", "-inf" };
+    static const unsigned int expect[] = { NUMCONV_INVALID, NUMCONV_OVERFLOW, NUMCONV_OVERFLOW };
+    const int system = w->run->tc->system;
+    struct numconv *conv = numconv_new(SYS_DECIMAL, system);
+    char buf[160];
+    const char *error;
+    if (conv == NULL) {
+        selftest_fail(w, "numconv_new: out of memory");
+        return;
+    }
+    numconv_set_checked(conv, true, 0);
+    for (unsigned int numbits = 53; numbits <= 54; numbits++) {
+        numconv_set_width(conv, numbits);
+        for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+            unsigned int status = numconv_convert_status(conv, texts[i], strlen(texts[i]), buf, sizeof(buf), &error);
+            if (status != (expect[i] | NUMCONV_FAILED))
+                selftest_fail(w, "decimal %s to %u-bit %s: status %#x, expected %#x", texts[i], numbits,
+                              selftest_system_names[system], status, expect[i] | NUMCONV_FAILED);
+        }
+    }
+    numconv_free(conv);
+}
+
+/*
+ * Decimal text with more than the 19 significant digits parsing keeps:
+ * exactness comes from all the digits, not from their count.
+ */
+static void selftest_check_long_decimals(struct selftest_worker *w)
+{
+    static const char *const texts[] = {
+        "9.31322574615478515625e-10", "36893488147419103232", "-36893488147419103232",
+        "1.00000000000000000000000000000", "36893488147419103233", "0.10000000000000000000000",
+    };
+    static const unsigned int expect[] = { 0, 0, 0, 0, NUMCONV_INEXACT, NUMCONV_INEXACT };
+    const struct numconv_ieee754_format *f = &w->run->tc->format;
+    struct numconv *conv;
+    char buf[160];
+    const char *error;
+    if (!(f->exp_bits == 8 && f->mantissa_bits == 23) && !(f->exp_bits == 11 && f->mantissa_bits == 52))
+        return;
+    if ((conv = numconv_new(SYS_DECIMAL, SYS_IEEE754)) == NULL) {
+        selftest_fail(w, "numconv_new: out of memory");
+        return;
+    }
+    numconv_set_formats(conv, f, f);
+    numconv_set_checked(conv, true, 0);
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+        unsigned int status = numconv_convert_status(conv, texts[i], strlen(texts[i]), buf, sizeof(buf), &error);
+        if (status != expect[i])
+            selftest_fail(w, "decimal %s to %s: status %#x, expected %#x", texts[i], w->run->tc->name, status,
+                          expect[i]);
+    }
+    numconv_free(conv);
+}
+
+/**
+ * @brief The value of an IEEE754 pattern, from a bit cast where the hardware has the format.
+ *
+ * Other formats are widened field by field into a binary64 pattern, which
+ * holds every value of a format with at most 11 exponent and 52 mantissa bits.
+ */
+static double selftest_float_reference(uint64_t b, const struct numconv_ieee754_format *f)
+{
+    const int e_bits = f->exp_bits, m_bits = f->mantissa_bits;
+    double d;
+    if (e_bits == 8 && m_bits == 23) {
+        uint32_t u = (uint32_t)b;
+        float x;
+        memcpy(&x, &u, sizeof(x));
+        return x;
+    }
+    if (e_bits == 11 && m_bits == 52) {
+        memcpy(&d, &b, sizeof(d));
+        return d;
+    }
+    if (e_bits == 8 && m_bits == 7) {
+        uint32_t u = (uint32_t)b << 16;
+        float x;
+        memcpy(&x, &u, sizeof(x));
+        return x;
+    }
+    uint64_t sign = (b >> (e_bits + m_bits)) & 1, max_field = (1ULL << e_bits) - 1;
+    uint64_t field = (b >> m_bits) & max_field, mantissa = b & ((1ULL << m_bits) - 1);
+    int bias = (1 << (e_bits - 1)) - 1;
+    uint64_t bits = sign << 63;
+    if (field == max_field && f->finite && mantissa == (1ULL << m_bits) - 1)
+        return NAN;
+    if (field == max_field && !f->finite)
+        return mantissa ? NAN : sign ? -INFINITY : INFINITY;
+    if (field == 0 && mantissa != 0) {
+        // Subnormal: the leading one becomes the hidden bit of a normal binary64.
+        int top = 63 - __builtin_clzll(mantissa);
+        bits |= (uint64_t)(top - m_bits + 1 - bias + 1023) << 52 | (mantissa ^ (1ULL << top)) << (52 - top);
+    } else if (field != 0) {
+        bits |= (field - bias + 1023) << 52 | mantissa << (52 - m_bits);
+    }
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static bool selftest_same(double a, double b)
+{
+    return (isnan(a) && isnan(b)) || memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+static void selftest_check_floats(struct selftest_worker *w, const uint64_t *patterns, size_t n)
+{
+    const struct selftest_case *tc = w->run->tc;
+    const struct numconv_ieee754_format *f = &tc->format;
+    const unsigned int width = tc->width;
+    const char *error;
+    char digits[72], text[72], buf[160];
+    for (size_t i = 0; i < n; i++) {
+        uint64_t b = patterns[i];
+        unsigned long got;
+        double ref = selftest_float_reference(b, f);
+        emit_binary_digits(b, width, false, digits);
+        digits[width] = '\0';
+
+        // Decoders.
+        double d = ieee754_decode_format(b, f);
+        if (!selftest_same(d, ref))
+            selftest_fail(w, "decode: %s gave %a, expected %a", digits, d, ref);
+        if (!f->finite) {
+            d = ieee754_to_decimal(digits, f->exp_bits, f->mantissa_bits);
+            if (!selftest_same(d, ref))
+                selftest_fail(w, "ieee754_to_decimal: %s gave %a, expected %a", digits, d, ref);
+        }
+        if (!convert_bits(b, width, SYS_IEEE754, SYS_IEEE754, 0, f, &selftest_binary64, ROUNDTOEVEN, &got,
+                          &error) != isnan(ref) ||
+            (!isnan(ref) && !selftest_same(selftest_float_reference(got, &selftest_binary64), ref)))
+            selftest_fail(w, "convert_bits to binary64: %s gave %#lx", digits, got);
+        if (isnan(ref)) {
+            if (!isnan(ieee754_decode_format(ieee754_encode_format(ref, f, ROUNDTOEVEN), f)))
+                selftest_fail(w, "NaN does not encode as a NaN");
+            continue;
+        }
+
+        // Encoders: an exact value encodes as its own pattern in every rounding mode.
+        for (int mode = ROUNDUP; mode <= ROUNDTOEVEN; mode++) {
+            got = ieee754_encode_format(ref, f, mode);
+            if (got != b)
+                selftest_fail(w, "encode (%s): %a gave %#lx, expected %#llx", bench_rounding_names[mode], ref, got,
+                              (unsigned long long)b);
+            if (!f->finite) {
+                char *s = decimal_to_ieee754_binary(ref, f->exp_bits, f->mantissa_bits, mode);
+                if (s == NULL || strcmp(s, digits) != 0)
+                    selftest_fail(w, "decimal_to_ieee754_binary (%s): %a gave %s, expected %s",
+                                  bench_rounding_names[mode], ref, s ? s : "NULL", digits);
+                free(s);
+            }
+        }
+
+        // Shortest decimal text reads back as the same pattern, and strtod() agrees with the parser.
+        char *out = convert_number(digits, width, SYS_IEEE754, SYS_DECIMAL, 0, f, f, ROUNDTOEVEN, buf,
+                                   sizeof(buf), &error);
+        double parsed = 0, libc = 0;
+        if (out == NULL || !parse_decimal(out, strlen(out), &parsed) ||
+            ieee754_encode_format(parsed, f, ROUNDTOEVEN) != b) {
+            selftest_fail(w, "to decimal: %s gave %s, which does not read back", digits, out ? out : error);
+            continue;
+        }
+        libc = strtod(out, NULL);
+        if (!selftest_same(parsed, libc))
+            selftest_fail(w, "parse_decimal: \"%s\" gave %a, strtod() %a", out, parsed, libc);
+        snprintf(text, sizeof(text), "%s", out);
+        out = convert_number(text, strlen(text), SYS_DECIMAL, SYS_IEEE754, 0, f, f, ROUNDTOEVEN, buf,
+                             sizeof(buf), &error);
+        if (out == NULL || strcmp(out, digits) != 0)
+            selftest_fail(w, "from decimal: %s gave %s, expected %s", text, out ? out : error, digits);
+        if (width == 64) {
+            // All 17 significant digits, for the slow paths of the parser.
+            snprintf(text, sizeof(text), "%.17g", ref);
+            if (!parse_decimal(text, strlen(text), &parsed) || !selftest_same(parsed, ref))
+                selftest_fail(w, "parse_decimal: \"%s\" gave %a, expected %a", text, parsed, ref);
+        }
+
+        // Rounding: perturb the low bits of the binary64 value and compare with the hardware.
+        if (width == 32 && !isinf(ref) && ref != 0) {
+            uint64_t bits;
+            memcpy(&bits, &ref, sizeof(bits));
+            bits ^= selftest_mix(b ^ w->run->seed) & ((1ULL << 29) - 1);
+            memcpy(&d, &bits, sizeof(d));
+            float nearest = (float)d, other = nearest;
+            if ((double)nearest != d)
+                other = nextafterf(nearest, (double)nearest < d ? INFINITY : -INFINITY);
+            float toward = fabsf(nearest) < fabsf(other) ? nearest : other;
+            float away = fabsf(nearest) < fabsf(other) ? other : nearest;
+            const float expect[3] = { [ROUNDUP] = away, [ROUNDDOWN] = toward, [ROUNDTOEVEN] = nearest };
+            for (int mode = ROUNDUP; mode <= ROUNDTOEVEN; mode++) {
+                uint32_t want;
+                memcpy(&want, &expect[mode], sizeof(want));
+                got = ieee754_encode_format(d, f, mode);
+                if (got != want)
+                    selftest_fail(w, "encode (%s): %a gave %#lx, expected %#x", bench_rounding_names[mode], d,
+                                  got, want);
+            }
+        }
+    }
+
+    // Saturation keeps the sign: out-of-range values, infinities and (without infinities) NaN.
+    uint64_t sign = 1ULL << (width - 1);
+    unsigned long top = f->finite ? (unsigned long)sign - 1 : ((1UL << f->exp_bits) - 1) << f->mantissa_bits;
+    const double beyond[] = { ldexp(1.0, 1 << f->exp_bits), INFINITY, NAN };
+    for (size_t i = 0; i < (f->finite ? 3 : 2); i++) {
+        for (int negative = 0; negative <= 1; negative++) {
+            unsigned long want = top | (unsigned long)(negative ? sign : 0);
+            unsigned long got = ieee754_encode_format(negative ? -beyond[i] : beyond[i], f, ROUNDTOEVEN);
+            if (got != want)
+                selftest_fail(w, "encode: %s%a gave %#lx, expected %#lx", negative ? "-" : "", beyond[i], got, want);
+        }
+    }
+
+    // The bulk converters against the element-wise encoder, on the patterns that are not NaN.
+    static const char *const bulk[][2] = {
+        { "binary32", "binary16" }, { "binary32", "bfloat16" }, { "binary32", "e4m3" }, { "binary64", "binary32" },
+    };
+    char src[SELFTEST_BATCH * 8], dst[SELFTEST_BATCH * 4];
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!isnan(selftest_float_reference(patterns[i], f)))
+            store_packed(src + count++ * (width / 8), patterns[i], width / 8);
+    }
+    for (size_t k = 0; k < sizeof(bulk) / sizeof(bulk[0]); k++) {
+        struct numconv_ieee754_format from, to;
+        parse_ieee754_format(bulk[k][0], &from);
+        parse_ieee754_format(bulk[k][1], &to);
+        if (from.exp_bits != f->exp_bits || from.mantissa_bits != f->mantissa_bits)
+            continue;
+        unsigned int to_bytes = (unsigned int)(1 + to.exp_bits + to.mantissa_bits + 7) / 8;
+        size_t done = transcode_packed_floats(src, count, f, &to, ROUNDTOEVEN, dst);
+        if (done != count)
+            selftest_fail(w, "bulk to %s stopped after %zu of %zu", to.name, done, count);
+        for (size_t i = 0; i < done; i++) {
+            uint64_t b = load_packed(src + i * (width / 8), width / 8);
+            unsigned long want = ieee754_encode_format(selftest_float_reference(b, f), &to, ROUNDTOEVEN);
+            unsigned long got = load_packed(dst + i * to_bytes, to_bytes);
+            if (got != want)
+                selftest_fail(w, "bulk to %s: %#llx gave %#lx, expected %#lx", to.name, (unsigned long long)b,
+                              got, want);
+        }
+    }
+
+    // The bulk quantizer against the element-wise encoder, in every rounding mode.
+    static const char *const quantized[] = { "Q7", "Q15", "UQ8.8", "Q11.12", "Q31", "UQ16.15" };
+    for (size_t k = 0; k < sizeof(quantized) / sizeof(quantized[0]); k++) {
+        struct numconv_fixed_format q;
+        parse_fixed_format(quantized[k], &q);
+        unsigned int q_bytes = (fixed_format_bits(&q) + 7) / 8;
+        for (int mode = ROUNDUP; mode <= ROUNDTOEVEN; mode++) {
+            size_t done = quantize_packed_floats(src, count, f, &q, mode, dst);
+            if (done != count)
+                selftest_fail(w, "bulk to %s stopped after %zu of %zu", quantized[k], done, count);
+            for (size_t i = 0; i < done; i++) {
+                uint64_t b = load_packed(src + i * (width / 8), width / 8);
+                unsigned long want = fixed_encode_double(selftest_float_reference(b, f), &q, mode);
+                unsigned long got = load_packed(dst + i * q_bytes, q_bytes);
+                if (got != want)
+                    selftest_fail(w, "bulk to %s (%s): %#llx gave %#lx, expected %#lx", quantized[k],
+                                  bench_rounding_names[mode], (unsigned long long)b, got, want);
+            }
+        }
+    }
+}
+
+static void *selftest_worker(void *arg)
+{
+    struct selftest_worker *w = arg;
+    const struct selftest_run *run = w->run;
+    const struct selftest_case *tc = run->tc;
+    uint64_t patterns[SELFTEST_BATCH];
+    uint64_t begin = run->count / run->nthreads * w->index;
+    uint64_t end = w->index + 1 == run->nthreads ? run->count : begin + run->count / run->nthreads;
+    if (w->index == 0 && tc->system != SYS_IEEE754)
+        selftest_check_nonfinite(w);
+    if (w->index == 0 && tc->system == SYS_IEEE754)
+        selftest_check_long_decimals(w);
+    for (uint64_t i = begin; i < end;) {
+        size_t n = end - i < SELFTEST_BATCH ? (size_t)(end - i) : SELFTEST_BATCH;
+        for (size_t k = 0; k < n; k++)
+            patterns[k] = tc->exhaustive ? i + k : selftest_sample(tc, run->seed, i + k);
+        if (tc->system == SYS_IEEE754)
+            selftest_check_floats(w, patterns, n);
+        else
+            selftest_check_integers(w, patterns, n);
+        i += n;
+    }
+    return NULL;
+}
+
+static size_t selftest_cases(struct selftest_case *cases, bool full)
+{
+    static const unsigned int int_widths[] = { 8, 16, 32, 64 };
+    static const char *const formats[] = { "e4m3", "e5m2", "binary16", "bfloat16", "binary32", "binary64" };
+    size_t n = 0;
+    for (size_t i = 0; i < sizeof(int_widths) / sizeof(int_widths[0]); i++) {
+        for (int system = SYS_UNSIGNED; system <= SYS_TWOS_COMPLEMENT; system++, n++) {
+            if (!cases)
+                continue;
+            struct selftest_case *tc = &cases[n];
+            snprintf(tc->name, sizeof(tc->name), "int%u/%s", int_widths[i], selftest_system_names[system]);
+            tc->system = system;
+            tc->width = int_widths[i];
+            tc->exhaustive = tc->width <= 16 || (full && tc->width <= 32);
+        }
+    }
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++, n++) {
+        if (!cases)
+            continue;
+        struct selftest_case *tc = &cases[n];
+        snprintf(tc->name, sizeof(tc->name), "%s", formats[i]);
+        tc->system = SYS_IEEE754;
+        parse_ieee754_format(formats[i], &tc->format);
+        tc->width = (unsigned int)(1 + tc->format.exp_bits + tc->format.mantissa_bits);
+        tc->exhaustive = tc->width <= 16 || (full && tc->width <= 32);
+    }
+    return n;
+}
+
+static void selftest_usage(FILE *out)
+{
+    fprintf(out,
+        "usage: pa2 --selftest [-j THREADS] [-n SAMPLES] [-s SEED] [-x] [-k FILTER]\n"
+        "\n"
+        "  -j THREADS number of threads (default: one per online CPU)\n"
+        "  -n SAMPLES patterns drawn for each case too wide to check exhaustively\n"
+        "             (default 1048576)\n"
+        "  -s SEED    seed for the samples (default 1)\n"
+        "  -x         also check every 32-bit pattern (binary32 and int32)\n"
+        "  -k FILTER  only run cases whose name contains FILTER\n");
+}
+
+/**
+ * @brief Runs the differential self-test ("pa2 --selftest ...").
+ * @param argc Argument count, starting at "--selftest".
+ * @param argv Argument vector, starting at "--selftest".
+ * @return 0 if every check passed, 1 on failures, 2 on usage errors.
+ */
+int run_selftest(int argc, char **argv)
+{
+    long nthreads = 0;
+    uint64_t samples = 1 << 20, seed = 1;
+    bool full = false;
+    const char *filter = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:n:s:xk:h")) != -1) {
+        switch (opt) {
+            case 'j':
+                nthreads = atol(optarg);
+                break;
+            case 'n':
+                samples = strtoull(optarg, NULL, 10);
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'x':
+                full = true;
+                break;
+            case 'k':
+                filter = optarg;
+                break;
+            case 'h':
+                selftest_usage(stdout);
+                return 0;
+            default:
+                selftest_usage(stderr);
+                return 2;
+        }
+    }
+    if (nthreads < 0 || nthreads > 1024 || samples == 0) {
+        selftest_usage(stderr);
+        return 2;
+    }
+    if (nthreads == 0) {
+        nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (nthreads < 1)
+            nthreads = 1;
+    }
+    lookup_tables_init(8);
+
+    size_t ncases = selftest_cases(NULL, full);
+    struct selftest_case *cases = calloc(ncases, sizeof(*cases));
+    pthread_t *threads = calloc((size_t)nthreads, sizeof(*threads));
+    struct selftest_worker *workers = calloc((size_t)nthreads, sizeof(*workers));
+    if (!cases || !threads || !workers) {
+        free(cases);
+        free(threads);
+        free(workers);
+        perror("pa2");
+        return 2;
+    }
+    selftest_cases(cases, full);
+
+    printf("%-16s %-10s %14s %10s %10s\n", "case", "mode", "patterns", "failures", "seconds");
+    unsigned long total_failures = 0;
+    for (size_t i = 0; i < ncases; i++) {
+        const struct selftest_case *tc = &cases[i];
+        if (filter && !strstr(tc->name, filter))
+            continue;
+        struct selftest_run run = {
+            .tc = tc,
+            .count = tc->exhaustive ? (uint64_t)1 << tc->width : samples,
+            .seed = seed,
+            .nthreads = (unsigned int)nthreads,
+        };
+        pthread_mutex_init(&run.lock, NULL);
+        double start = bench_now();
+        unsigned int started = 0;
+        for (; started < run.nthreads; started++) {
+            workers[started] = (struct selftest_worker){ .run = &run, .index = started };
+            if (pthread_create(&threads[started], NULL, selftest_worker, &workers[started]) != 0)
+                break;
+        }
+        if (started < run.nthreads) {
+            // Run the slices of threads that could not be started here instead.
+            for (unsigned int k = started; k < run.nthreads; k++) {
+                workers[k] = (struct selftest_worker){ .run = &run, .index = k };
+                selftest_worker(&workers[k]);
+            }
+        }
+        for (unsigned int k = 0; k < started; k++)
+            pthread_join(threads[k], NULL);
+        pthread_mutex_destroy(&run.lock);
+        printf("%-16s %-10s %14llu %10lu %10.2f\n", tc->name, tc->exhaustive ? "exhaustive" : "sampled",
+               (unsigned long long)run.count, run.failures, (bench_now() - start) / 1e9);
+        fflush(stdout);
+        total_failures += run.failures;
+    }
+    if (!filter || strstr("server", filter)) {
+        // Request limits of the conversion server, without a socket.
+        double start = bench_now();
+        unsigned long failures = server_selftest();
+        printf("%-16s %-10s %14s %10lu %10.2f\n", "server", "limits", "-", failures, (bench_now() - start) / 1e9);
+        total_failures += failures;
+    }
+    printf("%s: %lu failure%s\n", total_failures ? "FAILED" : "passed", total_failures,
+           total_failures == 1 ? "" : "s");
+    free(cases);
+    free(threads);
+    free(workers);
+    return total_failures ? 1 : 0;
+}
+
+/*
+ * Conversion server.
+ *
+ * "pa2 --serve" keeps one process, its lookup tables, worker threads and
+ * result caches alive between jobs. Clients connect over a Unix domain
+ * socket or localhost TCP and send batches of values framed as below. One
+ * epoll thread reads requests and writes responses for every connection,
+ * and a pool of workers converts the batches with numconv_convert_batch().
+ * A connection can pipeline many batches: they are converted in parallel
+ * and answered in the order they were sent.
+ *
+ * All integers are little-endian. A request is
+ *
+ *     u32 length       bytes after this field: 24 + the payload
+ *     u32 id           echoed in the response
+ *     u8  input system, output system (SYS_UNSIGNED .. SYS_DECIMAL)
+ *     u8  input radix, output radix (0 for 2)
+ *     u8  rounding mode (ROUNDUP, ROUNDDOWN or ROUNDTOEVEN)
+ *     u8  packed input element size, 0 for lines of text
+ *     u8  packed output, 0 or 1
+ *     u8  reserved, 0
+ *     u32 output width, 0 to keep the input width, at most SERVER_MAX_WIDTH
+ *     u8  input format exponent bits, mantissa bits (0, 0 for binary32)
+ *     u8  output format exponent bits, mantissa bits (0, 0 for binary32)
+ *     u8  flags: 1 if the input format has no infinities, 2 if the output format
+ *     u8  reserved, 0, 0, 0
+ *         the payload: lines separated by '\n', or packed elements
+ *
+ * and its response is
+ *
+ *     u32 length       bytes after this field
+ *     u32 id
+ *     u32 status       0, or 1 if the request was rejected and the output is the reason
+ *     u32 values converted
+ *     u32 failures
+ *     u32 output length, then the output, as batch mode writes it
+ *         for each failure: u32 index within the batch, u32 length, the message
+ *
+ * A request whose output could exceed SERVER_MAX_RESPONSE bytes is rejected
+ * before it is converted.
+ */
+#define SERVER_REQUEST_HEADER 24
+#define SERVER_RESPONSE_HEADER 20
+#define SERVER_MAX_REQUEST (64u << 20)     // larger requests close the connection
+#define SERVER_MAX_WIDTH 65536              // widest output a request can ask for
+#define SERVER_MAX_RESPONSE (256u << 20)    // requests whose output could be larger are rejected
+#define SERVER_MAX_IN_FLIGHT 64             // batches of one connection queued or converting
+#define SERVER_MAX_BACKLOG (16u << 20)      // unsent response bytes that stop reading requests
+#define SERVER_READ_SIZE (256u << 10)
+#define SERVER_DEFAULT_SOCKET "pa2.sock"
+
+struct server_conn;
+
+/* One request of a connection, passed from the epoll thread to a worker and back. */
+struct server_job {
+    struct server_conn *conn;
+    unsigned long seq;          // position among the connection's requests
+    char *request;              // the request after its length field
+    size_t request_len;
+    char *response;             // the whole response, or NULL if it could not be allocated
+    size_t response_len;
+    struct server_job *next;
+};
+
+struct server_conn {
+    int fd;                     // -1 once the connection is closed
+    char *in;                   // bytes read but not yet taken as requests
+    size_t in_len, in_cap;
+    char *out;                  // responses not yet sent, from out + out_sent
+    size_t out_len, out_sent, out_cap;
+    unsigned long next_seq;     // sequence number of the next request read
+    unsigned long next_reply;   // sequence number of the next response to send
+    struct server_job *ready;   // converted jobs waiting for earlier ones, by sequence number
+    unsigned int in_flight;     // requests read but not yet answered
+    bool eof;                   // the client sends no more requests
+    uint32_t events;            // what epoll is watching for
+    struct server_conn *prev, *next;
+};
+
+struct server {
+    int epfd;
+    int listen_fd;
+    int wake_fd;                // eventfd the workers signal finished jobs on
+    int signal_fd;              // SIGINT and SIGTERM
+    unsigned long cache_entries;
+    struct server_conn *conns;  // open connections
+    struct server_conn *dead;   // closed connections, freed after each round of events
+    pthread_mutex_t lock;       // guards queue, finished and shutdown
+    pthread_cond_t work;
+    struct server_job *queue, *queue_tail;  // requests waiting for a worker
+    struct server_job *finished;            // converted jobs waiting for the epoll thread
+    bool shutdown;
+};
+
+/**
+ * @brief Builds the context a request header asks for.
+ * @param h The request after its length field.
+ * @param error Set to a message describing the problem when NULL is returned.
+ * @return The context, or NULL if the request cannot be served.
+ */
+static struct numconv *server_context(const unsigned char *h, const char **error)
+{
+    struct numconv_ieee754_format in_format = numconv_binary32, out_format = numconv_binary32;
+    if ((h[16] && !ieee754_format_supported(h[16], h[17])) || (h[18] && !ieee754_format_supported(h[18], h[19]))) {
+        *error = "unsupported IEEE754 format";
+        return NULL;
+    }
+    if (h[16])
+        in_format = (struct numconv_ieee754_format){ "custom", h[16], h[17], (h[20] & 1) != 0 };
+    if (h[18])
+        out_format = (struct numconv_ieee754_format){ "custom", h[18], h[19], (h[20] & 2) != 0 };
+    if (h[4] < SYS_UNSIGNED || h[4] > SYS_DECIMAL || h[5] < SYS_UNSIGNED || h[5] > SYS_DECIMAL) {
+        *error = "unknown input or output system";
+        return NULL;
+    }
+    struct numconv *conv = numconv_new(h[4], h[5]);
+    if (conv == NULL) {
+        *error = "out of memory";
+        return NULL;
+    }
+    if (!numconv_set_radix(conv, h[6] ? h[6] : 2, h[7] ? h[7] : 2)) {
+        *error = "radix must be 2-36";
+    } else if (!numconv_set_rounding(conv, h[8])) {
+        *error = "unknown rounding mode";
+    } else if (load_packed((const char *)h + 12, 4) > SERVER_MAX_WIDTH) {
+        *error = "output width too large";
+    } else {
+        numconv_set_width(conv, (unsigned int)load_packed((const char *)h + 12, 4));
+        numconv_set_formats(conv, &in_format, &out_format);
+        numconv_set_packed(conv, h[9], h[10] != 0);
+        if (numconv_check(conv, error))
+            return conv;
+    }
+    numconv_free(conv);
+    return NULL;
+}
+
+/**
+ * @brief Bounds the output numconv_convert_batch() writes for a payload, as it reserves it.
+ * @return The bound, or SIZE_MAX once it passes SERVER_MAX_RESPONSE.
+ */
+static size_t server_output_bound(const struct numconv *conv, const unsigned char *h, const char *data, size_t len)
+{
+    size_t total = 0;
+    if (h[9]) {
+        size_t count = len / h[9] + 1;
+        size_t per = h[10] ? numconv_packed_size(conv) : numconv_output_size(conv, 8u * h[9]) + sizeof("error\n");
+        return per != 0 && count > SERVER_MAX_RESPONSE / per ? SIZE_MAX : count * per;
+    }
+    for (const char *p = data, *end = data + len; p < end && total <= SERVER_MAX_RESPONSE;) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        size_t n = nl ? (size_t)(nl - p) : (size_t)(end - p), need = numconv_output_size(conv, n);
+        total += (need < sizeof("error") ? sizeof("error") : need) + 1;
+        p += n + 1;
+    }
+    return total > SERVER_MAX_RESPONSE ? SIZE_MAX : total;
+}
+
+/**
+ * @brief Converts one request and builds its response.
+ * @param job The request; its response is left in job->response (NULL when out of memory).
+ * @param cache The worker's result cache, or NULL.
+ * @param batch The worker's reusable batch buffers.
+ */
+static void server_convert(struct server_job *job, struct numconv_cache *cache, struct numconv_batch *batch)
+{
+    const unsigned char *h = (const unsigned char *)job->request;
+    const char *error = NULL;
+    const char *data = job->request + SERVER_REQUEST_HEADER;
+    size_t len = job->request_len - SERVER_REQUEST_HEADER;
+    struct numconv *conv = server_context(h, &error);
+    bool fits = conv && server_output_bound(conv, h, data, len) != SIZE_MAX;
+    bool ok = fits && numconv_convert_batch(conv, cache, data, len, batch);
+    numconv_free(conv);
+    if (conv && !fits)
+        error = "response too large";
+    else if (conv && !ok)
+        error = "out of memory";
+
+    const char *out = ok ? batch->out : error;
+    size_t out_len = ok ? batch->out_len : strlen(error);
+    size_t size = 4 + SERVER_RESPONSE_HEADER + out_len;
+    for (size_t i = 0; ok && i < batch->nerrors; i++)
+        size += 8 + strlen(batch->errors[i].message);
+    char *p = job->response = malloc(size);
+    if (p == NULL)
+        return;
+    job->response_len = size;
+    store_packed(p, size - 4, 4);
+    memcpy(p + 4, h, 4);
+    store_packed(p + 8, !ok, 4);
+    store_packed(p + 12, ok ? batch->count : 0, 4);
+    store_packed(p + 16, ok ? batch->nerrors : 0, 4);
+    store_packed(p + 20, out_len, 4);
+    memcpy(p + 24, out, out_len);
+    p += 24 + out_len;
+    for (size_t i = 0; ok && i < batch->nerrors; i++) {
+        size_t n = strlen(batch->errors[i].message);
+        store_packed(p, batch->errors[i].index, 4);
+        store_packed(p + 4, n, 4);
+        memcpy(p + 8, batch->errors[i].message, n);
+        p += 8 + n;
+    }
+}
+
+/**
+ * @brief Checks the request limits of server_convert() without a socket, for --selftest.
+ * @return The number of failed checks, each reported on stderr.
+ */
+static unsigned long server_selftest(void)
+{
+    static const struct {
+        uint32_t width;
+        unsigned int lines;     // of "1\n"
+        const char *expect;     // the rejection, or NULL for a converted request
+    } checks[] = {
+        { 8, 3, NULL },
+        { SERVER_MAX_WIDTH, 3, NULL },
+        { SERVER_MAX_WIDTH + 1, 3, "output width too large" },
+        { UINT32_MAX, 3, "output width too large" },
+        { SERVER_MAX_WIDTH, SERVER_MAX_RESPONSE / SERVER_MAX_WIDTH + 1, "response too large" },
+    };
+    struct numconv_batch batch = { 0 };
+    unsigned long failures = 0;
+    for (size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+        struct server_job job = { .request_len = SERVER_REQUEST_HEADER + 2 * (size_t)checks[i].lines };
+        unsigned char *h = (unsigned char *)(job.request = calloc(1, job.request_len));
+        if (h == NULL) {
+            perror("pa2");
+            return failures + 1;
+        }
+        store_packed((char *)h, (unsigned long)i, 4);
+        h[4] = SYS_DECIMAL;
+        h[5] = SYS_TWOS_COMPLEMENT;
+        h[8] = ROUNDTOEVEN;
+        store_packed((char *)h + 12, checks[i].width, 4);
+        for (unsigned int k = 0; k < checks[i].lines; k++)
+            memcpy(job.request + SERVER_REQUEST_HEADER + 2 * k, "1\n", 2);
+        server_convert(&job, NULL, &batch);
+        const char *r = job.response, *expect = checks[i].expect;
+        bool rejected = r && load_packed(r + 8, 4) != 0;
+        size_t out_len = r ? load_packed(r + 20, 4) : 0;
+        bool good = r && load_packed(r + 4, 4) == i && rejected == (expect != NULL);
+        if (good && rejected)
+            good = out_len == strlen(expect) && memcmp(r + 24, expect, out_len) == 0;
+        else if (good)
+            good = load_packed(r + 12, 4) == checks[i].lines && out_len == checks[i].lines * (checks[i].width + 1);
+        if (!good) {
+            fprintf(stderr, "pa2: selftest server: width %lu, %u lines: got %s%.*s, expected %s\n",
+                    (unsigned long)checks[i].width, checks[i].lines, rejected ? "" : r ? "a conversion" : "no response",
+                    rejected ? (int)out_len : 0, rejected ? r + 24 : "", expect ? expect : "a conversion");
+            failures++;
+        }
+        free(job.request);
+        free(job.response);
+    }
+    numconv_batch_free(&batch);
+    return failures;
+}
+
+/* Tells the epoll thread that jobs have finished. */
+static void server_wake(struct server *srv)
+{
+    uint64_t one = 1;
+    while (write(srv->wake_fd, &one, sizeof(one)) < 0 && errno == EINTR)
+        ;
+}
+
+static void *server_worker(void *arg)
+{
+    struct server *srv = arg;
+    struct numconv_cache *cache = NULL;
+    struct numconv_batch batch = { 0 };
+    if (srv->cache_entries && (cache = numconv_cache_new(srv->cache_entries)) == NULL)
+        fprintf(stderr, "pa2: cannot allocate the result cache, converting without it\n");
+    pthread_mutex_lock(&srv->lock);
+    for (;;) {
+        while (!srv->shutdown && srv->queue == NULL)
+            pthread_cond_wait(&srv->work, &srv->lock);
+        struct server_job *job = srv->queue;
+        if (job == NULL)
+            break;
+        srv->queue = job->next;
+        if (srv->queue == NULL)
+            srv->queue_tail = NULL;
+        pthread_mutex_unlock(&srv->lock);
+
+        server_convert(job, cache, &batch);
+
+        pthread_mutex_lock(&srv->lock);
+        bool wake = srv->finished == NULL;
+        job->next = srv->finished;
+        srv->finished = job;
+        if (wake)
+            server_wake(srv);
+    }
+    pthread_mutex_unlock(&srv->lock);
+    numconv_batch_free(&batch);
+    numconv_cache_free(cache);
+    return NULL;
+}
+
+static void server_free_job(struct server_job *job)
+{
+    free(job->request);
+    free(job->response);
+    free(job);
+}
+
+/* Grows a buffer to hold at least need bytes. */
+static bool server_reserve(char **buf, size_t *cap, size_t need)
+{
+    if (need <= *cap)
+        return true;
+    size_t n = *cap ? *cap : 4096;
+    while (n < need)
+        n *= 2;
+    char *p = realloc(*buf, n);
+    if (p == NULL)
+        return false;
+    *buf = p;
+    *cap = n;
+    return true;
+}
+
+/**
+ * @brief Closes a connection; it is freed once none of its requests is still being converted.
+ */
+static void server_close(struct server *srv, struct server_conn *conn)
+{
+    if (conn->fd >= 0) {
+        close(conn->fd);
+        conn->fd = -1;
+        if (conn->prev)
+            conn->prev->next = conn->next;
+        else
+            srv->conns = conn->next;
+        if (conn->next)
+            conn->next->prev = conn->prev;
+        conn->prev = NULL;
+        conn->next = NULL;
+    }
+    if (conn->in_flight == 0) {
+        while (conn->ready) {
+            struct server_job *job = conn->ready;
+            conn->ready = job->next;
+            server_free_job(job);
+        }
+        conn->next = srv->dead;
+        srv->dead = conn;
+    }
+}
+
+/* Watches a connection for requests while it has room for more, and for writability while it has output. */
+static void server_watch(struct server *srv, struct server_conn *conn)
+{
+    uint32_t events = 0;
+    if (!conn->eof && conn->in_flight < SERVER_MAX_IN_FLIGHT && conn->out_len - conn->out_sent < SERVER_MAX_BACKLOG)
+        events |= EPOLLIN;
+    if (conn->out_sent < conn->out_len)
+        events |= EPOLLOUT;
+    if (events != conn->events) {
+        struct epoll_event ev = { .events = events, .data.ptr = conn };
+        epoll_ctl(srv->epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+        conn->events = events;
+    }
+}
+
+/**
+ * @brief Queues the complete requests a connection has read, as far as its in-flight limit allows.
+ * @return false if the client sent a malformed request or memory ran out.
+ */
+static bool server_take_requests(struct server *srv, struct server_conn *conn)
+{
+    struct server_job *head = NULL, *last = NULL;
+    unsigned int n = 0;
+    size_t pos = 0;
+    bool ok = true;
+    while (conn->in_flight < SERVER_MAX_IN_FLIGHT && conn->in_len - pos >= 4) {
+        size_t len = (size_t)load_packed(conn->in + pos, 4);
+        if (len < SERVER_REQUEST_HEADER || len > SERVER_MAX_REQUEST) {
+            ok = false;
+            break;
+        }
+        if (conn->in_len - pos - 4 < len)
+            break;
+        struct server_job *job = calloc(1, sizeof(*job));
+        if (job == NULL || (job->request = malloc(len)) == NULL) {
+            free(job);
+            ok = false;
+            break;
+        }
+        memcpy(job->request, conn->in + pos + 4, len);
+        job->request_len = len;
+        job->conn = conn;
+        job->seq = conn->next_seq++;
+        conn->in_flight++;
+        if (last)
+            last->next = job;
+        else
+            head = job;
+        last = job;
+        n++;
+        pos += 4 + len;
+    }
+    memmove(conn->in, conn->in + pos, conn->in_len - pos);
+    conn->in_len -= pos;
+    if (n) {
+        pthread_mutex_lock(&srv->lock);
+        if (srv->queue_tail)
+            srv->queue_tail->next = head;
+        else
+            srv->queue = head;
+        srv->queue_tail = last;
+        if (n == 1)
+            pthread_cond_signal(&srv->work);
+        else
+            pthread_cond_broadcast(&srv->work);
+        pthread_mutex_unlock(&srv->lock);
+    }
+    return ok;
+}
+
+/**
+ * @brief Sends what a connection's responses it can without blocking, and closes it once it is done.
+ */
+static void server_flush(struct server *srv, struct server_conn *conn)
+{
+    while (conn->out_sent < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + conn->out_sent, conn->out_len - conn->out_sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->out_sent += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            server_close(srv, conn);
+            return;
+        }
+    }
+    if (conn->out_sent == conn->out_len)
+        conn->out_sent = conn->out_len = 0;
+    // Once the client is done, anything left unread is a request it never finished.
+    if (conn->eof && conn->in_flight == 0 && conn->out_len == 0) {
+        server_close(srv, conn);
+        return;
+    }
+    server_watch(srv, conn);
+}
+
+/**
+ * @brief Reads what a connection has sent and queues its complete requests.
+ */
+static void server_read(struct server *srv, struct server_conn *conn)
+{
+    if (!server_reserve(&conn->in, &conn->in_cap, conn->in_len + SERVER_READ_SIZE)) {
+        server_close(srv, conn);
+        return;
+    }
+    ssize_t n = recv(conn->fd, conn->in + conn->in_len, conn->in_cap - conn->in_len, 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+    if (n < 0) {
+        server_close(srv, conn);
+        return;
+    }
+    if (n == 0)
+        conn->eof = true;
+    conn->in_len += (size_t)n;
+    if (!server_take_requests(srv, conn)) {
+        server_close(srv, conn);
+        return;
+    }
+    server_flush(srv, conn);
+}
+
+/**
+ * @brief Hands a converted job back to its connection, sending the responses that are now in order.
+ */
+static void server_finish(struct server *srv, struct server_job *job)
+{
+    struct server_conn *conn = job->conn;
+    conn->in_flight--;
+    if (conn->fd < 0 || job->response == NULL) {
+        server_free_job(job);
+        server_close(srv, conn);
+        return;
+    }
+    struct server_job **link = &conn->ready;
+    while (*link && (*link)->seq < job->seq)
+        link = &(*link)->next;
+    job->next = *link;
+    *link = job;
+    while (conn->ready && conn->ready->seq == conn->next_reply) {
+        job = conn->ready;
+        if (conn->out_sent && conn->out_sent > conn->out_cap / 2) {
+            memmove(conn->out, conn->out + conn->out_sent, conn->out_len - conn->out_sent);
+            conn->out_len -= conn->out_sent;
+            conn->out_sent = 0;
+        }
+        if (!server_reserve(&conn->out, &conn->out_cap, conn->out_len + job->response_len)) {
+            server_close(srv, conn);
+            return;
+        }
+        memcpy(conn->out + conn->out_len, job->response, job->response_len);
+        conn->out_len += job->response_len;
+        conn->ready = job->next;
+        conn->next_reply++;
+        server_free_job(job);
+    }
+    // Requests held back by the in-flight limit can go now.
+    if (!server_take_requests(srv, conn)) {
+        server_close(srv, conn);
+        return;
+    }
+    server_flush(srv, conn);
+}
+
+static void server_accept(struct server *srv)
+{
+    for (;;) {
+        int fd = accept(srv->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+                perror("pa2: accept");
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return;
+        }
+        struct server_conn *conn = calloc(1, sizeof(*conn));
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+        if (conn == NULL || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0 ||
+            fcntl(fd, F_SETFD, FD_CLOEXEC) < 0 || epoll_ctl(srv->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+        conn->next = srv->conns;
+        if (srv->conns)
+            srv->conns->prev = conn;
+        srv->conns = conn;
+    }
+}
+
+/**
+ * @brief Fills in the address of the server socket: a Unix socket path, or a localhost TCP port.
+ * @return false if the path is too long or the port is not 1-65535.
+ */
+static bool server_address(const char *path, const char *port, struct sockaddr_storage *addr, socklen_t *len)
+{
+    memset(addr, 0, sizeof(*addr));
+    if (port) {
+        char *end;
+        unsigned long n = strtoul(port, &end, 10);
+        if (end == port || *end || n < 1 || n > 65535)
+            return false;
+        struct sockaddr_in *in = (struct sockaddr_in *)addr;
+        in->sin_family = AF_INET;
+        in->sin_port = htons((uint16_t)n);
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        *len = sizeof(*in);
+        return true;
+    }
+    struct sockaddr_un *un = (struct sockaddr_un *)addr;
+    if (strlen(path) >= sizeof(un->sun_path))
+        return false;
+    un->sun_family = AF_UNIX;
+    strcpy(un->sun_path, path);
+    *len = sizeof(*un);
+    return true;
+}
+
+static void server_usage(FILE *out)
+{
+    fprintf(out,
+        "usage: pa2 --serve [-s PATH | -p PORT] [-j THREADS] [-c ENTRIES] [-T TABLES]\n"
+        "\n"
+        "Serves batches of conversions until SIGINT or SIGTERM. Each request names\n"
+        "its own systems, width, rounding mode and formats; see pa2 --load.\n"
+        "\n"
+        "  -s PATH    listen on the Unix domain socket PATH (default " SERVER_DEFAULT_SOCKET ")\n"
+        "  -p PORT    listen on localhost TCP PORT instead\n"
+        "  -j THREADS number of conversion threads (default: one per online CPU)\n"
+        "  -c ENTRIES result cache entries of each thread (256 bytes each, default 0)\n"
+        "  -T TABLES  lookup tables for small values: none, 8 or 16 (default 8)\n");
+}
+
+/**
+ * @brief Runs the conversion server ("pa2 --serve ...").
+ * @param argc Argument count, starting at "--serve".
+ * @param argv Argument vector, starting at "--serve".
+ * @return 0 after SIGINT or SIGTERM, 1 if the server could not start, 2 on usage errors.
+ */
+int run_server(int argc, char **argv)
+{
+    const char *path = NULL, *port = NULL;
+    long nthreads = 0;
+    int table_bits = 8;
+    struct server srv = { .epfd = -1, .listen_fd = -1, .wake_fd = -1, .signal_fd = -1 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:p:j:c:T:h")) != -1) {
+        switch (opt) {
+            case 's':
+                path = optarg;
+                break;
+            case 'p':
+                port = optarg;
+                break;
+            case 'j':
+                nthreads = atol(optarg);
+                if (nthreads < 1 || nthreads > 1024) {
+                    fprintf(stderr, "pa2: invalid number of threads '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'c': {
+                char *end;
+                errno = 0;
+                srv.cache_entries = strtoul(optarg, &end, 10);
+                if (errno || end == optarg || *end || optarg[0] == '-') {
+                    fprintf(stderr, "pa2: invalid cache size '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            }
+            case 'T':
+                table_bits = parse_table_bits(optarg);
+                if (table_bits < 0) {
+                    fprintf(stderr, "pa2: unknown table width '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'h':
+                server_usage(stdout);
+                return 0;
+            default:
+                server_usage(stderr);
+                return 2;
+        }
+    }
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    if (optind < argc || (path && port)) {
+        server_usage(stderr);
+        return 2;
+    }
+    if (!path && !port)
+        path = SERVER_DEFAULT_SOCKET;
+    if (!server_address(path, port, &addr, &addr_len)) {
+        fprintf(stderr, "pa2: invalid socket address '%s'\n", port ? port : path);
+        return 2;
+    }
+    if (nthreads == 0) {
+        nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (nthreads < 1)
+            nthreads = 1;
+    }
+    if (!lookup_tables_init((unsigned int)table_bits)) {
+        perror("pa2");
+        return 1;
+    }
+
+    // SIGINT and SIGTERM arrive on a signalfd so the loop can shut down cleanly; workers inherit the mask.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    // Replace a socket left behind by an earlier server, but nothing else.
+    struct stat st;
+    if (path && stat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);
+    int one = 1;
+    srv.listen_fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (srv.listen_fd < 0 || (port && setsockopt(srv.listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0) ||
+        bind(srv.listen_fd, (struct sockaddr *)&addr, addr_len) < 0 || listen(srv.listen_fd, SOMAXCONN) < 0) {
+        fprintf(stderr, "pa2: cannot listen on %s: %s\n", port ? port : path, strerror(errno));
+        if (srv.listen_fd >= 0)
+            close(srv.listen_fd);
+        return 1;
+    }
+    srv.epfd = epoll_create1(EPOLL_CLOEXEC);
+    srv.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    srv.signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN };
+    bool ok = srv.epfd >= 0 && srv.wake_fd >= 0 && srv.signal_fd >= 0;
+    ev.data.ptr = &srv.listen_fd;
+    ok = ok && epoll_ctl(srv.epfd, EPOLL_CTL_ADD, srv.listen_fd, &ev) == 0;
+    ev.data.ptr = &srv.wake_fd;
+    ok = ok && epoll_ctl(srv.epfd, EPOLL_CTL_ADD, srv.wake_fd, &ev) == 0;
+    ev.data.ptr = &srv.signal_fd;
+    ok = ok && epoll_ctl(srv.epfd, EPOLL_CTL_ADD, srv.signal_fd, &ev) == 0;
+
+    pthread_mutex_init(&srv.lock, NULL);
+    pthread_cond_init(&srv.work, NULL);
+    pthread_t *threads = calloc((size_t)nthreads, sizeof(*threads));
+    long started = 0;
+    if (ok && threads) {
+        for (; started < nthreads; started++) {
+            if (pthread_create(&threads[started], NULL, server_worker, &srv) != 0)
+                break;
+        }
+    }
+    if (started == 0) {
+        perror("pa2");
+        ok = false;
+    }
+    if (ok)
+        fprintf(stderr, "pa2: serving on %s with %ld threads\n", port ? port : path, started);
+
+    while (ok) {
+        struct epoll_event events[64];
+        int n = epoll_wait(srv.epfd, events, 64, -1);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            perror("pa2: epoll_wait");
+            break;
+        }
+        bool stop = false;
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &srv.listen_fd) {
+                server_accept(&srv);
+            } else if (ptr == &srv.signal_fd) {
+                stop = true;
+            } else if (ptr == &srv.wake_fd) {
+                uint64_t count;
+                while (read(srv.wake_fd, &count, sizeof(count)) < 0 && errno == EINTR)
+                    ;
+                pthread_mutex_lock(&srv.lock);
+                struct server_job *job = srv.finished;
+                srv.finished = NULL;
+                pthread_mutex_unlock(&srv.lock);
+                while (job) {
+                    struct server_job *next = job->next;
+                    server_finish(&srv, job);
+                    job = next;
+                }
+            } else {
+                // A connection closed earlier in this round stays allocated until the round ends.
+                struct server_conn *conn = ptr;
+                if (conn->fd < 0)
+                    continue;
+                if (events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN))
+                    server_close(&srv, conn);
+                else if (events[i].events & EPOLLIN)
+                    server_read(&srv, conn);
+                else if (events[i].events & EPOLLOUT)
+                    server_flush(&srv, conn);
+            }
+        }
+        while (srv.dead) {
+            struct server_conn *conn = srv.dead;
+            srv.dead = conn->next;
+            free(conn->in);
+            free(conn->out);
+            free(conn);
+        }
+        if (stop)
+            break;
+    }
+
+    // Let the workers finish what they hold, then drop every connection.
+    pthread_mutex_lock(&srv.lock);
+    srv.shutdown = true;
+    pthread_cond_broadcast(&srv.work);
+    pthread_mutex_unlock(&srv.lock);
+    for (long k = 0; k < started; k++)
+        pthread_join(threads[k], NULL);
+    while (srv.queue) {
+        struct server_job *job = srv.queue;
+        srv.queue = job->next;
+        job->next = srv.finished;
+        srv.finished = job;
+    }
+    while (srv.finished) {
+        struct server_job *job = srv.finished;
+        srv.finished = job->next;
+        struct server_conn *conn = job->conn;
+        server_free_job(job);
+        if (--conn->in_flight == 0 && conn->fd < 0)
+            server_close(&srv, conn);
+    }
+    while (srv.conns)
+        server_close(&srv, srv.conns);
+    while (srv.dead) {
+        struct server_conn *conn = srv.dead;
+        srv.dead = conn->next;
+        free(conn->in);
+        free(conn->out);
+        free(conn);
+    }
+    pthread_cond_destroy(&srv.work);
+    pthread_mutex_destroy(&srv.lock);
+    free(threads);
+    close(srv.listen_fd);
+    if (srv.epfd >= 0)
+        close(srv.epfd);
+    if (srv.wake_fd >= 0)
+        close(srv.wake_fd);
+    if (srv.signal_fd >= 0)
+        close(srv.signal_fd);
+    if (path)
+        unlink(path);
+    return ok ? 0 : 1;
+}
+
+/*
+ * Load generator.
+ *
+ * "pa2 --load" replays a file of values against a running server. It cuts
+ * the lines into batches, keeps up to DEPTH of them in flight on a single
+ * connection, and times each batch from the moment it is queued for sending
+ * until its whole response has arrived.
+ */
+static void load_usage(FILE *out)
+{
+    fprintf(out,
+        "usage: pa2 --load [-s PATH | -p PORT] -i SYSTEM -o SYSTEM [-b BITS] [-r MODE] [-F FORMAT]\n"
+        "           [-n LINES] [-d DEPTH] [-R PASSES] [-w] [FILE]\n"
+        "\n"
+        "Sends the lines of FILE (or stdin) to a pa2 --serve server and reports the\n"
+        "throughput and the p50, p99 and worst batch latency.\n"
+        "\n"
+        "  -s PATH    connect to the Unix domain socket PATH (default " SERVER_DEFAULT_SOCKET ")\n"
+        "  -p PORT    connect to localhost TCP PORT instead\n"
+        "  -i, -o, -b, -r, -F  the conversion, as in batch mode\n"
+        "  -n LINES   lines per batch (default 1000)\n"
+        "  -d DEPTH   batches in flight at once (default 16)\n"
+        "  -R PASSES  times the whole input is sent (default 1)\n"
+        "  -w         write the converted output to stdout and failures to stderr,\n"
+        "             as batch mode does; the report then goes to stderr\n");
+}
+
+/**
+ * @brief Runs the load generator ("pa2 --load ...").
+ * @param argc Argument count, starting at "--load".
+ * @param argv Argument vector, starting at "--load".
+ * @return 0 on success, 1 if the server failed or rejected a batch, 2 on usage errors.
+ */
+int run_load(int argc, char **argv)
+{
+    const char *path = NULL, *port = NULL;
+    int inputSystem = 0, outputSystem = 0;
+    unsigned int in_radix = 2, out_radix = 2;
+    int rounding_mode = ROUNDTOEVEN;
+    unsigned long numbits = 0, lines = 1000, depth = 16, passes = 1;
+    struct numconv_ieee754_format in_format = numconv_binary32, out_format = numconv_binary32;
+    bool write_output = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:p:i:o:b:r:F:n:d:R:wh")) != -1) {
+        switch (opt) {
+            case 's':
+                path = optarg;
+                break;
+            case 'p':
+                port = optarg;
+                break;
+            case 'i':
+                inputSystem = parse_system(optarg, &in_radix);
+                if (!inputSystem) {
+                    fprintf(stderr, "pa2: unknown input system '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'o':
+                outputSystem = parse_system(optarg, &out_radix);
+                if (!outputSystem) {
+                    fprintf(stderr, "pa2: unknown output system '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'b':
+                numbits = parse_bits(optarg);
+                if (numbits < 1) {
+                    fprintf(stderr, "pa2: invalid number of bits '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'r':
+                rounding_mode = parse_rounding(optarg);
+                if (rounding_mode < 0) {
+                    fprintf(stderr, "pa2: unknown rounding mode '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'F':
+                if (!parse_format_pair(optarg, &in_format, &out_format)) {
+                    fprintf(stderr, "pa2: unknown IEEE754 format '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'n':
+                lines = strtoul(optarg, NULL, 10);
+                break;
+            case 'd':
+                depth = strtoul(optarg, NULL, 10);
+                break;
+            case 'R':
+                passes = strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                write_output = true;
+                break;
+            case 'h':
+                load_usage(stdout);
+                return 0;
+            default:
+                load_usage(stderr);
+                return 2;
+        }
+    }
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    if (!inputSystem || !outputSystem || optind + 1 < argc || (path && port) || lines < 1 || depth < 1 ||
+        depth > 1 << 20 || passes < 1) {
+        load_usage(stderr);
+        return 2;
+    }
+    if (!path && !port)
+        path = SERVER_DEFAULT_SOCKET;
+    if (!server_address(path, port, &addr, &addr_len)) {
+        fprintf(stderr, "pa2: invalid socket address '%s'\n", port ? port : path);
+        return 2;
+    }
+
+    // Read the whole input and find where each batch of lines starts.
+    const char *name = optind < argc ? argv[optind] : "-";
+    FILE *in = strcmp(name, "-") == 0 ? stdin : fopen(name, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "pa2: %s: %s\n", name, strerror(errno));
+        return 2;
+    }
+    char *data = NULL;
+    size_t data_len = 0, data_cap = 0;
+    bool read_ok = true;
+    for (;;) {
+        if (!server_reserve(&data, &data_cap, data_len + (1 << 20))) {
+            read_ok = false;
+            break;
+        }
+        size_t got = fread(data + data_len, 1, data_cap - data_len, in);
+        data_len += got;
+        if (got == 0)
+            break;
+    }
+    if (ferror(in))
+        read_ok = false;
+    if (in != stdin)
+        fclose(in);
+    size_t *starts = NULL;
+    size_t nbatches = 0, starts_cap = 0;
+    for (size_t pos = 0; read_ok && pos < data_len;) {
+        if (nbatches + 2 > starts_cap) {
+            size_t cap = starts_cap ? 2 * starts_cap : 1024;
+            size_t *p = realloc(starts, cap * sizeof(*starts));
+            if (p == NULL) {
+                read_ok = false;
+                break;
+            }
+            starts = p;
+            starts_cap = cap;
+        }
+        starts[nbatches++] = pos;
+        for (unsigned long k = 0; k < lines && pos < data_len; k++) {
+            const char *nl = memchr(data + pos, '\n', data_len - pos);
+            pos = nl ? (size_t)(nl - data) + 1 : data_len;
+        }
+        starts[nbatches] = pos;
+    }
+    if (!read_ok || nbatches == 0) {
+        if (read_ok)
+            fprintf(stderr, "pa2: %s: no input\n", name);
+        else
+            fprintf(stderr, "pa2: %s: %s\n", name, strerror(errno ? errno : ENOMEM));
+        free(data);
+        free(starts);
+        return 2;
+    }
+
+    int fd = socket(addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, addr_len) < 0 ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+        fprintf(stderr, "pa2: cannot connect to %s: %s\n", port ? port : path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        free(data);
+        free(starts);
+        return 1;
+    }
+
+    // Every request carries the same header; only its id and length change.
+    unsigned char header[SERVER_REQUEST_HEADER] = { 0 };
+    header[4] = (unsigned char)inputSystem;
+    header[5] = (unsigned char)outputSystem;
+    header[6] = (unsigned char)in_radix;
+    header[7] = (unsigned char)out_radix;
+    header[8] = (unsigned char)rounding_mode;
+    store_packed((char *)header + 12, numbits, 4);
+    header[16] = (unsigned char)in_format.exp_bits;
+    header[17] = (unsigned char)in_format.mantissa_bits;
+    header[18] = (unsigned char)out_format.exp_bits;
+    header[19] = (unsigned char)out_format.mantissa_bits;
+    header[20] = (unsigned char)((in_format.finite ? 1 : 0) | (out_format.finite ? 2 : 0));
+
+    FILE *report = write_output ? stderr : stdout;
+    const unsigned long total = (unsigned long)nbatches * passes;
+    double *latency = malloc(total * sizeof(*latency));
+    double *queued = malloc(depth * sizeof(*queued));
+    char *wbuf = NULL, *rbuf = NULL;
+    size_t wlen = 0, wsent = 0, wcap = 0, rlen = 0, rcap = 0;
+    unsigned long sent = 0, received = 0, values = 0, failures = 0;
+    const char *failure = latency && queued ? NULL : strerror(ENOMEM);
+    double start = bench_now();
+
+    while (!failure && received < total) {
+        while (sent < total && sent - received < depth) {
+            size_t k = sent % nbatches;
+            size_t len = starts[k + 1] - starts[k];
+            if (wsent == wlen)
+                wlen = wsent = 0;
+            if (!server_reserve(&wbuf, &wcap, wlen + 4 + SERVER_REQUEST_HEADER + len)) {
+                failure = strerror(ENOMEM);
+                break;
+            }
+            store_packed(wbuf + wlen, SERVER_REQUEST_HEADER + len, 4);
+            memcpy(wbuf + wlen + 4, header, SERVER_REQUEST_HEADER);
+            store_packed(wbuf + wlen + 4, sent & 0xffffffffUL, 4);
+            memcpy(wbuf + wlen + 4 + SERVER_REQUEST_HEADER, data + starts[k], len);
+            wlen += 4 + SERVER_REQUEST_HEADER + len;
+            queued[sent % depth] = bench_now();
+            sent++;
+        }
+        if (failure)
+            break;
+
+        struct pollfd pfd = { .fd = fd, .events = POLLIN | (wsent < wlen ? POLLOUT : 0) };
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno != EINTR)
+                failure = strerror(errno);
+            continue;
+        }
+        if (pfd.revents & POLLOUT) {
+            ssize_t n = send(fd, wbuf + wsent, wlen - wsent, MSG_NOSIGNAL);
+            if (n > 0)
+                wsent += (size_t)n;
+            else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                failure = strerror(errno);
+        }
+        if (!(pfd.revents & (POLLIN | POLLHUP | POLLERR)) || failure)
+            continue;
+        if (!server_reserve(&rbuf, &rcap, rlen + SERVER_READ_SIZE)) {
+            failure = strerror(ENOMEM);
+            break;
+        }
+        ssize_t n = recv(fd, rbuf + rlen, rcap - rlen, 0);
+        if (n == 0) {
+            failure = "the server closed the connection";
+            break;
+        }
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                failure = strerror(errno);
+            continue;
+        }
+        rlen += (size_t)n;
+
+        // Take every complete response; they arrive in the order the batches were sent.
+        size_t pos = 0;
+        while (rlen - pos >= 4) {
+            size_t len = (size_t)load_packed(rbuf + pos, 4);
+            if (len < SERVER_RESPONSE_HEADER) {
+                failure = "malformed response";
+                break;
+            }
+            if (rlen - pos - 4 < len)
+                break;
+            const char *r = rbuf + pos + 4;
+            size_t out_len = (size_t)load_packed(r + 16, 4);
+            if (load_packed(r, 4) != (received & 0xffffffffUL) || out_len > len - SERVER_RESPONSE_HEADER) {
+                failure = "malformed response";
+                break;
+            }
+            if (load_packed(r + 4, 4) != 0) {
+                fprintf(stderr, "pa2: server rejected the batch: %.*s\n", (int)out_len, r + SERVER_RESPONSE_HEADER);
+                failure = "";
+                break;
+            }
+            latency[received] = bench_now() - queued[received % depth];
+            values += load_packed(r + 8, 4);
+            unsigned long nerrors = load_packed(r + 12, 4);
+            failures += nerrors;
+            if (write_output) {
+                // Line numbers count from the start of the input in every pass.
+                unsigned long first_line = (unsigned long)(received % nbatches) * lines + 1;
+                const char *e = r + SERVER_RESPONSE_HEADER + out_len, *end = r + len;
+                fwrite(r + SERVER_RESPONSE_HEADER, 1, out_len, stdout);
+                for (unsigned long i = 0; i < nerrors && end - e >= 8; i++) {
+                    size_t mlen = (size_t)load_packed(e + 4, 4);
+                    if (mlen > (size_t)(end - e) - 8)
+                        break;
+                    fprintf(stderr, "pa2: line %lu: %.*s\n", first_line + load_packed(e, 4), (int)mlen, e + 8);
+                    e += 8 + mlen;
+                }
+            }
+            received++;
+            pos += 4 + len;
+        }
+        memmove(rbuf, rbuf + pos, rlen - pos);
+        rlen -= pos;
+    }
+    double elapsed = (bench_now() - start) / 1e9;
+    close(fd);
+
+    if (failure && *failure)
+        fprintf(stderr, "pa2: %s\n", failure);
+    if (!failure) {
+        qsort(latency, total, sizeof(*latency), bench_compare_doubles);
+        size_t p50 = (total + 1) / 2 - 1, p99 = (size_t)ceil(0.99 * (double)total) - 1;
+        fprintf(report, "batches     %lu of up to %lu lines, up to %lu in flight\n", total, lines, depth);
+        fprintf(report, "values      %lu (%lu failed)\n", values, failures);
+        fprintf(report, "time        %.3f s\n", elapsed);
+        fprintf(report, "throughput  %.0f values/s, %.1f MB/s of input\n", values / elapsed,
+                (double)data_len * passes / elapsed / 1e6);
+        fprintf(report, "latency     p50 %.1f us, p99 %.1f us, max %.1f us\n", latency[p50] / 1e3,
+                latency[p99] / 1e3, latency[total - 1] / 1e3);
+    }
+    free(latency);
+    free(queued);
+    free(wbuf);
+    free(rbuf);
+    free(data);
+    free(starts);
+    return failure ? 1 : 0;
+}